@@ -0,0 +1,56 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reads a file front to back through one fixed-size buffer, so that parsing a file of any
+// size needs no more memory than the buffer. Callers take the bytes of one record at a time
+// and get a pointer into the buffer that stays valid until the next take.
+typedef struct ChunkReader ChunkReader;
+
+/**
+ * Opens a file for chunked reading
+ * 
+ * @param path Path of the file to read
+ * @param chunk_size Size of the buffer; no single take may be larger
+ * @return A pointer to the newly created ChunkReader, or NULL on failure
+ */
+ChunkReader* create_chunk_reader(const char* path, size_t chunk_size);
+
+/**
+ * Closes the file and frees the reader
+ * 
+ * @param reader Pointer to the ChunkReader to destroy
+ */
+void destroy_chunk_reader(ChunkReader* reader);
+
+/**
+ * Returns how many bytes of the file have not been taken yet, from the file's size when it
+ * was opened. Loaders use it to check counts given in a header before allocating for them.
+ * 
+ * @param reader The reader
+ * @return The number of bytes left
+ */
+uint64_t chunk_reader_remaining(const ChunkReader* reader);
+
+/**
+ * Consumes the next count bytes of the file, refilling the buffer when they are not all in it
+ * 
+ * @param reader The reader
+ * @param count Number of bytes to take, at most the chunk size
+ * @return Pointer to the bytes, valid until the next call, or NULL if the file ends first
+ */
+const unsigned char* chunk_reader_take(ChunkReader* reader, size_t count);
+
+/**
+ * Consumes the next line of the file
+ * 
+ * @param reader The reader
+ * @param out_length Receives the length of the line, without its '\n' and any '\r' before it
+ * @return Pointer to the line, not terminated, valid until the next call; or NULL at the end of
+ *         the file or if the line does not fit in the buffer
+ */
+const char* chunk_reader_line(ChunkReader* reader, size_t* out_length);
+
+#endif
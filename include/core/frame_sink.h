@@ -0,0 +1,67 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+#include <stdbool.h>
+#include "core/pixel_buffer.h"
+
+// Encoding of the frames written by a sink
+typedef enum {
+    FRAME_SINK_Y4M,     // YUV4MPEG2 with 4:2:0 chroma, readable by ffmpeg, x264 and most video tools
+    FRAME_SINK_RGBA     // Headerless row-major RGBA, 4 bytes per pixel
+} FrameSinkFormat;
+
+// Streams a sequence of frames to a file, FIFO or stdout. Pushed frames are copied into a
+// bounded queue and converted and written by a background thread, so rendering the next
+// frame overlaps the I/O of the previous one. Pushing blocks while the queue is full.
+typedef struct FrameSink FrameSink;
+
+/**
+ * Opens the output and starts the writer thread. A Y4M stream starts with its header;
+ * a raw RGBA stream carries no header, so the reader must be told the size and rate.
+ * 
+ * @param path File or FIFO to write to, or "-" for stdout
+ * @param format Encoding of the frames
+ * @param width Width of every frame
+ * @param height Height of every frame
+ * @param fps Frame rate recorded in the Y4M header
+ * @param queue_depth Number of frames that can wait for the writer
+ * @return A pointer to the newly created FrameSink, or NULL on failure
+ */
+FrameSink* create_frame_sink(const char* path, FrameSinkFormat format, int width, int height, int fps, int queue_depth);
+
+/**
+ * Writes every queued frame, stops the writer thread, closes the output and frees the sink
+ * 
+ * @param sink Pointer to the FrameSink to destroy
+ * @return True if every pushed frame was written
+ */
+bool destroy_frame_sink(FrameSink* sink);
+
+/**
+ * Copies a frame into the queue, waiting for a free slot if the writer is behind. Frames
+ * must be pushed from one thread at a time.
+ * 
+ * @param sink The sink to write to
+ * @param buffer The frame; must have the size the sink was created with
+ * @return False once a write has failed, for example because the reader closed the pipe
+ */
+bool frame_sink_push(FrameSink* sink, PixelBuffer* buffer);
+
+/**
+ * Returns how many frames the writer has written in full so far. Once a write has failed the
+ * count no longer changes.
+ * 
+ * @param sink The sink
+ * @return The number of frames written
+ */
+int frame_sink_frames_written(FrameSink* sink);
+
+/**
+ * Parses a format name ("y4m" or "rgba")
+ * 
+ * @param name Name of the format
+ * @param out_format Receives the parsed format
+ * @return True if the name was recognised
+ */
+bool frame_sink_format_from_string(const char* name, FrameSinkFormat* out_format);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef JSON_H
+#define JSON_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// A JSON document parsed into a flat array of tokens that point back into the source text,
+// which must outlive the document. Values are stored depth first: an array's elements follow
+// it in order, and an object's members follow it as alternating key and value tokens. Token 0
+// is the root. Strings are left as they appear in the text, so escapes are not decoded.
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+typedef struct {
+    JsonType type;
+    size_t start;       // Offset of the value in the text; for strings, of the first character inside the quotes
+    size_t length;      // Length of the value in the text; for strings, without the quotes
+    size_t count;       // Elements of an array or members of an object
+    size_t next;        // Index of the first token after this value and everything inside it
+} JsonToken;
+
+typedef struct {
+    const char* text;
+    JsonToken* tokens;
+    size_t tokenCount;
+} JsonDocument;
+
+/**
+ * Parses a JSON text
+ * 
+ * @param text The text, which need not be null-terminated
+ * @param length Length of the text in bytes
+ * @return The parsed document, or NULL if the text is not valid JSON or nests too deeply
+ */
+JsonDocument* json_parse(const char* text, size_t length);
+
+/**
+ * Frees a parsed document; the text it was parsed from is left alone
+ * 
+ * @param document Pointer to the JsonDocument to destroy
+ */
+void json_destroy(JsonDocument* document);
+
+/**
+ * Looks up a member of an object
+ * 
+ * @param document The document
+ * @param object Index of the object token
+ * @param key Name of the member
+ * @return Index of the member's value, or -1 if the token is not an object or has no such member
+ */
+int json_object_get(const JsonDocument* document, int object, const char* key);
+
+/**
+ * Looks up an element of an array
+ * 
+ * @param document The document
+ * @param array Index of the array token
+ * @param index Position of the element
+ * @return Index of the element, or -1 if the token is not an array or is too short
+ */
+int json_array_get(const JsonDocument* document, int array, size_t index);
+
+/**
+ * Returns the number of elements of an array token
+ * 
+ * @param document The document
+ * @param array Index of the array token, may be -1
+ * @return The element count, or 0 if the token is missing or not an array
+ */
+size_t json_array_count(const JsonDocument* document, int array);
+
+/**
+ * Reads a number token
+ * 
+ * @param document The document
+ * @param token Index of the token, may be -1
+ * @param fallback Value returned when the token is missing or not a number
+ * @return The number
+ */
+double json_number(const JsonDocument* document, int token, double fallback);
+
+/**
+ * Compares a string token with a string
+ * 
+ * @param document The document
+ * @param token Index of the token, may be -1
+ * @param string The string to compare with
+ * @return True if the token is a string with exactly these characters
+ */
+bool json_string_equals(const JsonDocument* document, int token, const char* string);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// A whole file mapped into memory. Pages are read in by the OS as they are first touched,
+// so parsing straight from the mapping avoids copying the file through stdio. The mapping is
+// copy-on-write: writes through it stay private to the process and never reach the file.
+// Where mmap is unavailable the file is read into an allocated buffer instead.
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    int references;     // Owners sharing the mapping; the last unmap_file releases it
+} MappedFile;
+
+/**
+ * Maps a file into memory
+ * 
+ * @param path Path of the file to map
+ * @return The mapped file, or NULL if it could not be opened. An empty file maps to a NULL data pointer and size 0.
+ */
+MappedFile* map_file(const char* path);
+
+/**
+ * Adds an owner to a mapped file, which then needs one more unmap_file to be released
+ * 
+ * @param file The file to share
+ * @return The same file
+ */
+MappedFile* retain_mapped_file(MappedFile* file);
+
+/**
+ * Drops one owner of a mapped file and unmaps it once none are left. Pointers into its data
+ * become invalid then.
+ * 
+ * @param file The file to unmap
+ */
+void unmap_file(MappedFile* file);
+
+/**
+ * Tells whether a pointer points into a mapped file's data
+ * 
+ * @param file The mapped file, may be NULL
+ * @param pointer The pointer to test
+ * @return True if the pointer lies inside the file's data
+ */
+bool mapped_file_contains(const MappedFile* file, const void* pointer);
+
+#endif
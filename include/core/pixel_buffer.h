@@ -1,17 +1,32 @@
 #ifndef PIXEL_BUFFER_H
 #define PIXEL_BUFFER_H
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Side of the square tiles stored contiguously by the tiled layout
+#define PIXEL_TILE_SIZE 8
+
 // Represents a color with red, green, blue components
 typedef struct {
     uint8_t r, g, b, a;
 } Color;
 
+// How pixels are arranged in memory
+typedef enum {
+    PIXEL_LAYOUT_LINEAR,    // Row-major, one image row after another
+    PIXEL_LAYOUT_TILED      // Row-major 8x8 tiles, each holding its 64 pixels row-major
+} PixelLayout;
+
 // Represents a 2D pixel buffer for rendering
 typedef struct {
     int width;
     int height;
     Color* pixels;
+    PixelLayout layout;
+    int storage_width;      // Allocated size; the tiled layout rounds it up to whole tiles
+    int storage_height;
+    Color* resolved;        // Row-major copy of a tiled buffer, allocated on first resolve
 } PixelBuffer;
 
 /**
@@ -23,6 +38,17 @@ typedef struct {
  */
 PixelBuffer* create_pixel_buffer(int width, int height);
 
+/**
+ * Allocates a pixel buffer with the given memory layout. A tiled buffer keeps every 8x8 block
+ * in four cache lines, so rasterizing a block does not stride across whole image rows.
+ * 
+ * @param width Width of the pixel buffer
+ * @param height Height of the pixel buffer
+ * @param layout Arrangement of the pixels in memory
+ * @return A pointer to the newly created PixelBuffer
+ */
+PixelBuffer* create_pixel_buffer_with_layout(int width, int height, PixelLayout layout);
+
 /**
  * Frees the memory to avoid leaks
  * 
@@ -31,6 +57,25 @@ PixelBuffer* create_pixel_buffer(int width, int height);
  */
 void destroy_pixel_buffer(PixelBuffer* buffer);
 
+/**
+ * Computes where a pixel is stored. A depth buffer drawn alongside the pixel buffer uses the
+ * same index, so it must be allocated with the buffer's storage size.
+ * 
+ * @param buffer Pointer to the PixelBuffer
+ * @param x x-coordinate of the pixel, inside the storage size
+ * @param y y-coordinate of the pixel, inside the storage size
+ * @return The index of the pixel in the pixels array
+ */
+size_t pixel_index(const PixelBuffer* buffer, int x, int y);
+
+/**
+ * Distance in pixels between a pixel and the one below it, when both lie in the same 8x8 tile
+ * 
+ * @param buffer Pointer to the PixelBuffer
+ * @return The row step of the buffer's layout
+ */
+int pixel_row_step(const PixelBuffer* buffer);
+
 /**
  * Updates the color of a single pixel
  * 
@@ -41,6 +86,40 @@ void destroy_pixel_buffer(PixelBuffer* buffer);
  */
 void set_pixel(PixelBuffer* buffer, int x, int y, Color color);
 
+/**
+ * Writes a pixel without the NULL and bounds checks of set_pixel, for callers that already
+ * clamped their coordinates. Building with PIXEL_BUFFER_DEBUG defined asserts them instead.
+ * 
+ * @param buffer Pointer to the PixelBuffer to modify
+ * @param x x-coordinate of the pixel, inside the buffer
+ * @param y y-coordinate of the pixel, inside the buffer
+ * @param color New color to set for the pixel
+ */
+void set_pixel_unchecked(PixelBuffer* buffer, int x, int y, Color color);
+
+/**
+ * Fills the pixels x0 to x1 of one row with a color, without bounds checks. Building with
+ * PIXEL_BUFFER_DEBUG defined asserts that the span lies inside the buffer.
+ * 
+ * @param buffer Pointer to the PixelBuffer to modify
+ * @param x0 First pixel of the span, inclusive
+ * @param x1 Last pixel of the span, inclusive
+ * @param y Row of the span
+ * @param color Color to fill the span with
+ */
+void fill_span(PixelBuffer* buffer, int x0, int x1, int y, Color color);
+
+/**
+ * Hands out the pixels of one row of a row-major buffer for direct writes. Pixels 0 to
+ * width - 1 of the returned pointer belong to the row. Building with PIXEL_BUFFER_DEBUG
+ * defined asserts that the buffer is linear and the row exists.
+ * 
+ * @param buffer Pointer to a PixelBuffer with the linear layout
+ * @param y Row to return, inside the buffer
+ * @return A pointer to the first pixel of the row
+ */
+Color* pixel_row(PixelBuffer* buffer, int y);
+
 /**
  * Reads the color of a specific pixel
  * 
@@ -60,11 +139,30 @@ Color get_pixel(PixelBuffer* buffer, int x, int y);
 void clear_buffer(PixelBuffer* buffer, Color clear_color);
 
 /**
- * Saves the PixelBuffer to a PPM image file
+ * Returns the pixels in row-major order, converting a tiled buffer into its resolve copy
+ * 
+ * @param buffer Pointer to the PixelBuffer to read
+ * @return width * height row-major pixels, or NULL if the resolve copy could not be allocated
+ */
+const Color* resolve_pixel_buffer(PixelBuffer* buffer);
+
+/**
+ * Saves the PixelBuffer to a binary (P6) PPM image file
  * 
  * @param buffer Pointer to the PixelBuffer to save
  * @param filename The name of the output PPM file
+ * @return True if the whole file was written
+ */
+bool save_to_ppm(PixelBuffer* buffer, const char* filename);
+
+/**
+ * Saves the PixelBuffer to a QOI image file, a lossless format that keeps the alpha channel
+ * and encodes much faster than PNG
+ * 
+ * @param buffer Pointer to the PixelBuffer to save
+ * @param filename The name of the output QOI file
+ * @return True if the whole file was written
  */
-void save_to_ppm(PixelBuffer* buffer, const char* filename);
+bool save_to_qoi(PixelBuffer* buffer, const char* filename);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef QOI_H
+#define QOI_H
+#include <stddef.h>
+#include "core/pixel_buffer.h"
+
+// Size of the QOI file header and of the end marker that follows the last chunk
+#define QOI_HEADER_SIZE 14
+#define QOI_END_MARKER_SIZE 8
+
+/**
+ * Encodes row-major RGBA pixels as a QOI image ("Quite OK Image" format), lossless and
+ * typically a fraction of the raw size
+ * 
+ * @param pixels width * height row-major pixels
+ * @param width Width of the image
+ * @param height Height of the image
+ * @param out_size Receives the size of the encoded image in bytes
+ * @return The encoded image, to be released with free, or NULL on failure
+ */
+unsigned char* qoi_encode(const Color* pixels, int width, int height, size_t* out_size);
+
+/**
+ * Decodes a QOI image into row-major RGBA pixels. Three-channel images decode with opaque alpha.
+ * 
+ * @param data The encoded image
+ * @param size Size of the encoded image in bytes
+ * @param out_width Receives the width of the image
+ * @param out_height Receives the height of the image
+ * @return width * height pixels, to be released with free, or NULL if the data is not a valid QOI image
+ */
+Color* qoi_decode(const unsigned char* data, size_t size, int* out_width, int* out_height);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/**
+ * Reads a monotonic clock that is unaffected by changes to the wall clock
+ * 
+ * @return The current time in seconds from an arbitrary fixed origin
+ */
+double timer_now(void);
+
+#endif
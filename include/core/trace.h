@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdbool.h>
+
+// A timed region of one thread, recorded as a complete event once it ends. Zones are only
+// recorded while a trace is open; otherwise beginning and ending one costs a flag check.
+typedef struct {
+    const char* name;
+    double start;
+} TraceZone;
+
+/**
+ * Starts recording zones from every thread into a Chrome trace file. The file is written
+ * when the trace is closed; open it in chrome://tracing or ui.perfetto.dev.
+ * 
+ * @param path Path of the JSON file to write
+ * @return True if recording started, false if a trace is already open or out of memory
+ */
+bool trace_open(const char* path);
+
+/**
+ * Stops recording and writes every recorded zone to the file, one lane per thread.
+ * No zone may be in progress on another thread while the trace is closed.
+ * 
+ * @return True if the file was written
+ */
+bool trace_close(void);
+
+/**
+ * Returns whether a trace is recording
+ * 
+ * @return True between trace_open and trace_close
+ */
+bool trace_enabled(void);
+
+/**
+ * Names the calling thread's lane in the trace. Threads that never name themselves are
+ * shown as "thread N".
+ * 
+ * @param name Name of the lane; must stay valid until the trace is closed
+ */
+void trace_set_thread_name(const char* name);
+
+/**
+ * Starts a zone on the calling thread
+ * 
+ * @param name Name shown for the zone; must stay valid until the trace is closed
+ * @return The zone to pass to trace_end
+ */
+TraceZone trace_begin(const char* name);
+
+/**
+ * Ends a zone and records it
+ * 
+ * @param zone The zone returned by trace_begin
+ */
+void trace_end(TraceZone zone);
+
+#endif
@@ -44,7 +44,9 @@ Mat4 mat4_translation(float x, float y, float z);
 Mat4 mat4_scale(float x, float y, float z);
 
 /**
- * Create a perspective projection matrix
+ * Create a perspective projection matrix for a left-handed view space looking down +z. Depth
+ * z / w runs from -1 at the near plane to 1 at the far plane, so nearer surfaces get smaller
+ * depths, as with the other projections below.
  * 
  * @param fov Field of view in degrees
  * @param aspect Aspect ratio (width / height)
@@ -54,6 +56,31 @@ Mat4 mat4_scale(float x, float y, float z);
  */
 Mat4 mat4_perspective(float fov, float aspect, float near, float far);
 
+/**
+ * Create a perspective projection matrix whose depth z / w runs from 0 at the near plane to 1
+ * at the far plane, as the fixed-point depth formats expect
+ * 
+ * @param fov Field of view in degrees
+ * @param aspect Aspect ratio (width / height)
+ * @param near Near clipping plane
+ * @param far Far clipping plane
+ * @return 4x4 perspective projection matrix
+ */
+Mat4 mat4_perspective_zero_to_one(float fov, float aspect, float near, float far);
+
+/**
+ * Create a reversed-Z perspective projection matrix whose depth z / w runs from 1 at the near
+ * plane to 0 at the far plane. Paired with a float depth buffer, the dense float values near
+ * zero then fall on distant geometry, where a perspective projection needs them most.
+ * 
+ * @param fov Field of view in degrees
+ * @param aspect Aspect ratio (width / height)
+ * @param near Near clipping plane
+ * @param far Far clipping plane
+ * @return 4x4 perspective projection matrix
+ */
+Mat4 mat4_perspective_reversed(float fov, float aspect, float near, float far);
+
 /**
  * Multiply a 4x4 matrix by a 4D vector
  * 
@@ -0,0 +1,103 @@
+#ifndef GLTF_H
+#define GLTF_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/mapped_file.h"
+#include "math/mat4.h"
+#include "mesh/mesh.h"
+
+// Component types of glTF accessors, with the values the format stores
+typedef enum {
+    GLTF_BYTE = 5120,
+    GLTF_UNSIGNED_BYTE = 5121,
+    GLTF_SHORT = 5122,
+    GLTF_UNSIGNED_SHORT = 5123,
+    GLTF_UNSIGNED_INT = 5125,
+    GLTF_FLOAT = 5126
+} GltfComponentType;
+
+// A typed, strided view of elements inside the binary chunk of a mapped .glb file. Every
+// element is known to lie inside the chunk. Values are little-endian, as glTF stores them.
+typedef struct {
+    const unsigned char* data;      // First element, or NULL if the attribute is absent
+    size_t count;
+    size_t stride;                  // Bytes from one element to the next
+    GltfComponentType component_type;
+    int components;                 // 1 for SCALAR up to 4 for VEC4
+    bool normalized;                // Integer components map to [0, 1] or [-1, 1]
+} GltfAccessor;
+
+// One triangle list of a glTF mesh. Positions are always present; the other views may be absent.
+typedef struct {
+    GltfAccessor positions;
+    GltfAccessor normals;
+    GltfAccessor colors;            // COLOR_0, with three or four components
+    GltfAccessor indices;           // Absent for a non-indexed triangle list
+} GltfPrimitive;
+
+// A primitive drawn by a node of the scene, with the node's transform from model space
+// to the scene, parents included
+typedef struct {
+    size_t primitive;
+    Mat4 transform;
+} GltfInstance;
+
+// A .glb file mapped into memory, with views of every triangle primitive of its meshes and
+// one instance for each primitive of each node of the default scene that draws a mesh
+typedef struct {
+    MappedFile* file;
+    GltfPrimitive* primitives;
+    size_t primitiveCount;
+    GltfInstance* instances;
+    size_t instanceCount;
+} GltfModel;
+
+/**
+ * Maps a binary glTF 2.0 (.glb) file and builds views of its primitives in place. Only the
+ * file's own binary chunk is read: buffers given by URI, sparse accessors and primitives
+ * that are not triangle lists are not supported, and the latter are skipped.
+ * 
+ * @param filepath Path of the .glb file
+ * @return Pointer to the loaded GltfModel, or NULL if the file is missing or invalid
+ */
+GltfModel* load_gltf_model(const char* filepath);
+
+/**
+ * Frees a model and unmaps its file, unless meshes made from it still point into it
+ * 
+ * @param model Pointer to the GltfModel to destroy
+ */
+void destroy_gltf_model(GltfModel* model);
+
+/**
+ * Reads one component of an element, converting normalized integers to floats
+ * 
+ * @param accessor The view to read; it must not be absent
+ * @param element Index of the element, less than the accessor's count
+ * @param component Index of the component, less than the accessor's component count
+ * @return The value of the component
+ */
+float gltf_accessor_float(const GltfAccessor* accessor, size_t element, int component);
+
+/**
+ * Reads the first component of an element as an unsigned integer, as for indices
+ * 
+ * @param accessor The view to read; it must not be absent and must have integer components
+ * @param element Index of the element, less than the accessor's count
+ * @return The value of the component
+ */
+uint32_t gltf_accessor_uint(const GltfAccessor* accessor, size_t element);
+
+/**
+ * Builds a mesh from a primitive. Vertices are always converted, since Vertex interleaves
+ * attributes that glTF keeps apart. Indices stored as tightly packed 32-bit integers are used
+ * in place, with the mesh sharing the model's mapping; other index types are converted.
+ * 
+ * @param model The model holding the primitive
+ * @param primitive Index of the primitive
+ * @return Pointer to the new Mesh, or NULL on failure or if an index is out of range
+ */
+Mesh* gltf_primitive_to_mesh(const GltfModel* model, size_t primitive);
+
+#endif
@@ -1,16 +1,20 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include "core/mapped_file.h"
 #include "render/vertex.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 // Definition of the Mesh struct
 typedef struct {
     Vertex* vertices;
-    int* indices;
+    int* indices;           // Three per triangle, each in [0, vertexCount)
     size_t vertexCount;
     size_t indexCount;
+    MappedFile* mapping;    // Set when vertices or indices point into a mapped file, which owns them
+    VertexArrays* arrays;   // Optional copy of the vertices as separate arrays; draw_mesh transforms from it when set
 } Mesh;
 
 // Undirected edge between two vertex indices
@@ -33,18 +37,63 @@ Mesh* create_cube_mesh();
 Mesh* create_pyramid_mesh();
 
 /**
- * Frees the memory allocated for a mesh
+ * Frees the memory allocated for a mesh, and releases the file its arrays point into if any
  * 
  * @param mesh Pointer to the Mesh to be destroyed
  */
 void destroy_mesh(Mesh* mesh);
 
 /**
- * Loads a mesh from an OBJ file
+ * Loads a mesh from an OBJ file. The file is memory-mapped and parsed in place. Polygons are
+ * fanned into triangles and every distinct position and normal pair becomes one vertex.
+ * Vertex colors are read from the common "v x y z r g b" extension and default to white.
+ * Texture coordinates, groups and materials are ignored.
  * 
- * @return Pointer to a dynamically allocated Mesh loaded from the OBJ file
+ * @param filepath Path of the OBJ file
+ * @return Pointer to a dynamically allocated Mesh loaded from the OBJ file, or NULL on failure
  */
-// Mesh* load_mesh_from_obj(const char* filepath);
+Mesh* load_mesh_from_obj(const char* filepath);
+
+/**
+ * Loads a mesh from an OBJ file like load_mesh_from_obj, parsing ranges of whole lines on
+ * several threads. The mesh is identical to the one the serial loader builds.
+ * 
+ * @param filepath Path of the OBJ file
+ * @param thread_count Most threads to parse with; small files use fewer
+ * @return Pointer to a dynamically allocated Mesh loaded from the OBJ file, or NULL on failure
+ */
+Mesh* load_mesh_from_obj_parallel(const char* filepath, int thread_count);
+
+/**
+ * Loads a mesh from a binary STL file. The triangle soup is read in fixed-size chunks and
+ * welded into shared vertices: corners with bit-identical positions become one vertex.
+ * Facet normals and attribute bytes are ignored.
+ * 
+ * @param filepath Path of the STL file
+ * @return Pointer to a dynamically allocated Mesh, or NULL on failure or for a text STL file
+ */
+Mesh* load_mesh_from_stl(const char* filepath);
+
+/**
+ * Loads a mesh from a binary (little- or big-endian) PLY file, read in fixed-size chunks.
+ * Vertex positions are required; normals and red, green, blue and alpha colors are read when
+ * present. Polygons are fanned into triangles, and elements other than vertices and faces
+ * are skipped.
+ * 
+ * @param filepath Path of the PLY file
+ * @return Pointer to a dynamically allocated Mesh, or NULL on failure or for a text PLY file
+ */
+Mesh* load_mesh_from_ply(const char* filepath);
+
+/**
+ * Copies the vertices of a mesh into its separate attribute arrays, allocating them on first
+ * use and again whenever the vertex count outgrows them. Call it again whenever the vertices
+ * or their count change.
+ * 
+ * @param mesh The mesh
+ * @return True on success; on failure the mesh has no arrays
+ */
+bool mesh_build_vertex_arrays(Mesh* mesh);
 
 /**
  * Finds all boundary edges (edges belonging to only one triangle) in the mesh.
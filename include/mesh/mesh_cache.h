@@ -0,0 +1,52 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "mesh/mesh.h"
+
+// A mesh cache file holds a Mesh's vertex and index arrays exactly as they lie in memory,
+// so loading one maps the file and points the mesh into it without parsing or copying.
+// The file starts with a MeshCacheHeader, followed by the vertex and index arrays at the
+// offsets it gives, each aligned to MESH_CACHE_ALIGNMENT bytes. Caches are tied to the
+// layout of Vertex and to the byte order of the machine that wrote them; a cache written
+// by an incompatible build is rejected, and the source asset must be loaded again.
+#define MESH_CACHE_MAGIC "RMESHBIN"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_ALIGNMENT 64
+#define MESH_CACHE_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[8];              // MESH_CACHE_MAGIC, without a terminator
+    uint32_t version;           // MESH_CACHE_VERSION
+    uint32_t header_size;       // sizeof(MeshCacheHeader)
+    uint32_t vertex_size;       // sizeof(Vertex)
+    uint32_t index_size;        // sizeof(int)
+    uint32_t byte_order;        // MESH_CACHE_BYTE_ORDER as written by the saving machine
+    uint32_t reserved;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    uint64_t vertex_offset;     // Byte offset of the vertex array from the start of the file
+    uint64_t index_offset;      // Byte offset of the index array from the start of the file
+} MeshCacheHeader;
+
+/**
+ * Writes a mesh to a cache file
+ * 
+ * @param mesh The mesh to write
+ * @param filepath Path of the cache file to create or replace
+ * @return True if the whole file was written
+ */
+bool save_mesh_cache(const Mesh* mesh, const char* filepath);
+
+/**
+ * Maps a cache file and returns a mesh whose vertices and indices point straight into the
+ * mapping. The mapping is copy-on-write, so the arrays may be modified without changing the
+ * file. destroy_mesh unmaps the file.
+ * 
+ * @param filepath Path of the cache file
+ * @return Pointer to the mapped Mesh, or NULL if the file is missing, truncated, corrupt or
+ *         was written for a different vertex layout or byte order
+ */
+Mesh* load_mesh_cache(const char* filepath);
+
+#endif
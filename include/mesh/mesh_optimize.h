@@ -0,0 +1,67 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+#include <stdbool.h>
+#include "mesh/mesh.h"
+
+// Passes that reorder a mesh's triangles and vertices without changing what it looks like.
+// Each triangle keeps its corners in the same order, so winding is preserved. Run them once
+// per mesh after loading. Arrays that point into a mapped file are replaced by allocated
+// copies rather than written through.
+
+// Vertices the cache simulation keeps, matching the FIFO of a typical post-transform cache
+#define MESH_OPTIMIZE_CACHE_SIZE 16
+
+// How much worse than the best cache order a cluster may get before it is split in two to
+// give the overdraw pass finer pieces to sort
+#define MESH_OPTIMIZE_OVERDRAW_THRESHOLD 1.05f
+
+/**
+ * Reorders triangles so that consecutive triangles share vertices, using Tipsify (Sander,
+ * Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+ * 
+ * @param mesh The mesh to reorder
+ * @param cache_size Entries of the simulated FIFO vertex cache
+ * @return True on success; on failure the mesh is left unchanged
+ */
+bool optimize_mesh_vertex_cache(Mesh* mesh, int cache_size);
+
+/**
+ * Reorders clusters of triangles so that those facing away from the mesh center come first
+ * and hide what is drawn after them. Clusters are cut where the cache order already restarts,
+ * so the cache locality of a vertex cache ordered mesh is mostly kept.
+ * 
+ * @param mesh The mesh to reorder, best already ordered by optimize_mesh_vertex_cache
+ * @param cache_size Entries of the simulated FIFO vertex cache
+ * @param threshold How far a cluster's cache miss ratio may rise above its best before it is split
+ * @return True on success; on failure the mesh is left unchanged
+ */
+bool optimize_mesh_overdraw(Mesh* mesh, int cache_size, float threshold);
+
+/**
+ * Renumbers vertices in the order the triangles first use them, so that drawing reads the
+ * vertex array front to back. Vertices no triangle uses are moved to the end.
+ * 
+ * @param mesh The mesh to reorder
+ * @return True on success; on failure the mesh is left unchanged
+ */
+bool optimize_mesh_vertex_fetch(Mesh* mesh);
+
+/**
+ * Runs the vertex cache, overdraw and vertex fetch passes in that order with the default
+ * cache size and threshold
+ * 
+ * @param mesh The mesh to optimize
+ * @return True on success; on failure the mesh is left unchanged by the pass that failed
+ */
+bool optimize_mesh(Mesh* mesh);
+
+/**
+ * Simulates a FIFO vertex cache over the triangles of a mesh
+ * 
+ * @param mesh The mesh to measure
+ * @param cache_size Entries of the simulated cache
+ * @return Average cache misses per triangle: 3 at worst, and about 0.5 at best for large closed meshes
+ */
+float mesh_cache_miss_ratio(const Mesh* mesh, int cache_size);
+
+#endif
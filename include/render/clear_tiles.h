@@ -0,0 +1,81 @@
+#ifndef CLEAR_TILES_H
+#define CLEAR_TILES_H
+#include "core/pixel_buffer.h"
+#include "render/depth_buffer.h"
+
+// Granularity of the lazy clear, in pixels. Render tiles hold whole clear tiles, so a
+// clear tile is only ever materialized by the thread that owns it.
+#define CLEAR_TILE_SIZE 64
+
+_Static_assert(CLEAR_TILE_SIZE % PIXEL_TILE_SIZE == 0, "clear tiles must hold whole pixel tiles");
+
+// Flags kept per clear tile while it still holds the previous frame's contents
+enum {
+    CLEAR_COLOR_PENDING = 1 << 0,
+    CLEAR_DEPTH_PENDING = 1 << 1
+};
+
+// Deferred clear of a pixel buffer and its depth buffer. A frame starts with every tile
+// only tagged as cleared; a tile is filled with the clear values the first time something
+// is drawn into it, and the color of tiles nothing touched is filled when the frame is presented.
+typedef struct {
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    unsigned char* pending;
+    size_t depth_size;                 // Bytes per depth value
+    Color color_row[CLEAR_TILE_SIZE];  // One tile row of the clear color, copied into tiles on demand
+    unsigned char depth_row[CLEAR_TILE_SIZE * sizeof(float)];
+} ClearTiles;
+
+/**
+ * Allocates the clear tags for buffers of the given size, with nothing pending
+ * 
+ * @param width Width of the pixel and depth buffers
+ * @param height Height of the pixel and depth buffers
+ * @param depth_format Format of the depth buffer, which decides the depth it is cleared to
+ * @return A pointer to the clear tags, or NULL on failure
+ */
+ClearTiles* create_clear_tiles(int width, int height, DepthFormat depth_format);
+
+/**
+ * Frees the clear tags
+ * 
+ * @param clear The clear tags to destroy
+ */
+void destroy_clear_tiles(ClearTiles* clear);
+
+/**
+ * Logically clears the color buffer to a color and the depth buffer to its farthest value
+ * without touching either of them
+ * 
+ * @param clear The clear tags of the buffers
+ * @param color The color the buffer reads as once resolved
+ */
+void clear_tiles_begin(ClearTiles* clear, Color color);
+
+/**
+ * Fills every pending tile overlapping a rectangle with the clear values. Must be called
+ * before drawing into or depth testing against that rectangle.
+ * 
+ * @param clear The clear tags of the buffers
+ * @param buffer The pixel buffer being drawn into
+ * @param depth_buffer The depth buffer being drawn into
+ * @param x0 Left edge of the rectangle, inclusive
+ * @param y0 Top edge of the rectangle, inclusive
+ * @param x1 Right edge of the rectangle, inclusive
+ * @param y1 Bottom edge of the rectangle, inclusive
+ */
+void clear_tiles_resolve(ClearTiles* clear, PixelBuffer* buffer, void* depth_buffer, int x0, int y0, int x1, int y1);
+
+/**
+ * Fills the color of every tile that is still pending, so the pixel buffer can be read or
+ * drawn into without a depth test. Depth stays pending and costs nothing.
+ * 
+ * @param clear The clear tags of the buffers
+ * @param buffer The pixel buffer to present
+ */
+void clear_tiles_resolve_color(ClearTiles* clear, PixelBuffer* buffer);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CLIP_H
+#define CLIP_H
+#include <stdbool.h>
+#include "math/vec4.h"
+
+// Vertices with w below this are treated as lying on or behind the eye
+#define CLIP_W_EPSILON 1e-5f
+
+// Triangles are only clipped against the sides of the frustum when they reach this many
+// viewport half-extents away from the center; anything smaller is left to the rasterizer's
+// bounding box, which clamps it to the screen for free
+#define CLIP_GUARD_BAND 16.0f
+
+// Clipping a triangle against the near plane and the four guard-band planes adds at most one vertex per plane
+#define CLIP_MAX_VERTICES 8
+
+// Outcode bits: which side of the view frustum, near plane and guard band a vertex lies outside
+enum {
+    CLIP_OUTSIDE_LEFT   = 1 << 0,
+    CLIP_OUTSIDE_RIGHT  = 1 << 1,
+    CLIP_OUTSIDE_BOTTOM = 1 << 2,
+    CLIP_OUTSIDE_TOP    = 1 << 3,
+    CLIP_OUTSIDE_NEAR   = 1 << 4,
+    CLIP_OUTSIDE_GUARD  = 1 << 5
+};
+
+// Triangles with a vertex carrying one of these bits must go through clip_triangle before projection
+#define CLIP_NEEDS_CLIPPING (CLIP_OUTSIDE_NEAR | CLIP_OUTSIDE_GUARD)
+
+// A convex polygon in clip space. original_edge[i] is set when the edge from vertex i to vertex
+// i + 1 (wrapping around) is part of an edge of the source triangle rather than a clip plane.
+typedef struct {
+    Vec4 vertices[CLIP_MAX_VERTICES];
+    bool original_edge[CLIP_MAX_VERTICES];
+    int count;
+} ClipPolygon;
+
+/**
+ * Classifies a clip-space vertex against the view frustum, the near plane and the guard band.
+ * A triangle whose three outcodes share a bit is entirely outside and can be dropped.
+ * 
+ * @param v Vertex in clip space
+ * @return The CLIP_OUTSIDE_* bits of every plane the vertex lies outside of
+ */
+unsigned clip_outcode(Vec4 v);
+
+/**
+ * Clips a clip-space triangle against the near plane (w >= CLIP_W_EPSILON) and the guard band.
+ * Triangles entirely outside one side of the view frustum are rejected without clipping, and
+ * triangles that need no clipping are passed through unchanged.
+ * 
+ * @param c0 First vertex in clip space
+ * @param c1 Second vertex in clip space
+ * @param c2 Third vertex in clip space
+ * @param out Receives the clipped polygon, wound like the input triangle
+ * @return The number of polygon vertices: 0 when nothing is left, otherwise 3 or more
+ */
+int clip_triangle(Vec4 c0, Vec4 c1, Vec4 c2, ClipPolygon* out);
+
+/**
+ * Clips a clip-space line segment against the near plane (w >= CLIP_W_EPSILON) and the guard
+ * band, so that both ends can be divided by w and land within reach of the screen. Segments
+ * that need no clipping are left unchanged.
+ * 
+ * @param a First end in clip space, moved onto the clip planes if needed
+ * @param b Second end in clip space, moved onto the clip planes if needed
+ * @return False if nothing of the segment is left
+ */
+bool clip_line(Vec4* a, Vec4* b);
+
+#endif
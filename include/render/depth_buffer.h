@@ -1,8 +1,41 @@
 #ifndef DEPTH_BUFFER_H
 #define DEPTH_BUFFER_H
+#include <stddef.h>
+
+// Granularity of the hierarchical depth levels, in pixels
+#define HIZ_BLOCK_SIZE 8
+#define HIZ_TILE_SIZE 64
+
+// Largest stored value of the fixed-point depth formats, which depth 1.0 maps to
+#define DEPTH_UNORM16_MAX 0xFFFFu
+#define DEPTH_UNORM24_MAX 0xFFFFFFu
+
+// How depth values are stored. Every format keeps nearer depths smaller so one less-than test serves
+// them all, and each is paired with the projection that produces the depth range it expects.
+typedef enum {
+    DEPTH_FORMAT_FLOAT32,           // float, cleared to infinity; depth from mat4_perspective
+    DEPTH_FORMAT_FLOAT32_REVERSED,  // float holding minus the depth of mat4_perspective_reversed, cleared to zero
+    DEPTH_FORMAT_UNORM24,           // 24-bit fixed point packed into 3 little-endian bytes; depth from mat4_perspective_zero_to_one
+    DEPTH_FORMAT_UNORM16            // 16-bit fixed point in a uint16_t; depth from mat4_perspective_zero_to_one
+} DepthFormat;
+
+// Conservative summary of a depth buffer: the farthest (largest) depth stored in every
+// 8x8 block and every 64x64 tile. A triangle whose nearest depth over a region is not
+// smaller than the region's farthest depth cannot pass the depth test anywhere in it.
+typedef struct {
+    int blocks_x;
+    int blocks_y;
+    int tiles_x;
+    int tiles_y;
+    float* block_max;
+    float* tile_max;
+    unsigned char* tile_dirty;  // Set when a block shrank and the tile value may be stale
+} HiZBuffer;
 
 /**
- * Allocate memory for a depth buffer and initialize all values to infinity
+ * Allocate memory for a depth buffer and initialize all values to infinity. A depth buffer
+ * drawn alongside a tiled pixel buffer shares its layout, so allocate it with the pixel
+ * buffer's storage_width and storage_height.
  * 
  * @param width The width of the depth buffer
  * @param height The height of the depth buffer
@@ -19,6 +52,70 @@ float* create_depth_buffer(int width, int height);
  */
 void clear_depth_buffer(float* depth_buffer, int width, int height);
 
+/**
+ * Bytes one depth value takes in a format
+ * 
+ * @param format The depth format
+ * @return The size of one stored depth value
+ */
+size_t depth_format_size(DepthFormat format);
+
+/**
+ * Parse a depth format name: float32, reversed, unorm24 or unorm16
+ * 
+ * @param name The name to parse
+ * @param format Receives the format
+ * @return 1 if the name is known, 0 otherwise
+ */
+int depth_format_from_string(const char* name, DepthFormat* format);
+
+/**
+ * Name of a depth format, as accepted by depth_format_from_string
+ * 
+ * @param format The depth format
+ * @return A static string naming the format
+ */
+const char* depth_format_name(DepthFormat format);
+
+/**
+ * Allocate a depth buffer in the given format and clear it
+ * 
+ * @param width The width of the depth buffer
+ * @param height The height of the depth buffer
+ * @param format How depth values are stored
+ * @return A pointer to the allocated depth buffer, or NULL on failure
+ */
+void* create_depth_buffer_with_format(int width, int height, DepthFormat format);
+
+/**
+ * Reset every value of a depth buffer to the format's farthest depth
+ * 
+ * @param depth_buffer The depth buffer to clear
+ * @param width The width of the depth buffer
+ * @param height The height of the depth buffer
+ * @param format How depth values are stored
+ */
+void clear_depth_buffer_with_format(void* depth_buffer, int width, int height, DepthFormat format);
+
+/**
+ * Write the format's cleared value, the depth nothing has been drawn at, to out
+ * 
+ * @param format The depth format
+ * @param out Receives depth_format_size(format) bytes
+ */
+void depth_format_clear_value(DepthFormat format, void* out);
+
+/**
+ * Read a stored value back as a depth between 0 at the near plane and 1 at the far plane
+ * of the format's projection, or infinity where nothing was drawn into a float32 buffer
+ * 
+ * @param depth_buffer The depth buffer
+ * @param format How depth values are stored
+ * @param index Index of the value to read
+ * @return The depth at that index
+ */
+float read_depth(const void* depth_buffer, DepthFormat format, size_t index);
+
 /**
  * Free the memory allocated for the depth buffer
  * 
@@ -48,4 +145,29 @@ float get_depth(float* depth_buffer, int width, int x, int y);
  */
 void set_depth(float* depth_buffer, int width, int x, int y, float z);
 
+/**
+ * Allocate a hierarchical depth buffer for a depth buffer of the given size, with every
+ * block and tile initialized to infinity
+ * 
+ * @param width The width of the depth buffer
+ * @param height The height of the depth buffer
+ * @return A pointer to the allocated hierarchical depth buffer, or NULL on failure
+ */
+HiZBuffer* create_hiz_buffer(int width, int height);
+
+/**
+ * Reset every block and tile to infinity. Must be called whenever the depth buffer it
+ * summarizes is cleared.
+ * 
+ * @param hiz The hierarchical depth buffer to clear
+ */
+void clear_hiz_buffer(HiZBuffer* hiz);
+
+/**
+ * Free the memory allocated for the hierarchical depth buffer
+ * 
+ * @param hiz The hierarchical depth buffer to destroy
+ */
+void destroy_hiz_buffer(HiZBuffer* hiz);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef OVERDRAW_H
+#define OVERDRAW_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "core/pixel_buffer.h"
+
+// Per-pixel fill counters for one frame. Every covered pixel a triangle depth-tests adds to
+// tested, and every one that passes adds to written, so tested shows the depth complexity and
+// written the overdraw. Pixels skipped by the hierarchical depth buffer are not tested.
+// Counters share the pixel buffer's layout and are indexed with pixel_index.
+typedef struct {
+    int width;
+    int height;
+    uint32_t* tested;
+    uint32_t* written;
+} OverdrawBuffer;
+
+// Which counter a heatmap shows
+typedef enum {
+    OVERDRAW_TESTED,
+    OVERDRAW_WRITTEN
+} OverdrawCounter;
+
+/**
+ * Allocates zeroed overdraw counters. Like a depth buffer, counters drawn alongside a tiled
+ * pixel buffer are allocated with its storage_width and storage_height.
+ * 
+ * @param width The width of the counters
+ * @param height The height of the counters
+ * @return A pointer to the counters, or NULL on failure
+ */
+OverdrawBuffer* create_overdraw_buffer(int width, int height);
+
+/**
+ * Frees overdraw counters
+ * 
+ * @param overdraw The counters to destroy
+ */
+void destroy_overdraw_buffer(OverdrawBuffer* overdraw);
+
+/**
+ * Resets every counter to zero before rendering a new frame
+ * 
+ * @param overdraw The counters to clear
+ */
+void clear_overdraw_buffer(OverdrawBuffer* overdraw);
+
+/**
+ * Parses a counter name ("tested" or "written")
+ * 
+ * @param name Name of the counter
+ * @param out_counter Receives the parsed counter
+ * @return True if the name was recognised
+ */
+bool overdraw_counter_from_string(const char* name, OverdrawCounter* out_counter);
+
+/**
+ * Largest and total count of one counter over the visible pixels of a buffer
+ * 
+ * @param overdraw The counters
+ * @param counter Which counter to read
+ * @param buffer The pixel buffer the counters were drawn alongside; gives the layout and visible size
+ * @param out_total Receives the sum over all visible pixels; may be NULL
+ * @return The largest count of any visible pixel
+ */
+uint32_t overdraw_max(const OverdrawBuffer* overdraw, OverdrawCounter counter, const PixelBuffer* buffer, uint64_t* out_total);
+
+/**
+ * Replaces the pixels of a buffer with a false-color heatmap of one counter: black for
+ * untouched pixels, then blue, cyan, green, yellow and red up to full_scale, and white above it
+ * 
+ * @param overdraw The counters
+ * @param counter Which counter to show
+ * @param buffer The pixel buffer the counters were drawn alongside, overwritten with the heatmap
+ * @param full_scale Count shown as pure red; 0 scales to the largest count in the frame
+ */
+void draw_overdraw_heatmap(const OverdrawBuffer* overdraw, OverdrawCounter counter, PixelBuffer* buffer, uint32_t full_scale);
+
+#endif
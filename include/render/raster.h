@@ -0,0 +1,193 @@
+#ifndef RASTER_H
+#define RASTER_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "math/mat4.h"
+#include "math/vec3.h"
+#include "render/vertex.h"
+#include "core/pixel_buffer.h"
+#include "render/depth_buffer.h"
+#include "render/overdraw.h"
+#include "render/render_stats.h"
+
+// Screen positions are snapped to a 1/256 pixel grid before rasterization
+#define SUBPIXEL_BITS 8
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+
+// Triangles are rasterized in square blocks of pixels aligned to the screen. Depth is evaluated
+// exactly at the left pixel of every block row and offset per lane from there, so any split of
+// the screen into rectangles aligned to the block size rasterizes identically.
+#define RASTER_BLOCK_SIZE 8
+
+// A triangle clipped against the near plane and the guard band fans out into at most this many triangles
+#define RASTER_MAX_CLIPPED_TRIANGLES 6
+
+// Which faces setup rejects, decided by the winding of the triangle on screen. Back-face
+// culling comes first so that zero-initialized render state culls back faces.
+typedef enum {
+    CULL_BACK,
+    CULL_FRONT,
+    CULL_NONE
+} CullMode;
+
+// Implementations of the per-block rasterization kernel
+typedef enum {
+    RASTER_PATH_SCALAR,
+    RASTER_PATH_SSE2,
+    RASTER_PATH_AVX2
+} RasterPath;
+
+// A screen-space vertex snapped to the subpixel grid
+typedef struct {
+    int32_t x, y;
+    float z;
+} FixedVertex;
+
+// A projected triangle with everything the rasterizer needs precomputed
+typedef struct {
+    FixedVertex p0, p1, p2;
+    int min_x, min_y, max_x, max_y;
+    int64_t edge_bias[3];   // Added to each edge value so that only top-left edges own the pixels on them
+    int64_t edge_limit[3];  // Per biased edge value, the threshold below which a pixel is drawn as an edge
+    double z0;              // Depth where the biased edge values w1 and w2 are zero
+    double dz1, dz2;
+    float min_z;
+    DepthFormat depth_format;   // Format of the depth buffer the triangle is set up for
+    Color fill_color;
+} RasterTriangle;
+
+// A vertex transformed to clip space and, unless it needs clipping, projected and snapped to the screen
+typedef struct {
+    Vec4 clip;
+    Vec3 screen;
+    FixedVertex fixed;
+    unsigned outcode;       // CLIP_OUTSIDE_* bits; screen and fixed are only valid without CLIP_NEEDS_CLIPPING
+} ProjectedVertex;
+
+/**
+ * Maps normalized device coordinates to pixel coordinates
+ * 
+ * @param ndc Position in normalized device coordinates
+ * @param width Width of the pixel buffer
+ * @param height Height of the pixel buffer
+ * @return The screen position, with the depth passed through unchanged
+ */
+Vec3 ndc_to_screen(Vec3 ndc, int width, int height);
+
+/**
+ * Classifies a clip-space vertex and, when it needs no clipping, divides it by w and snaps it
+ * to the subpixel grid. Each vertex of a mesh only needs to go through this once per frame.
+ * 
+ * @param out Receives the projected vertex
+ * @param clip Vertex position in clip space
+ * @param width Width of the pixel buffer
+ * @param height Height of the pixel buffer
+ */
+void project_vertex(ProjectedVertex* out, Vec4 clip, int width, int height);
+
+/**
+ * Applies the flat shading model to a triangle
+ * 
+ * @param v0 First vertex of the triangle, in model space
+ * @param v1 Second vertex of the triangle, in model space
+ * @param v2 Third vertex of the triangle, in model space
+ * @return The lit color of the triangle
+ */
+Color shade_triangle(Vertex v0, Vertex v1, Vertex v2);
+
+/**
+ * Culls a triangle of projected vertices, clips it if needed and precomputes the edge equations
+ * of the pieces left. Triangles facing the culled way, with zero area, or covering no pixel
+ * center are rejected before any edge setup. The fill color of the output is left for the
+ * caller to set, so culled triangles are never shaded.
+ * 
+ * @param out Receives the set up triangles
+ * @param v0 First projected vertex of the triangle
+ * @param v1 Second projected vertex of the triangle
+ * @param v2 Third projected vertex of the triangle
+ * @param cull_mode Which faces to reject
+ * @param depth_format Format of the depth buffer; picks the depth range read from the vertices
+ * @param width Width of the pixel buffer
+ * @param height Height of the pixel buffer
+ * @param stats Optional counters for clipped triangles and the reason a triangle was rejected; may be NULL
+ * @return The number of triangles written to out that may cover pixels and should be rasterized
+ */
+int setup_projected_triangle(RasterTriangle out[RASTER_MAX_CLIPPED_TRIANGLES], const ProjectedVertex* v0,
+                             const ProjectedVertex* v1, const ProjectedVertex* v2,
+                             CullMode cull_mode, DepthFormat depth_format, int width, int height,
+                             RenderStats* stats);
+
+/**
+ * Transforms, culls, clips, projects and shades a triangle and precomputes the edge equations of
+ * the pieces left after clipping, for a DEPTH_FORMAT_FLOAT32 depth buffer
+ * 
+ * @param out Receives the set up triangles
+ * @param v0 First vertex of the triangle
+ * @param v1 Second vertex of the triangle
+ * @param v2 Third vertex of the triangle
+ * @param mvp Model-View-Projection matrix to transform the vertices
+ * @param cull_mode Which faces to reject
+ * @param width Width of the pixel buffer
+ * @param height Height of the pixel buffer
+ * @return The number of triangles written to out that may cover pixels and should be rasterized
+ */
+int setup_triangle(RasterTriangle out[RASTER_MAX_CLIPPED_TRIANGLES], Vertex v0, Vertex v1, Vertex v2,
+                   Mat4 mvp, CullMode cull_mode, int width, int height);
+
+/**
+ * Rasterizes the part of a triangle that falls inside a rectangle of the screen
+ * 
+ * @param tri The set up triangle
+ * @param x0 Left edge of the rectangle, inclusive
+ * @param y0 Top edge of the rectangle, inclusive
+ * @param x1 Right edge of the rectangle, inclusive
+ * @param y1 Bottom edge of the rectangle, inclusive
+ * @param buffer Pixel buffer to draw the triangle onto
+ * @param depth_buffer Depth buffer to handle depth testing, in the format the triangle was set up for
+ * @param hiz Optional hierarchical depth buffer used to skip hidden tiles and blocks, kept
+ *            up to date as pixels are written; may be NULL
+ * @param stats Optional counters for the pixels tested and passed; may be NULL. Not thread-safe,
+ *              so threads drawing at once need their own
+ * @param overdraw Optional per-pixel counters of the fragments tested and written; may be NULL.
+ *                 Counting falls back to the scalar kernel.
+ * @return The number of pixels that passed the depth test and were written
+ */
+int rasterize_triangle(const RasterTriangle* tri, int x0, int y0, int x1, int y1,
+                       PixelBuffer* buffer, void* depth_buffer, HiZBuffer* hiz, RenderStats* stats,
+                       OverdrawBuffer* overdraw);
+
+/**
+ * Selects the block kernel used by rasterize_triangle. By default the widest kernel
+ * the CPU supports is picked the first time a triangle is rasterized.
+ * 
+ * @param path The kernel to use
+ * @return True if the CPU supports the kernel and it is now in use
+ */
+bool raster_set_path(RasterPath path);
+
+/**
+ * Returns the block kernel currently used by rasterize_triangle
+ * 
+ * @return The active kernel
+ */
+RasterPath raster_get_path(void);
+
+/**
+ * Returns the name of a block kernel ("scalar", "sse2" or "avx2")
+ * 
+ * @param path The kernel
+ * @return The kernel name
+ */
+const char* raster_path_name(RasterPath path);
+
+/**
+ * Parses a block kernel name
+ * 
+ * @param name Name of the kernel
+ * @param out_path Receives the parsed kernel
+ * @return True if the name was recognised
+ */
+bool raster_path_from_string(const char* name, RasterPath* out_path);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+#include <stddef.h>
+#include <stdio.h>
+#include "core/timer.h"
+
+// Stats are only gathered when the renderer is built with RENDER_STATS defined (make STATS=1).
+// Otherwise the counting macros below expand to nothing and RenderStats stays zeroed.
+#ifdef RENDER_STATS
+#define RENDER_STATS_ENABLED 1
+#define RENDER_STATS_ADD(stats, field, amount) do { if (stats) { (stats)->field += (amount); } } while (0)
+#define RENDER_STATS_CLOCK() timer_now()
+#define RENDER_STATS_TIME(stats, stage, start) \
+    do { if (stats) { (stats)->stage_seconds[stage] += timer_now() - (start); } } while (0)
+#else
+#define RENDER_STATS_ENABLED 0
+#define RENDER_STATS_ADD(stats, field, amount) ((void)sizeof((stats)->field += (amount)))
+#define RENDER_STATS_CLOCK() 0.0
+#define RENDER_STATS_TIME(stats, stage, start) ((void)(stats), (void)(start))
+#endif
+
+// Parts of a frame that are timed separately. Tiles cleared lazily while a triangle is drawn
+// count as raster time; RENDER_STAGE_CLEAR only covers the clears done up front.
+typedef enum {
+    RENDER_STAGE_CLEAR,
+    RENDER_STAGE_TRANSFORM,     // Vertex transform, culling, clipping, triangle setup and binning
+    RENDER_STAGE_RASTER,
+    RENDER_STAGE_WIREFRAME,
+    RENDER_STAGE_UPLOAD,
+    RENDER_STAGE_COUNT
+} RenderStage;
+
+// Counters and timings accumulated while drawing; reset it to start a new measurement
+typedef struct {
+    size_t triangles_submitted;
+    size_t triangles_culled_frustum;    // Entirely outside one side of the view frustum or the screen
+    size_t triangles_culled_backface;   // Facing the way the cull mode rejects
+    size_t triangles_culled_zero_area;  // Degenerate on the subpixel grid, or covering no pixel center
+    size_t triangles_clipped;           // Went through near-plane or guard-band clipping
+    size_t triangles_rasterized;        // Triangles handed to the rasterizer, counting each clipped piece
+    size_t pixels_tested;               // Covered pixels whose depth was tested
+    size_t pixels_depth_passed;
+    size_t pixels_written;              // Pixels that passed the depth test plus wireframe pixels
+    size_t frames;
+    double stage_seconds[RENDER_STAGE_COUNT];
+} RenderStats;
+
+/**
+ * Sets every counter and timing to zero
+ * 
+ * @param stats The stats to reset
+ */
+void render_stats_reset(RenderStats* stats);
+
+/**
+ * Adds the counters and timings of one set of stats to another
+ * 
+ * @param into The stats to add to
+ * @param from The stats to add
+ */
+void render_stats_merge(RenderStats* into, const RenderStats* from);
+
+/**
+ * Returns the name of a timed stage ("clear", "transform", "raster", "wireframe" or "upload")
+ * 
+ * @param stage The stage
+ * @return The stage name
+ */
+const char* render_stage_name(RenderStage stage);
+
+/**
+ * Prints the stats as per-frame averages, one line of counters and one of stage timings
+ * 
+ * @param stats The stats to print; frames gives the number of frames they cover
+ * @param out The stream to print to
+ */
+void render_stats_print(const RenderStats* stats, FILE* out);
+
+#endif
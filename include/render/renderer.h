@@ -0,0 +1,63 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+#include <stddef.h>
+#include "core/pixel_buffer.h"
+#include "math/mat4.h"
+#include "mesh/mesh.h"
+#include "render/clear_tiles.h"
+#include "render/depth_buffer.h"
+#include "render/raster.h"
+#include "render/render_stats.h"
+#include "render/tile_renderer.h"
+
+// Per-vertex results of draw_mesh, kept between calls so the storage is only grown, never reallocated per mesh
+typedef struct {
+    ProjectedVertex* vertices;
+    ClipArrays clip;        // Clip-space positions of meshes with vertex arrays, one block of four arrays
+    size_t capacity;
+} VertexStream;
+
+// The buffers a frame is drawn into, and how triangles reach them
+typedef struct {
+    PixelBuffer* buffer;
+    void* depth_buffer;     // Stored in depth_format
+    int width;
+    int height;
+    TileRenderer* tiles;    // When set, triangles are binned and rasterized by the tile workers
+    HiZBuffer* hiz;         // When set, hidden tiles and blocks are skipped; clear it with the depth buffer
+    ClearTiles* clear;      // When set, the buffers are cleared lazily, one tile at a time on first use
+    VertexStream* stream;   // When set, draw_mesh reuses it instead of allocating per call
+    CullMode cull_mode;     // Faces draw_mesh rejects; zero-initialized targets cull back faces
+    DepthFormat depth_format;   // Zero-initialized targets use float32 depth
+    RenderStats* stats;     // When set and built with RENDER_STATS, counters and stage timings are added to it
+    OverdrawBuffer* overdraw;   // When set, every pixel counts the fragments tested and written; clear it per frame
+} RenderTarget;
+
+/**
+ * Allocates an empty vertex stream for draw_mesh to reuse
+ * 
+ * @return A pointer to the vertex stream, or NULL on failure
+ */
+VertexStream* create_vertex_stream(void);
+
+/**
+ * Frees a vertex stream and its storage
+ * 
+ * @param stream The vertex stream to destroy
+ */
+void destroy_vertex_stream(VertexStream* stream);
+
+/**
+ * Draws the filled triangles of an indexed mesh. Every vertex is transformed and projected once
+ * into a clip-space stream, then triangles are assembled from the mesh indices. With a tile
+ * renderer on the target the triangles are only binned; call tile_renderer_flush to draw them.
+ * Triangles with an index outside the mesh's vertices are skipped.
+ * 
+ * @param mesh The mesh to draw
+ * @param mvp Model-View-Projection matrix to transform the vertices
+ * @param target The buffers to draw into
+ * @return The number of pixels written, or 0 when the triangles were only binned
+ */
+size_t draw_mesh(const Mesh* mesh, const Mat4* mvp, RenderTarget* target);
+
+#endif
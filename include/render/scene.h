@@ -0,0 +1,132 @@
+#ifndef SCENE_H
+#define SCENE_H
+#include <stddef.h>
+#include "core/camera.h"
+#include "math/mat4.h"
+#include "mesh/mesh.h"
+#include "render/renderer.h"
+
+#define SCENE_MAX_OBJECTS 256
+#define SCENE_MAX_MESHES 256
+
+// The built-in scenes that the renderer front-ends can select
+typedef enum {
+    SCENE_DEFAULT,
+    SCENE_GRID,
+    SCENE_LAYERS
+} SceneType;
+
+// Work done while drawing a scene
+typedef struct {
+    size_t triangles;
+    size_t pixels;
+} SceneStats;
+
+// A mesh placed in the scene, spinning around its local Y axis
+typedef struct {
+    Mesh* mesh;
+    Mat4 placement;
+    float spin_speed;
+    Mat4 model_matrix;
+} SceneObject;
+
+// A loaded mesh and the transform that places it among the others loaded with it
+typedef struct {
+    Mesh* mesh;
+    Mat4 transform;
+} MeshInstance;
+
+// A collection of objects drawn together every frame
+typedef struct {
+    SceneObject objects[SCENE_MAX_OBJECTS];
+    size_t objectCount;
+    Mesh* meshes[SCENE_MAX_MESHES];
+    size_t meshCount;
+    Vec3 center;
+    float view_distance;
+} Scene;
+
+/**
+ * Creates one of the built-in scenes
+ * 
+ * @param type The scene to build
+ * @return Pointer to the newly created Scene, or NULL on failure
+ */
+Scene* create_scene(SceneType type);
+
+/**
+ * Creates a scene showing a single loaded mesh, centered in front of the camera and scaled
+ * to a fixed size
+ * 
+ * @param mesh The mesh to show; the scene takes ownership of it, even on failure
+ * @return Pointer to the newly created Scene, or NULL on failure
+ */
+Scene* create_mesh_scene(Mesh* mesh);
+
+/**
+ * Creates a scene showing loaded meshes at their own transforms, with the group as a whole
+ * centered in front of the camera and scaled to a fixed size, as create_mesh_scene does
+ * 
+ * @param meshes The distinct meshes the instances draw; the scene takes ownership of all of
+ *               them, even on failure
+ * @param mesh_count Number of meshes, at most SCENE_MAX_MESHES
+ * @param instances The meshes to draw and where, each drawing one of the given meshes
+ * @param instance_count Number of instances, at most SCENE_MAX_OBJECTS
+ * @return Pointer to the newly created Scene, or NULL on failure or if there is nothing to draw
+ */
+Scene* create_mesh_instances_scene(Mesh** meshes, size_t mesh_count, const MeshInstance* instances,
+                                   size_t instance_count);
+
+/**
+ * Frees a scene and the meshes it owns
+ * 
+ * @param scene Pointer to the Scene to destroy
+ */
+void destroy_scene(Scene* scene);
+
+/**
+ * Parses a scene name as given on the command line
+ * 
+ * @param name Name of the scene ("default", "grid" or "layers")
+ * @param out_type Receives the parsed scene type
+ * @return 1 if the name was recognised, 0 otherwise
+ */
+int scene_type_from_string(const char* name, SceneType* out_type);
+
+/**
+ * Returns the command line name of a scene type
+ * 
+ * @param type The scene type
+ * @return The scene name
+ */
+const char* scene_type_name(SceneType type);
+
+/**
+ * Moves the camera along a fixed, looping fly-by path in front of the scene
+ * 
+ * @param scene Pointer to the Scene to look at
+ * @param camera Camera to reposition; its projection matrix is left untouched
+ * @param t Position along the path, where 0 and 1 are the same point
+ */
+void scene_camera_path(const Scene* scene, Camera* camera, float t);
+
+/**
+ * Updates the model matrix of every object for the given animation time
+ * 
+ * @param scene Pointer to the Scene to animate
+ * @param time Animation time in seconds
+ */
+void scene_update(Scene* scene, float time);
+
+/**
+ * Draws every object in the scene: a fill pass followed by a wireframe pass. With lazy clear
+ * tags on the target, the pixel buffer is fully resolved when this returns.
+ * 
+ * @param scene Pointer to the Scene to draw
+ * @param camera Camera providing the view and projection matrices
+ * @param target Buffers to draw into
+ * @param stats Receives the number of triangles submitted and pixels written, may be NULL
+ */
+void draw_scene(const Scene* scene, const Camera* camera, RenderTarget* target, SceneStats* stats);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef TILE_RENDERER_H
+#define TILE_RENDERER_H
+#include <stddef.h>
+#include "math/mat4.h"
+#include "render/vertex.h"
+#include "core/pixel_buffer.h"
+#include "render/clear_tiles.h"
+#include "render/depth_buffer.h"
+#include "render/raster.h"
+#include "render/render_stats.h"
+
+// Side length in pixels of the square screen tiles triangles are binned into
+#define RENDER_TILE_SIZE 64
+
+// Sort-middle renderer: triangles are set up on the submitting thread and binned
+// into screen tiles, then a pool of worker threads rasterizes whole tiles in parallel.
+// Every tile owns a disjoint block of the pixel and depth buffers, so no locks are taken
+// on either, and each tile draws its triangles in submission order.
+typedef struct TileRenderer TileRenderer;
+
+/**
+ * Creates a tile renderer and starts its worker threads
+ * 
+ * @param width Width of the pixel buffers that will be rendered into
+ * @param height Height of the pixel buffers that will be rendered into
+ * @param thread_count Number of threads rasterizing tiles, including the caller of tile_renderer_flush
+ * @return A pointer to the newly created TileRenderer, or NULL on failure
+ */
+TileRenderer* create_tile_renderer(int width, int height, int thread_count);
+
+/**
+ * Stops the worker threads and frees the tile renderer
+ * 
+ * @param renderer Pointer to the TileRenderer to destroy
+ */
+void destroy_tile_renderer(TileRenderer* renderer);
+
+/**
+ * Sets up a triangle and adds it to the bin of every tile its bounding box touches
+ * 
+ * @param renderer Pointer to the TileRenderer
+ * @param v0 First vertex of the triangle
+ * @param v1 Second vertex of the triangle
+ * @param v2 Third vertex of the triangle
+ * @param mvp Model-View-Projection matrix to transform the vertices
+ * @param cull_mode Which faces to reject
+ */
+void tile_renderer_submit_triangle(TileRenderer* renderer, Vertex v0, Vertex v1, Vertex v2, Mat4 mvp, CullMode cull_mode);
+
+/**
+ * Returns storage for the triangles one source triangle is set up into, so callers can run
+ * setup_projected_triangle straight into the renderer. Finish with tile_renderer_end_triangle.
+ * 
+ * @param renderer Pointer to the TileRenderer
+ * @return Room for RASTER_MAX_CLIPPED_TRIANGLES triangles, or NULL if it could not be allocated
+ */
+RasterTriangle* tile_renderer_begin_triangle(TileRenderer* renderer);
+
+/**
+ * Adds the triangles written since tile_renderer_begin_triangle to the bin of every tile their
+ * bounding boxes touch
+ * 
+ * @param renderer Pointer to the TileRenderer
+ * @param count Number of triangles that were set up
+ */
+void tile_renderer_end_triangle(TileRenderer* renderer, int count);
+
+/**
+ * Rasterizes every binned triangle into the buffers and empties the bins. If storage for a
+ * triangle or a bin entry could not be allocated since the last flush, the frame is drawn
+ * without those triangles and the number of them is reported on stderr.
+ * 
+ * @param renderer Pointer to the TileRenderer
+ * @param buffer Pixel buffer to draw into
+ * @param depth_buffer Depth buffer to handle depth testing, in the format the triangles were set up for
+ * @param hiz Optional hierarchical depth buffer for coarse rejection; may be NULL
+ * @param clear Optional lazy clear tags; tiles a triangle touches are cleared before it is drawn. May be NULL
+ * @param stats Optional stats that the pixel counters and the raster time are added to; may be NULL
+ * @param overdraw Optional per-pixel counters of the fragments tested and written; may be NULL
+ * @return The number of pixels that passed the depth test and were written
+ */
+size_t tile_renderer_flush(TileRenderer* renderer, PixelBuffer* buffer, void* depth_buffer, HiZBuffer* hiz,
+                           ClearTiles* clear, RenderStats* stats, OverdrawBuffer* overdraw);
+
+#endif
@@ -6,7 +6,8 @@
 #include "mesh/mesh.h"
 
 /**
- * Draw a triangle on the screen using the given vertices and transformation matrix
+ * Draw a triangle on the screen using the given vertices and transformation matrix.
+ * Triangles facing away from the viewer are culled.
  * 
  * @param v0 First vertex of the triangle
  * @param v1 Second vertex of the triangle
@@ -16,8 +17,9 @@
  * @param depth_buffer Depth buffer to handle depth testing
  * @param width Width of the pixel buffer
  * @param height Height of the pixel buffer
+ * @return The number of pixels that passed the depth test and were written
  */
-void draw_triangle(Vertex v0, Vertex v1, Vertex v2, Mat4 mvp, PixelBuffer* buffer, float* depth_buffer, int width, int height);
+int draw_triangle(Vertex v0, Vertex v1, Vertex v2, Mat4 mvp, PixelBuffer* buffer, float* depth_buffer, int width, int height);
 
 /**
  * Draws the wireframe of a mesh using the given MVP matrix
@@ -28,7 +30,8 @@ void draw_triangle(Vertex v0, Vertex v1, Vertex v2, Mat4 mvp, PixelBuffer* buffe
  * @param depth_buffer Depth buffer to handle depth testing
  * @param width Width of the pixel buffer
  * @param height Height of the pixel buffer
+ * @return The number of pixels drawn
  */
-void draw_wireframe(const Mesh* mesh, Mat4 mvp, PixelBuffer* buffer, float* depth_buffer, int width, int height);
+size_t draw_wireframe(const Mesh* mesh, Mat4 mvp, PixelBuffer* buffer, float* depth_buffer, int width, int height);
 
 #endif
\ No newline at end of file
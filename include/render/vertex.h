@@ -1,5 +1,7 @@
 #ifndef VERTEX_H
 #define VERTEX_H
+#include <stddef.h>
+#include "math/mat4.h"
 #include "math/vec3.h"
 #include "math/vec4.h"
 #include "core/pixel_buffer.h"
@@ -11,6 +13,28 @@ typedef struct {
     Color color;
 } Vertex;
 
+// Vertices split into one array per attribute component (structure of arrays), so that a batch
+// of consecutive vertices loads straight into SIMD registers. The position's w is always 1 and
+// is not stored.
+typedef struct {
+    float* x;
+    float* y;
+    float* z;
+    float* nx;
+    float* ny;
+    float* nz;
+    Color* colors;
+    size_t capacity;    // Vertices the arrays have room for
+} VertexArrays;
+
+// Clip-space positions, one array per component
+typedef struct {
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+} ClipArrays;
+
 /**
  * Convert a Vertex to a 4D vector
  * 
@@ -19,4 +43,16 @@ typedef struct {
  */
 Vec4 vertex_to_vec4(Vertex v);
 
-#endif
\ No newline at end of file
+/**
+ * Transforms vertex positions to clip space, 8 at a time with AVX2, 4 at a time with SSE2 or
+ * one at a time, following the path raster_set_path selected. Every path rounds exactly as
+ * mat4_mul_vec4 does, so all of them give the same results.
+ * 
+ * @param mvp Model-View-Projection matrix
+ * @param vertices Positions to transform
+ * @param count Number of vertices
+ * @param out Receives count clip-space positions
+ */
+void transform_vertex_arrays(const Mat4* mvp, const VertexArrays* vertices, size_t count, ClipArrays* out);
+
+#endif
@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 200809L
+#include "core/chunk_reader.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ChunkReader {
+    FILE* file;
+    unsigned char* buffer;
+    size_t capacity;
+    size_t start;       // First byte not yet taken
+    size_t end;         // End of the bytes read from the file
+    bool at_end;
+    uint64_t file_size;
+    uint64_t file_read; // Bytes read from the file into the buffer so far
+};
+
+// Finds the size of an open file and goes back to its start
+static bool file_size(FILE* file, uint64_t* out_size) {
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    long long size = _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    off_t size = ftello(file);
+#endif
+    if (size < 0) {
+        return false;
+    }
+    *out_size = (uint64_t)size;
+    rewind(file);
+    return true;
+}
+
+ChunkReader* create_chunk_reader(const char* path, size_t chunk_size) {
+    ChunkReader* reader = calloc(1, sizeof(ChunkReader));
+    if (!reader) {
+        return NULL;
+    }
+
+    reader->capacity = chunk_size;
+    reader->buffer = malloc(chunk_size);
+    reader->file = fopen(path, "rb");
+    if (!reader->buffer || !reader->file || !file_size(reader->file, &reader->file_size)) {
+        if (!reader->file) {
+            perror("Failed to open file");
+        }
+        destroy_chunk_reader(reader);
+        return NULL;
+    }
+
+    return reader;
+}
+
+void destroy_chunk_reader(ChunkReader* reader) {
+    if (!reader) {
+        return;
+    }
+
+    if (reader->file) {
+        fclose(reader->file);
+    }
+    free(reader->buffer);
+    free(reader);
+}
+
+// Moves the untaken bytes to the front of the buffer and fills the rest from the file
+static void refill(ChunkReader* reader) {
+    size_t remaining = reader->end - reader->start;
+    memmove(reader->buffer, reader->buffer + reader->start, remaining);
+    reader->start = 0;
+    reader->end = remaining;
+
+    size_t read = fread(reader->buffer + remaining, 1, reader->capacity - remaining, reader->file);
+    reader->end += read;
+    reader->file_read += read;
+    if (read < reader->capacity - remaining) {
+        reader->at_end = true;
+    }
+}
+
+uint64_t chunk_reader_remaining(const ChunkReader* reader) {
+    uint64_t unread = reader->file_size > reader->file_read ? reader->file_size - reader->file_read : 0;
+    return unread + (reader->end - reader->start);
+}
+
+const unsigned char* chunk_reader_take(ChunkReader* reader, size_t count) {
+    if (count > reader->capacity) {
+        return NULL;
+    }
+    if (reader->end - reader->start < count) {
+        if (reader->at_end) {
+            return NULL;
+        }
+        refill(reader);
+        if (reader->end - reader->start < count) {
+            return NULL;
+        }
+    }
+
+    const unsigned char* bytes = reader->buffer + reader->start;
+    reader->start += count;
+    return bytes;
+}
+
+const char* chunk_reader_line(ChunkReader* reader, size_t* out_length) {
+    const unsigned char* newline = memchr(reader->buffer + reader->start, '\n', reader->end - reader->start);
+    if (!newline && !reader->at_end) {
+        refill(reader);
+        newline = memchr(reader->buffer + reader->start, '\n', reader->end - reader->start);
+    }
+
+    // The last line of a file may end without a newline
+    size_t length;
+    size_t consumed;
+    if (newline) {
+        length = (size_t)(newline - (reader->buffer + reader->start));
+        consumed = length + 1;
+    } else if (reader->at_end && reader->end > reader->start) {
+        length = reader->end - reader->start;
+        consumed = length;
+    } else {
+        return NULL;
+    }
+
+    const char* line = (const char*)reader->buffer + reader->start;
+    reader->start += consumed;
+    if (length > 0 && line[length - 1] == '\r') {
+        length--;
+    }
+    *out_length = length;
+    return line;
+}
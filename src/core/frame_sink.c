@@ -0,0 +1,291 @@
+#include "core/frame_sink.h"
+#include "core/trace.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct FrameSink {
+    FILE* file;
+    bool owns_file;             // False when writing to stdout, which is flushed but not closed
+    FrameSinkFormat format;
+    int width;
+    int height;
+
+    // Ring of queued frames; only the slots between head and head + count belong to the writer
+    Color** slots;
+    int queue_depth;
+    int head;
+    int count;
+    bool closing;
+    bool failed;
+    int written;                // Frames written in full
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t writer;
+
+    // Encoded frame, owned by the writer thread
+    unsigned char* encoded;
+    size_t encoded_size;
+};
+
+static const char Y4M_FRAME_TAG[] = "FRAME\n";
+
+bool frame_sink_format_from_string(const char* name, FrameSinkFormat* out_format) {
+    if (strcmp(name, "y4m") == 0) {
+        *out_format = FRAME_SINK_Y4M;
+    } else if (strcmp(name, "rgba") == 0) {
+        *out_format = FRAME_SINK_RGBA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// BT.601 limited range, the default most tools assume for Y4M
+static uint8_t rgb_to_y(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static uint8_t rgb_to_u(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static uint8_t rgb_to_v(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Converts a frame to a Y4M frame: the tag, a full-size luma plane, then both chroma planes
+// at half size, each chroma sample taken from the average of a 2x2 block
+static void encode_y4m(const FrameSink* sink, const Color* pixels, unsigned char* out) {
+    int width = sink->width;
+    int height = sink->height;
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+
+    memcpy(out, Y4M_FRAME_TAG, sizeof(Y4M_FRAME_TAG) - 1);
+    unsigned char* y_plane = out + sizeof(Y4M_FRAME_TAG) - 1;
+    unsigned char* u_plane = y_plane + (size_t)width * height;
+    unsigned char* v_plane = u_plane + (size_t)chroma_width * chroma_height;
+
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        y_plane[i] = rgb_to_y(pixels[i].r, pixels[i].g, pixels[i].b);
+    }
+
+    for (int cy = 0; cy < chroma_height; cy++) {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        for (int cx = 0; cx < chroma_width; cx++) {
+            int x0 = cx * 2;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+            const Color* a = &pixels[y0 * width + x0];
+            const Color* b = &pixels[y0 * width + x1];
+            const Color* c = &pixels[y1 * width + x0];
+            const Color* d = &pixels[y1 * width + x1];
+            int r = (a->r + b->r + c->r + d->r + 2) / 4;
+            int g = (a->g + b->g + c->g + d->g + 2) / 4;
+            int bl = (a->b + b->b + c->b + d->b + 2) / 4;
+            u_plane[cy * chroma_width + cx] = rgb_to_u(r, g, bl);
+            v_plane[cy * chroma_width + cx] = rgb_to_v(r, g, bl);
+        }
+    }
+}
+
+static bool write_frame(FrameSink* sink, const Color* pixels) {
+    TraceZone zone = trace_begin("frame_sink_write");
+    size_t written;
+    if (sink->format == FRAME_SINK_Y4M) {
+        encode_y4m(sink, pixels, sink->encoded);
+        written = fwrite(sink->encoded, 1, sink->encoded_size, sink->file);
+    } else {
+        // Color is already laid out as RGBA bytes
+        written = fwrite(pixels, 1, sink->encoded_size, sink->file);
+    }
+    trace_end(zone);
+    return written == sink->encoded_size;
+}
+
+static void* writer_main(void* arg) {
+    FrameSink* sink = arg;
+    trace_set_thread_name("frame sink");
+
+    for (;;) {
+        pthread_mutex_lock(&sink->lock);
+        while (sink->count == 0 && !sink->closing) {
+            pthread_cond_wait(&sink->not_empty, &sink->lock);
+        }
+        if (sink->count == 0) {
+            pthread_mutex_unlock(&sink->lock);
+            break;
+        }
+        Color* frame = sink->slots[sink->head];
+        bool failed = sink->failed;
+        pthread_mutex_unlock(&sink->lock);
+
+        // After a failed write the remaining frames are dropped so the producer never blocks forever
+        bool ok = failed || write_frame(sink, frame);
+
+        pthread_mutex_lock(&sink->lock);
+        sink->failed = sink->failed || !ok;
+        sink->written += !failed && ok;
+        sink->head = (sink->head + 1) % sink->queue_depth;
+        sink->count--;
+        pthread_cond_signal(&sink->not_full);
+        pthread_mutex_unlock(&sink->lock);
+    }
+
+    return NULL;
+}
+
+static void free_frame_sink(FrameSink* sink) {
+    if (sink->slots) {
+        for (int i = 0; i < sink->queue_depth; i++) {
+            free(sink->slots[i]);
+        }
+    }
+    free(sink->slots);
+    free(sink->encoded);
+    if (sink->file && sink->owns_file) {
+        fclose(sink->file);
+    }
+    free(sink);
+}
+
+FrameSink* create_frame_sink(const char* path, FrameSinkFormat format, int width, int height, int fps, int queue_depth) {
+    if (width <= 0 || height <= 0 || fps <= 0 || queue_depth <= 0) {
+        return NULL;
+    }
+
+    FrameSink* sink = calloc(1, sizeof(FrameSink));
+    if (!sink) {
+        return NULL;
+    }
+
+    sink->format = format;
+    sink->width = width;
+    sink->height = height;
+    sink->queue_depth = queue_depth;
+
+    size_t pixel_count = (size_t)width * height;
+    if (format == FRAME_SINK_Y4M) {
+        size_t chroma_count = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+        sink->encoded_size = sizeof(Y4M_FRAME_TAG) - 1 + pixel_count + chroma_count * 2;
+        sink->encoded = malloc(sink->encoded_size);
+        if (!sink->encoded) {
+            free_frame_sink(sink);
+            return NULL;
+        }
+    } else {
+        sink->encoded_size = pixel_count * sizeof(Color);
+    }
+
+    sink->slots = calloc(queue_depth, sizeof(Color*));
+    if (!sink->slots) {
+        free_frame_sink(sink);
+        return NULL;
+    }
+    for (int i = 0; i < queue_depth; i++) {
+        sink->slots[i] = malloc(pixel_count * sizeof(Color));
+        if (!sink->slots[i]) {
+            free_frame_sink(sink);
+            return NULL;
+        }
+    }
+
+    if (strcmp(path, "-") == 0) {
+        sink->file = stdout;
+    } else {
+        sink->file = fopen(path, "wb");
+        sink->owns_file = true;
+    }
+    if (!sink->file) {
+        perror("Failed to open stream");
+        free_frame_sink(sink);
+        return NULL;
+    }
+
+    if (format == FRAME_SINK_Y4M &&
+        fprintf(sink->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps) < 0) {
+        free_frame_sink(sink);
+        return NULL;
+    }
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->not_empty, NULL);
+    pthread_cond_init(&sink->not_full, NULL);
+    if (pthread_create(&sink->writer, NULL, writer_main, sink) != 0) {
+        pthread_cond_destroy(&sink->not_full);
+        pthread_cond_destroy(&sink->not_empty);
+        pthread_mutex_destroy(&sink->lock);
+        free_frame_sink(sink);
+        return NULL;
+    }
+
+    return sink;
+}
+
+bool destroy_frame_sink(FrameSink* sink) {
+    if (!sink) {
+        return false;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    sink->closing = true;
+    pthread_cond_signal(&sink->not_empty);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->writer, NULL);
+
+    bool ok = !sink->failed && fflush(sink->file) == 0;
+    if (sink->owns_file) {
+        ok = fclose(sink->file) == 0 && ok;
+        sink->file = NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write the frame stream\n");
+    }
+
+    pthread_cond_destroy(&sink->not_full);
+    pthread_cond_destroy(&sink->not_empty);
+    pthread_mutex_destroy(&sink->lock);
+    free_frame_sink(sink);
+    return ok;
+}
+
+bool frame_sink_push(FrameSink* sink, PixelBuffer* buffer) {
+    if (buffer->width != sink->width || buffer->height != sink->height) {
+        return false;
+    }
+
+    const Color* pixels = resolve_pixel_buffer(buffer);
+    if (!pixels) {
+        return false;
+    }
+
+    TraceZone zone = trace_begin("frame_sink_push");
+    pthread_mutex_lock(&sink->lock);
+    while (sink->count == sink->queue_depth) {
+        pthread_cond_wait(&sink->not_full, &sink->lock);
+    }
+    int slot = (sink->head + sink->count) % sink->queue_depth;
+    pthread_mutex_unlock(&sink->lock);
+
+    // The slot is outside the queued range, so the writer does not touch it while it is filled
+    memcpy(sink->slots[slot], pixels, (size_t)sink->width * sink->height * sizeof(Color));
+
+    pthread_mutex_lock(&sink->lock);
+    sink->count++;
+    bool ok = !sink->failed;
+    pthread_cond_signal(&sink->not_empty);
+    pthread_mutex_unlock(&sink->lock);
+    trace_end(zone);
+    return ok;
+}
+
+int frame_sink_frames_written(FrameSink* sink) {
+    pthread_mutex_lock(&sink->lock);
+    int written = sink->written;
+    pthread_mutex_unlock(&sink->lock);
+    return written;
+}
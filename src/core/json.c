@@ -0,0 +1,312 @@
+#include "core/json.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Deepest nesting accepted, which bounds the recursion of the parser
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+    const char* text;
+    size_t length;
+    size_t position;
+    JsonToken* tokens;
+    size_t tokenCount;
+    size_t tokenCapacity;
+} JsonParser;
+
+static void skip_whitespace(JsonParser* parser) {
+    while (parser->position < parser->length) {
+        char c = parser->text[parser->position];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        parser->position++;
+    }
+}
+
+// Appends a token and returns its index, or -1 if out of memory
+static long add_token(JsonParser* parser, JsonType type, size_t start) {
+    if (parser->tokenCount == parser->tokenCapacity) {
+        size_t capacity = parser->tokenCapacity ? parser->tokenCapacity * 2 : 64;
+        if (capacity > INT_MAX) {
+            return -1;
+        }
+        JsonToken* tokens = realloc(parser->tokens, capacity * sizeof(JsonToken));
+        if (!tokens) {
+            return -1;
+        }
+        parser->tokens = tokens;
+        parser->tokenCapacity = capacity;
+    }
+
+    parser->tokens[parser->tokenCount] = (JsonToken){type, start, 0, 0, 0};
+    return (long)parser->tokenCount++;
+}
+
+static bool match_literal(JsonParser* parser, const char* literal) {
+    size_t length = strlen(literal);
+    if (parser->length - parser->position < length || memcmp(parser->text + parser->position, literal, length) != 0) {
+        return false;
+    }
+    parser->position += length;
+    return true;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Consumes digits, returning false if there are none
+static bool skip_digits(JsonParser* parser) {
+    size_t start = parser->position;
+    while (parser->position < parser->length && is_digit(parser->text[parser->position])) {
+        parser->position++;
+    }
+    return parser->position > start;
+}
+
+static bool skip_number(JsonParser* parser) {
+    const char* text = parser->text;
+    if (parser->position < parser->length && text[parser->position] == '-') {
+        parser->position++;
+    }
+    if (!skip_digits(parser)) {
+        return false;
+    }
+    if (parser->position < parser->length && text[parser->position] == '.') {
+        parser->position++;
+        if (!skip_digits(parser)) {
+            return false;
+        }
+    }
+    if (parser->position < parser->length && (text[parser->position] == 'e' || text[parser->position] == 'E')) {
+        parser->position++;
+        if (parser->position < parser->length && (text[parser->position] == '+' || text[parser->position] == '-')) {
+            parser->position++;
+        }
+        if (!skip_digits(parser)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Consumes a string whose opening quote has been consumed, up to and including the closing quote
+static bool skip_string(JsonParser* parser) {
+    while (parser->position < parser->length) {
+        unsigned char c = (unsigned char)parser->text[parser->position++];
+        if (c == '"') {
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c == '\\') {
+            if (parser->position == parser->length) {
+                return false;
+            }
+            parser->position++;
+        }
+    }
+    return false;
+}
+
+static bool parse_value(JsonParser* parser, int depth);
+
+// Parses the elements or members of an array or object whose opening bracket has been consumed
+static bool parse_container(JsonParser* parser, long token, bool object, int depth) {
+    char close = object ? '}' : ']';
+    skip_whitespace(parser);
+    if (parser->position < parser->length && parser->text[parser->position] == close) {
+        parser->position++;
+        return true;
+    }
+
+    for (;;) {
+        if (object) {
+            skip_whitespace(parser);
+            if (parser->position == parser->length || parser->text[parser->position] != '"') {
+                return false;
+            }
+            if (!parse_value(parser, depth + 1)) {
+                return false;
+            }
+            skip_whitespace(parser);
+            if (parser->position == parser->length || parser->text[parser->position++] != ':') {
+                return false;
+            }
+        }
+        if (!parse_value(parser, depth + 1)) {
+            return false;
+        }
+        parser->tokens[token].count++;
+
+        skip_whitespace(parser);
+        if (parser->position == parser->length) {
+            return false;
+        }
+        char c = parser->text[parser->position++];
+        if (c == close) {
+            return true;
+        }
+        if (c != ',') {
+            return false;
+        }
+    }
+}
+
+static bool parse_value(JsonParser* parser, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        return false;
+    }
+
+    skip_whitespace(parser);
+    if (parser->position == parser->length) {
+        return false;
+    }
+
+    size_t start = parser->position;
+    char c = parser->text[start];
+    JsonType type;
+    if (c == '{') {
+        type = JSON_OBJECT;
+    } else if (c == '[') {
+        type = JSON_ARRAY;
+    } else if (c == '"') {
+        type = JSON_STRING;
+    } else if (c == 't' || c == 'f') {
+        type = JSON_BOOL;
+    } else if (c == 'n') {
+        type = JSON_NULL;
+    } else {
+        type = JSON_NUMBER;
+    }
+
+    long token = add_token(parser, type, start);
+    if (token < 0) {
+        return false;
+    }
+
+    bool ok;
+    switch (type) {
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            parser->position++;
+            ok = parse_container(parser, token, type == JSON_OBJECT, depth);
+            break;
+        case JSON_STRING:
+            parser->position++;
+            ok = skip_string(parser);
+            break;
+        case JSON_BOOL:
+            ok = match_literal(parser, "true") || match_literal(parser, "false");
+            break;
+        case JSON_NULL:
+            ok = match_literal(parser, "null");
+            break;
+        default:
+            ok = skip_number(parser);
+            break;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    JsonToken* t = &parser->tokens[token];
+    t->length = parser->position - start;
+    if (type == JSON_STRING) {
+        t->start++;
+        t->length -= 2;
+    }
+    t->next = parser->tokenCount;
+    return true;
+}
+
+JsonDocument* json_parse(const char* text, size_t length) {
+    JsonParser parser = {text, length, 0, NULL, 0, 0};
+    bool ok = parse_value(&parser, 0);
+    skip_whitespace(&parser);
+
+    JsonDocument* document = ok && parser.position == length ? malloc(sizeof(JsonDocument)) : NULL;
+    if (!document) {
+        free(parser.tokens);
+        return NULL;
+    }
+
+    document->text = text;
+    document->tokens = parser.tokens;
+    document->tokenCount = parser.tokenCount;
+    return document;
+}
+
+void json_destroy(JsonDocument* document) {
+    if (!document) {
+        return;
+    }
+
+    free(document->tokens);
+    free(document);
+}
+
+int json_object_get(const JsonDocument* document, int object, const char* key) {
+    if (object < 0 || document->tokens[object].type != JSON_OBJECT) {
+        return -1;
+    }
+
+    // Members are key and value pairs; hop over each value with its next index
+    const JsonToken* container = &document->tokens[object];
+    size_t index = (size_t)object + 1;
+    for (size_t i = 0; i < container->count; i++) {
+        size_t value = index + 1;
+        if (json_string_equals(document, (int)index, key)) {
+            return (int)value;
+        }
+        index = document->tokens[value].next;
+    }
+    return -1;
+}
+
+int json_array_get(const JsonDocument* document, int array, size_t index) {
+    if (array < 0 || document->tokens[array].type != JSON_ARRAY || index >= document->tokens[array].count) {
+        return -1;
+    }
+
+    size_t element = (size_t)array + 1;
+    for (size_t i = 0; i < index; i++) {
+        element = document->tokens[element].next;
+    }
+    return (int)element;
+}
+
+size_t json_array_count(const JsonDocument* document, int array) {
+    if (array < 0 || document->tokens[array].type != JSON_ARRAY) {
+        return 0;
+    }
+    return document->tokens[array].count;
+}
+
+double json_number(const JsonDocument* document, int token, double fallback) {
+    if (token < 0 || document->tokens[token].type != JSON_NUMBER) {
+        return fallback;
+    }
+
+    // The text is not null-terminated, so copy the number out for strtod
+    const JsonToken* t = &document->tokens[token];
+    char digits[64];
+    if (t->length >= sizeof(digits)) {
+        return fallback;
+    }
+    memcpy(digits, document->text + t->start, t->length);
+    digits[t->length] = '\0';
+    return strtod(digits, NULL);
+}
+
+bool json_string_equals(const JsonDocument* document, int token, const char* string) {
+    if (token < 0 || document->tokens[token].type != JSON_STRING) {
+        return false;
+    }
+
+    const JsonToken* t = &document->tokens[token];
+    return strlen(string) == t->length && memcmp(document->text + t->start, string, t->length) == 0;
+}
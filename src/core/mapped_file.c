@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 200809L
+#include "core/mapped_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+
+MappedFile* map_file(const char* path) {
+    FILE* stream = fopen(path, "rb");
+    if (!stream) {
+        perror("Failed to open file");
+        return NULL;
+    }
+
+    MappedFile* file = calloc(1, sizeof(MappedFile));
+    if (!file || fseek(stream, 0, SEEK_END) != 0) {
+        free(file);
+        fclose(stream);
+        return NULL;
+    }
+
+    long size = ftell(stream);
+    unsigned char* data = size > 0 ? malloc((size_t)size) : NULL;
+    rewind(stream);
+    if (size < 0 || (size > 0 && (!data || fread(data, 1, (size_t)size, stream) != (size_t)size))) {
+        free(data);
+        free(file);
+        fclose(stream);
+        return NULL;
+    }
+
+    fclose(stream);
+    file->references = 1;
+    file->data = data;
+    file->size = (size_t)size;
+    return file;
+}
+
+void unmap_file(MappedFile* file) {
+    if (!file || --file->references > 0) {
+        return;
+    }
+
+    free(file->data);
+    free(file);
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile* map_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file");
+        return NULL;
+    }
+
+    struct stat info;
+    MappedFile* file = calloc(1, sizeof(MappedFile));
+    if (!file || fstat(fd, &info) != 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    file->references = 1;
+    if (info.st_size > 0) {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Failed to map file");
+            free(file);
+            close(fd);
+            return NULL;
+        }
+        // Loaders read front to back, so ask for aggressive read-ahead
+        posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+        file->data = data;
+        file->size = (size_t)info.st_size;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return file;
+}
+
+void unmap_file(MappedFile* file) {
+    if (!file || --file->references > 0) {
+        return;
+    }
+
+    if (file->data) {
+        munmap(file->data, file->size);
+    }
+    free(file);
+}
+
+#endif
+
+MappedFile* retain_mapped_file(MappedFile* file) {
+    file->references++;
+    return file;
+}
+
+bool mapped_file_contains(const MappedFile* file, const void* pointer) {
+    const unsigned char* bytes = pointer;
+    return file && file->data && bytes >= file->data && bytes < file->data + file->size;
+}
@@ -1,9 +1,23 @@
 #include "core/pixel_buffer.h"
+#include "core/qoi.h"
+#include "core/trace.h"
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+// Trusted writers skip their bounds checks unless PIXEL_BUFFER_DEBUG is defined
+#ifdef PIXEL_BUFFER_DEBUG
+#define PIXEL_BUFFER_ASSERT(condition) assert(condition)
+#else
+#define PIXEL_BUFFER_ASSERT(condition) ((void)0)
+#endif
+
 PixelBuffer* create_pixel_buffer(int width, int height) {
+    return create_pixel_buffer_with_layout(width, height, PIXEL_LAYOUT_LINEAR);
+}
+
+PixelBuffer* create_pixel_buffer_with_layout(int width, int height, PixelLayout layout) {
     PixelBuffer* buffer = malloc(sizeof(PixelBuffer));
     if (!buffer) {
         return NULL;
@@ -11,7 +25,15 @@ PixelBuffer* create_pixel_buffer(int width, int height) {
 
     buffer->width = width;
     buffer->height = height;
-    buffer->pixels = calloc(width * height, sizeof(Color));
+    buffer->layout = layout;
+    buffer->storage_width = width;
+    buffer->storage_height = height;
+    if (layout == PIXEL_LAYOUT_TILED) {
+        buffer->storage_width = (width + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE * PIXEL_TILE_SIZE;
+        buffer->storage_height = (height + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE * PIXEL_TILE_SIZE;
+    }
+    buffer->pixels = calloc((size_t)buffer->storage_width * buffer->storage_height, sizeof(Color));
+    buffer->resolved = NULL;
 
     return buffer;
 }
@@ -22,6 +44,7 @@ void destroy_pixel_buffer(PixelBuffer* buffer) {
     }
 
     free(buffer->pixels);
+    free(buffer->resolved);
     free(buffer);
 }
 
@@ -30,12 +53,37 @@ void clear_buffer(PixelBuffer* buffer, Color clear_color) {
         return;
     }
 
-    for (int i = 0; i < buffer->width; i++) {
-        for (int j = 0; j < buffer->height; j++) {
-            int index = j * buffer->width + i;
-            buffer->pixels[index] = clear_color;
-        }
+    int width = buffer->storage_width;
+    int height = buffer->storage_height;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Every layout fills its whole allocation, so fill the first row and copy it down in memory order
+    TraceZone zone = trace_begin("clear_buffer");
+    Color* first_row = buffer->pixels;
+    for (int x = 0; x < width; x++) {
+        first_row[x] = clear_color;
+    }
+    for (int y = 1; y < height; y++) {
+        memcpy(&buffer->pixels[(size_t)y * width], first_row, width * sizeof(Color));
+    }
+    trace_end(zone);
+}
+
+size_t pixel_index(const PixelBuffer* buffer, int x, int y) {
+    if (buffer->layout == PIXEL_LAYOUT_LINEAR) {
+        return (size_t)y * buffer->width + x;
     }
+
+    // Tile rows hold PIXEL_TILE_SIZE image rows; inside a tile, rows are PIXEL_TILE_SIZE pixels apart
+    size_t tile_row = (size_t)(y / PIXEL_TILE_SIZE) * buffer->storage_width * PIXEL_TILE_SIZE;
+    size_t tile = (size_t)(x / PIXEL_TILE_SIZE) * PIXEL_TILE_SIZE * PIXEL_TILE_SIZE;
+    return tile_row + tile + (y % PIXEL_TILE_SIZE) * PIXEL_TILE_SIZE + x % PIXEL_TILE_SIZE;
+}
+
+int pixel_row_step(const PixelBuffer* buffer) {
+    return buffer->layout == PIXEL_LAYOUT_LINEAR ? buffer->width : PIXEL_TILE_SIZE;
 }
 
 void set_pixel(PixelBuffer* buffer, int x, int y, Color color) {
@@ -51,8 +99,33 @@ void set_pixel(PixelBuffer* buffer, int x, int y, Color color) {
         return;
     }
 
-    int index = y * buffer->width + x;
-    buffer->pixels[index] = color;
+    buffer->pixels[pixel_index(buffer, x, y)] = color;
+}
+
+void set_pixel_unchecked(PixelBuffer* buffer, int x, int y, Color color) {
+    PIXEL_BUFFER_ASSERT(buffer && x >= 0 && x < buffer->width && y >= 0 && y < buffer->height);
+    buffer->pixels[pixel_index(buffer, x, y)] = color;
+}
+
+void fill_span(PixelBuffer* buffer, int x0, int x1, int y, Color color) {
+    PIXEL_BUFFER_ASSERT(buffer && x0 >= 0 && x1 < buffer->width && y >= 0 && y < buffer->height);
+
+    // Runs are contiguous up to the end of the row, or of the tile in the tiled layout
+    int run = buffer->layout == PIXEL_LAYOUT_LINEAR ? buffer->width : PIXEL_TILE_SIZE;
+    while (x0 <= x1) {
+        int end = (x0 / run + 1) * run - 1;
+        end = end < x1 ? end : x1;
+        Color* pixels = &buffer->pixels[pixel_index(buffer, x0, y)];
+        for (int i = 0; i <= end - x0; i++) {
+            pixels[i] = color;
+        }
+        x0 = end + 1;
+    }
+}
+
+Color* pixel_row(PixelBuffer* buffer, int y) {
+    PIXEL_BUFFER_ASSERT(buffer && buffer->layout == PIXEL_LAYOUT_LINEAR && y >= 0 && y < buffer->height);
+    return &buffer->pixels[(size_t)y * buffer->width];
 }
 
 Color get_pixel(PixelBuffer* buffer, int x, int y) {
@@ -70,26 +143,96 @@ Color get_pixel(PixelBuffer* buffer, int x, int y) {
         return black;
     }
 
-    int index = y * buffer->width + x;
-    return buffer->pixels[index];
+    return buffer->pixels[pixel_index(buffer, x, y)];
 }
 
-void save_to_ppm(PixelBuffer* buffer, const char* filename) {
-    FILE* file = fopen(filename, "w");
+const Color* resolve_pixel_buffer(PixelBuffer* buffer) {
+    if (buffer->layout == PIXEL_LAYOUT_LINEAR) {
+        return buffer->pixels;
+    }
+
+    if (!buffer->resolved) {
+        buffer->resolved = malloc((size_t)buffer->width * buffer->height * sizeof(Color));
+        if (!buffer->resolved) {
+            return NULL;
+        }
+    }
+
+    // Copy one tile row at a time: each tile contributes PIXEL_TILE_SIZE short runs to consecutive image rows
+    for (int tile_y = 0; tile_y < buffer->height; tile_y += PIXEL_TILE_SIZE) {
+        int rows = buffer->height - tile_y < PIXEL_TILE_SIZE ? buffer->height - tile_y : PIXEL_TILE_SIZE;
+        for (int tile_x = 0; tile_x < buffer->width; tile_x += PIXEL_TILE_SIZE) {
+            int cols = buffer->width - tile_x < PIXEL_TILE_SIZE ? buffer->width - tile_x : PIXEL_TILE_SIZE;
+            const Color* tile = &buffer->pixels[pixel_index(buffer, tile_x, tile_y)];
+            for (int j = 0; j < rows; j++) {
+                memcpy(&buffer->resolved[(size_t)(tile_y + j) * buffer->width + tile_x],
+                       tile + j * PIXEL_TILE_SIZE, cols * sizeof(Color));
+            }
+        }
+    }
+    return buffer->resolved;
+}
+
+// Writes a whole encoded image with one fwrite
+static bool write_file(const char* filename, const unsigned char* data, size_t size) {
+    FILE* file = fopen(filename, "wb");
     if (!file) {
         perror("Failed to open file");
-        return;
+        return false;
     }
 
-    fprintf(file, "P3\n%d %d\n255\n", buffer->width, buffer->height);
+    bool ok = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        perror("Failed to write file");
+    }
+    return ok;
+}
 
-    for (int y = 0; y < buffer->height; y++) {
-        for (int x = 0; x < buffer->width; x++) {
-            Color pixel = buffer->pixels[y * buffer->width + x];
-            fprintf(file, "%d %d %d ", pixel.r, pixel.g, pixel.b);
-        }
-        fprintf(file, "\n");
+bool save_to_ppm(PixelBuffer* buffer, const char* filename) {
+    const Color* pixels = resolve_pixel_buffer(buffer);
+    if (!pixels) {
+        return false;
+    }
+
+    // Binary P6: the header followed by packed RGB bytes, built in memory and written at once
+    char header[64];
+    int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", buffer->width, buffer->height);
+    size_t pixel_count = (size_t)buffer->width * buffer->height;
+    size_t size = (size_t)header_size + pixel_count * 3;
+    unsigned char* data = malloc(size);
+    if (!data) {
+        return false;
+    }
+
+    memcpy(data, header, header_size);
+    unsigned char* rgb = data + header_size;
+    for (size_t i = 0; i < pixel_count; i++) {
+        rgb[i * 3 + 0] = pixels[i].r;
+        rgb[i * 3 + 1] = pixels[i].g;
+        rgb[i * 3 + 2] = pixels[i].b;
+    }
+
+    bool ok = write_file(filename, data, size);
+    free(data);
+    return ok;
+}
+
+bool save_to_qoi(PixelBuffer* buffer, const char* filename) {
+    const Color* pixels = resolve_pixel_buffer(buffer);
+    if (!pixels) {
+        return false;
+    }
+
+    size_t size;
+    unsigned char* data = qoi_encode(pixels, buffer->width, buffer->height, &size);
+    if (!data) {
+        return false;
     }
 
-    fclose(file);
+    bool ok = write_file(filename, data, size);
+    free(data);
+    return ok;
 }
\ No newline at end of file
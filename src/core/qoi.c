@@ -0,0 +1,204 @@
+#include "core/qoi.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Chunk tags; the 2-bit tags share their top bits with the 8-bit RGB and RGBA tags
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_MASK_2   0xc0
+
+// Longest run one chunk can hold; 63 and 64 would collide with the RGB and RGBA tags
+#define QOI_MAX_RUN 62
+
+// Images larger than this many pixels are rejected, as the reference implementation does
+#define QOI_PIXELS_MAX 400000000u
+
+static const unsigned char QOI_END_MARKER[QOI_END_MARKER_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static int qoi_hash(Color c) {
+    return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) % 64;
+}
+
+static bool colors_equal(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void write_u32_be(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static uint32_t read_u32_be(const unsigned char* in) {
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+}
+
+unsigned char* qoi_encode(const Color* pixels, int width, int height, size_t* out_size) {
+    if (width <= 0 || height <= 0 || (uint64_t)width * (uint64_t)height > QOI_PIXELS_MAX) {
+        return NULL;
+    }
+
+    // Worst case every pixel is a full RGBA chunk
+    size_t pixel_count = (size_t)width * height;
+    unsigned char* out = malloc(QOI_HEADER_SIZE + pixel_count * 5 + QOI_END_MARKER_SIZE);
+    if (!out) {
+        return NULL;
+    }
+
+    memcpy(out, "qoif", 4);
+    write_u32_be(out + 4, (uint32_t)width);
+    write_u32_be(out + 8, (uint32_t)height);
+    out[12] = 4;    // RGBA
+    out[13] = 0;    // sRGB with linear alpha
+    size_t p = QOI_HEADER_SIZE;
+
+    Color index[64];
+    memset(index, 0, sizeof(index));
+    Color previous = {0, 0, 0, 255};
+    int run = 0;
+
+    for (size_t i = 0; i < pixel_count; i++) {
+        Color pixel = pixels[i];
+
+        if (colors_equal(pixel, previous)) {
+            run++;
+            if (run == QOI_MAX_RUN || i + 1 == pixel_count) {
+                out[p++] = (unsigned char)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            out[p++] = (unsigned char)(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        int hash = qoi_hash(pixel);
+        if (colors_equal(index[hash], pixel)) {
+            out[p++] = (unsigned char)(QOI_OP_INDEX | hash);
+        } else if (pixel.a != previous.a) {
+            index[hash] = pixel;
+            out[p++] = QOI_OP_RGBA;
+            out[p++] = pixel.r;
+            out[p++] = pixel.g;
+            out[p++] = pixel.b;
+            out[p++] = pixel.a;
+        } else {
+            index[hash] = pixel;
+            signed char dr = (signed char)(pixel.r - previous.r);
+            signed char dg = (signed char)(pixel.g - previous.g);
+            signed char db = (signed char)(pixel.b - previous.b);
+            signed char dr_dg = (signed char)(dr - dg);
+            signed char db_dg = (signed char)(db - dg);
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                out[p++] = (unsigned char)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                out[p++] = (unsigned char)(QOI_OP_LUMA | (dg + 32));
+                out[p++] = (unsigned char)((dr_dg + 8) << 4 | (db_dg + 8));
+            } else {
+                out[p++] = QOI_OP_RGB;
+                out[p++] = pixel.r;
+                out[p++] = pixel.g;
+                out[p++] = pixel.b;
+            }
+        }
+        previous = pixel;
+    }
+
+    memcpy(out + p, QOI_END_MARKER, QOI_END_MARKER_SIZE);
+    p += QOI_END_MARKER_SIZE;
+
+    *out_size = p;
+    return out;
+}
+
+Color* qoi_decode(const unsigned char* data, size_t size, int* out_width, int* out_height) {
+    if (size < QOI_HEADER_SIZE + QOI_END_MARKER_SIZE || memcmp(data, "qoif", 4) != 0) {
+        return NULL;
+    }
+
+    uint32_t width = read_u32_be(data + 4);
+    uint32_t height = read_u32_be(data + 8);
+    unsigned char channels = data[12];
+    if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX ||
+        (uint64_t)width * height > QOI_PIXELS_MAX || (channels != 3 && channels != 4)) {
+        return NULL;
+    }
+
+    size_t pixel_count = (size_t)width * height;
+    Color* pixels = malloc(pixel_count * sizeof(Color));
+    if (!pixels) {
+        return NULL;
+    }
+
+    Color index[64];
+    memset(index, 0, sizeof(index));
+    Color pixel = {0, 0, 0, 255};
+    size_t chunks_end = size - QOI_END_MARKER_SIZE;
+    size_t p = QOI_HEADER_SIZE;
+    int run = 0;
+    bool truncated = false;
+
+    for (size_t i = 0; i < pixel_count; i++) {
+        if (run > 0) {
+            run--;
+            pixels[i] = pixel;
+            continue;
+        }
+
+        // Each chunk must end before the end marker; RGB and RGBA chunks carry 3 and 4 more bytes
+        unsigned char tag = p < chunks_end ? data[p] : 0;
+        size_t chunk_size = tag == QOI_OP_RGB ? 4 : tag == QOI_OP_RGBA ? 5 : (tag & QOI_MASK_2) == QOI_OP_LUMA ? 2 : 1;
+        if (p + chunk_size > chunks_end) {
+            truncated = true;
+            break;
+        }
+        p++;
+
+        if (tag == QOI_OP_RGB) {
+            pixel.r = data[p++];
+            pixel.g = data[p++];
+            pixel.b = data[p++];
+        } else if (tag == QOI_OP_RGBA) {
+            pixel.r = data[p++];
+            pixel.g = data[p++];
+            pixel.b = data[p++];
+            pixel.a = data[p++];
+        } else if ((tag & QOI_MASK_2) == QOI_OP_INDEX) {
+            pixel = index[tag];
+        } else if ((tag & QOI_MASK_2) == QOI_OP_DIFF) {
+            pixel.r += ((tag >> 4) & 0x03) - 2;
+            pixel.g += ((tag >> 2) & 0x03) - 2;
+            pixel.b += (tag & 0x03) - 2;
+        } else if ((tag & QOI_MASK_2) == QOI_OP_LUMA) {
+            unsigned char next = data[p++];
+            int dg = (tag & 0x3f) - 32;
+            pixel.r += dg - 8 + ((next >> 4) & 0x0f);
+            pixel.g += dg;
+            pixel.b += dg - 8 + (next & 0x0f);
+        } else {
+            run = tag & 0x3f;
+        }
+
+        index[qoi_hash(pixel)] = pixel;
+        pixels[i] = pixel;
+    }
+
+    if (truncated) {
+        free(pixels);
+        return NULL;
+    }
+
+    *out_width = (int)width;
+    *out_height = (int)height;
+    return pixels;
+}
@@ -0,0 +1,195 @@
+#include "core/trace.h"
+#include "core/timer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    double start;
+    double end;
+} TraceEvent;
+
+// The zones one thread recorded during the open trace. Each thread appends to its own
+// record without locking; the records are only read when the trace is closed.
+typedef struct TraceThread {
+    int id;
+    const char* name;
+    TraceEvent* events;
+    size_t count;
+    size_t capacity;
+    struct TraceThread* next;
+} TraceThread;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool trace_recording;
+static atomic_uint trace_session;   // Bumped on every close so threads drop records that were freed
+static TraceThread* trace_threads;
+static int trace_thread_count;
+static double trace_origin;
+static char* trace_path;
+
+static _Thread_local TraceThread* local_thread;
+static _Thread_local unsigned local_session;
+static _Thread_local const char* local_name;
+
+bool trace_open(const char* path) {
+    pthread_mutex_lock(&trace_lock);
+    if (atomic_load(&trace_recording)) {
+        pthread_mutex_unlock(&trace_lock);
+        return false;
+    }
+
+    size_t length = strlen(path);
+    trace_path = malloc(length + 1);
+    if (!trace_path) {
+        pthread_mutex_unlock(&trace_lock);
+        return false;
+    }
+    memcpy(trace_path, path, length + 1);
+
+    trace_origin = timer_now();
+    atomic_store(&trace_recording, true);
+    pthread_mutex_unlock(&trace_lock);
+    return true;
+}
+
+bool trace_enabled(void) {
+    return atomic_load_explicit(&trace_recording, memory_order_relaxed);
+}
+
+// Returns the calling thread's record for the open trace, creating it on first use
+static TraceThread* current_thread(void) {
+    unsigned session = atomic_load(&trace_session);
+    if (local_thread && local_session == session) {
+        return local_thread;
+    }
+
+    TraceThread* thread = calloc(1, sizeof(TraceThread));
+    if (!thread) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&trace_lock);
+    thread->id = trace_thread_count++;
+    thread->name = local_name;
+    thread->next = trace_threads;
+    trace_threads = thread;
+    pthread_mutex_unlock(&trace_lock);
+
+    local_thread = thread;
+    local_session = session;
+    return thread;
+}
+
+void trace_set_thread_name(const char* name) {
+    local_name = name;
+    if (local_thread && local_session == atomic_load(&trace_session)) {
+        local_thread->name = name;
+    }
+}
+
+TraceZone trace_begin(const char* name) {
+    TraceZone zone = { name, 0.0 };
+    if (trace_enabled()) {
+        zone.start = timer_now();
+    }
+    return zone;
+}
+
+void trace_end(TraceZone zone) {
+    if (!trace_enabled() || zone.start == 0.0) {
+        return;
+    }
+
+    double end = timer_now();
+    TraceThread* thread = current_thread();
+    if (!thread) {
+        return;
+    }
+
+    if (thread->count == thread->capacity) {
+        size_t capacity = thread->capacity ? thread->capacity * 2 : 256;
+        TraceEvent* events = realloc(thread->events, capacity * sizeof(*events));
+        if (!events) {
+            return;
+        }
+        thread->events = events;
+        thread->capacity = capacity;
+    }
+
+    thread->events[thread->count++] = (TraceEvent){ zone.name, zone.start, end };
+}
+
+static void write_json_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+// Writes the trace in the Chrome trace event format: one complete event per zone, with
+// timestamps in microseconds since the trace was opened, and a name for every thread's lane
+static bool write_trace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    for (const TraceThread* thread = trace_threads; thread; thread = thread->next) {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ",
+                first ? "" : ",\n", thread->id);
+        if (thread->name) {
+            write_json_string(file, thread->name);
+        } else {
+            fprintf(file, "\"thread %d\"", thread->id);
+        }
+        fprintf(file, "}}");
+        first = false;
+
+        for (size_t i = 0; i < thread->count; i++) {
+            const TraceEvent* event = &thread->events[i];
+            fprintf(file, ",\n{\"name\": ");
+            write_json_string(file, event->name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    thread->id, (event->start - trace_origin) * 1e6, (event->end - event->start) * 1e6);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+bool trace_close(void) {
+    pthread_mutex_lock(&trace_lock);
+    if (!atomic_load(&trace_recording)) {
+        pthread_mutex_unlock(&trace_lock);
+        return false;
+    }
+    atomic_store(&trace_recording, false);
+
+    bool ok = write_trace(trace_path);
+
+    while (trace_threads) {
+        TraceThread* next = trace_threads->next;
+        free(trace_threads->events);
+        free(trace_threads);
+        trace_threads = next;
+    }
+    trace_thread_count = 0;
+    atomic_fetch_add(&trace_session, 1);
+    free(trace_path);
+    trace_path = NULL;
+
+    pthread_mutex_unlock(&trace_lock);
+    return ok;
+}
@@ -0,0 +1,695 @@
+#include <ctype.h>
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/pixel_buffer.h"
+#include "core/camera.h"
+#include "core/frame_sink.h"
+#include "core/timer.h"
+#include "core/trace.h"
+#include "mesh/gltf.h"
+#include "mesh/mesh_cache.h"
+#include "mesh/mesh_optimize.h"
+#include "render/clear_tiles.h"
+#include "render/depth_buffer.h"
+#include "render/overdraw.h"
+#include "render/raster.h"
+#include "render/render_stats.h"
+#include "render/scene.h"
+
+#define DEFAULT_WIDTH 800
+#define DEFAULT_HEIGHT 600
+#define DEFAULT_FRAMES 1
+#define DEFAULT_BENCH_FRAMES 300
+#define FRAME_RATE 60
+#define FRAME_TIME_STEP (1.0f / FRAME_RATE)
+#define STREAM_QUEUE_DEPTH 3
+#define CAMERA_FOV 45.0f
+#define CAMERA_NEAR 0.1f
+#define CAMERA_FAR 100.0f
+
+// Options accepted on the command line
+typedef struct {
+    int width;
+    int height;
+    int frames;
+    SceneType scene;
+    const char* mesh;
+    const char* write_mesh;
+    bool optimize;
+    bool vertex_arrays;
+    const char* output;
+    const char* stream;
+    FrameSinkFormat stream_format;
+    const char* trace;
+    bool bench;
+    int threads;
+    const char* simd;
+    bool hiz;
+    bool stats;
+    bool overdraw;
+    OverdrawCounter overdraw_counter;
+    int overdraw_scale;
+    CullMode cull_mode;
+    PixelLayout layout;
+    DepthFormat depth_format;
+} HeadlessOptions;
+
+// Per-frame measurements collected in benchmark mode
+typedef struct {
+    double* frame_seconds;
+    size_t triangles;
+    size_t pixels;
+} BenchResults;
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --width N        Framebuffer width in pixels (default %d)\n"
+        "  --height N       Framebuffer height in pixels (default %d)\n"
+        "  --frames N       Number of frames to render (default %d, %d with --bench)\n"
+        "  --scene NAME     Scene to render: default, grid, layers (default: default)\n"
+        "  --mesh PATH      Render a mesh loaded from an OBJ, binary STL or PLY file, or a\n"
+        "                   .rmesh cache, or the meshes of a .glb scene, instead of a\n"
+        "                   built-in scene\n"
+        "  --write-mesh PATH  Save the mesh loaded with --mesh as a .rmesh cache\n"
+        "  --no-optimize    Keep the triangle and vertex order of a loaded mesh instead of\n"
+        "                   reordering it for vertex cache locality and less overdraw\n"
+        "  --output PATH    Save the last frame as binary PPM, or as QOI if PATH ends\n"
+        "                   in .qoi; a printf pattern such as frame_%%04d.ppm saves\n"
+        "                   every frame instead; it must hold exactly one %%d or %%0Nd,\n"
+        "                   and a literal '%%' is written %%%%\n"
+        "  --stream PATH    Stream every frame to a file, FIFO or stdout (-) while rendering\n"
+        "  --stream-format FORMAT  Streamed frame encoding: y4m, rgba (default: y4m)\n"
+        "  --threads N      Rasterize in %dx%d tiles on N threads (default: draw serially)\n"
+        "  --simd NAME      Block rasterizer and vertex transform: scalar, sse2, avx2, auto\n"
+        "                   (default: auto)\n"
+        "  --vertex-layout NAME  Vertex positions transformed from interleaved vertices (aos)\n"
+        "                   or separate arrays (soa) (default: soa)\n"
+        "  --cull MODE      Faces to cull: back, front, none (default: back)\n"
+        "  --layout NAME    Framebuffer memory layout: linear, tiled (default: linear)\n"
+        "  --depth FORMAT   Depth buffer format: float32, reversed, unorm24, unorm16 (default: float32)\n"
+        "  --overdraw WHICH Replace each frame with a heatmap of the fragments tested or written per pixel\n"
+        "  --overdraw-scale N  Count shown as red in the heatmap (default: the frame's maximum)\n"
+        "  --hiz            Skip hidden %dx%d tiles and %dx%d blocks with a hierarchical depth buffer\n"
+        "  --bench          Render a fixed camera path and print frame timings as JSON\n"
+        "  --trace PATH     Record a Chrome trace of every frame, one lane per thread, to PATH\n"
+        "  --stats          Print per-frame counters and stage timings to stderr (needs make STATS=1)\n"
+        "  --help           Show this message\n",
+        program, DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_FRAMES, DEFAULT_BENCH_FRAMES,
+        RENDER_TILE_SIZE, RENDER_TILE_SIZE, HIZ_TILE_SIZE, HIZ_TILE_SIZE, HIZ_BLOCK_SIZE, HIZ_BLOCK_SIZE);
+}
+
+static int parse_positive_int(const char* text, int* out) {
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value <= 0 || value > 1 << 16) {
+        return 0;
+    }
+    *out = (int)value;
+    return 1;
+}
+
+static int parse_cull_mode(const char* text, CullMode* out) {
+    if (strcmp(text, "back") == 0) {
+        *out = CULL_BACK;
+    } else if (strcmp(text, "front") == 0) {
+        *out = CULL_FRONT;
+    } else if (strcmp(text, "none") == 0) {
+        *out = CULL_NONE;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static int parse_layout(const char* text, PixelLayout* out) {
+    if (strcmp(text, "linear") == 0) {
+        *out = PIXEL_LAYOUT_LINEAR;
+    } else if (strcmp(text, "tiled") == 0) {
+        *out = PIXEL_LAYOUT_TILED;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// An output path with a '%' is a per-frame pattern. It is later used as a printf format, so it
+// must hold exactly one %d, optionally zero-padded to a width, and no other conversion but %%.
+static int is_frame_pattern(const char* text) {
+    int conversions = 0;
+    for (const char* c = text; *c; c++) {
+        if (*c != '%') {
+            continue;
+        }
+        c++;
+        if (*c == '%') {
+            continue;
+        }
+        if (*c == '0') {
+            c++;
+        }
+        for (int digits = 0; *c >= '0' && *c <= '9'; c++) {
+            if (++digits > 3) {
+                return 0;
+            }
+        }
+        if (*c != 'd') {
+            return 0;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static int parse_options(int argc, char** argv, HeadlessOptions* options) {
+    options->width = DEFAULT_WIDTH;
+    options->height = DEFAULT_HEIGHT;
+    options->frames = 0;
+    options->scene = SCENE_DEFAULT;
+    options->mesh = NULL;
+    options->write_mesh = NULL;
+    options->optimize = true;
+    options->vertex_arrays = true;
+    options->output = NULL;
+    options->stream = NULL;
+    options->stream_format = FRAME_SINK_Y4M;
+    options->trace = NULL;
+    options->bench = false;
+    options->threads = 0;
+    options->simd = "auto";
+    options->hiz = false;
+    options->stats = false;
+    options->overdraw = false;
+    options->overdraw_counter = OVERDRAW_WRITTEN;
+    options->overdraw_scale = 0;
+    options->cull_mode = CULL_BACK;
+    options->layout = PIXEL_LAYOUT_LINEAR;
+    options->depth_format = DEPTH_FORMAT_FLOAT32;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0) {
+            return 0;
+        }
+
+        if (strcmp(arg, "--bench") == 0) {
+            options->bench = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--hiz") == 0) {
+            options->hiz = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--no-optimize") == 0) {
+            options->optimize = false;
+            continue;
+        }
+
+        if (strcmp(arg, "--stats") == 0) {
+            if (!RENDER_STATS_ENABLED) {
+                fprintf(stderr, "--stats needs a build with stats compiled in (make STATS=1)\n");
+                return 0;
+            }
+            options->stats = true;
+            continue;
+        }
+
+        bool known = strcmp(arg, "--width") == 0 || strcmp(arg, "--height") == 0 ||
+                     strcmp(arg, "--frames") == 0 || strcmp(arg, "--scene") == 0 ||
+                     strcmp(arg, "--mesh") == 0 || strcmp(arg, "--write-mesh") == 0 ||
+                     strcmp(arg, "--output") == 0 || strcmp(arg, "--threads") == 0 ||
+                     strcmp(arg, "--simd") == 0 || strcmp(arg, "--cull") == 0 ||
+                     strcmp(arg, "--layout") == 0 || strcmp(arg, "--depth") == 0 ||
+                     strcmp(arg, "--trace") == 0 || strcmp(arg, "--overdraw") == 0 ||
+                     strcmp(arg, "--overdraw-scale") == 0 || strcmp(arg, "--stream") == 0 ||
+                     strcmp(arg, "--stream-format") == 0 || strcmp(arg, "--vertex-layout") == 0;
+        if (!known) {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 0;
+        }
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 0;
+        }
+
+        bool ok;
+        if (strcmp(arg, "--width") == 0) {
+            ok = parse_positive_int(value, &options->width);
+        } else if (strcmp(arg, "--height") == 0) {
+            ok = parse_positive_int(value, &options->height);
+        } else if (strcmp(arg, "--frames") == 0) {
+            ok = parse_positive_int(value, &options->frames);
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = parse_positive_int(value, &options->threads);
+        } else if (strcmp(arg, "--scene") == 0) {
+            ok = scene_type_from_string(value, &options->scene);
+        } else if (strcmp(arg, "--cull") == 0) {
+            ok = parse_cull_mode(value, &options->cull_mode);
+        } else if (strcmp(arg, "--layout") == 0) {
+            ok = parse_layout(value, &options->layout);
+        } else if (strcmp(arg, "--depth") == 0) {
+            ok = depth_format_from_string(value, &options->depth_format);
+        } else if (strcmp(arg, "--simd") == 0) {
+            RasterPath path;
+            options->simd = value;
+            ok = strcmp(value, "auto") == 0 || raster_path_from_string(value, &path);
+        } else if (strcmp(arg, "--vertex-layout") == 0) {
+            options->vertex_arrays = strcmp(value, "soa") == 0;
+            ok = options->vertex_arrays || strcmp(value, "aos") == 0;
+        } else if (strcmp(arg, "--overdraw") == 0) {
+            options->overdraw = true;
+            ok = overdraw_counter_from_string(value, &options->overdraw_counter);
+        } else if (strcmp(arg, "--overdraw-scale") == 0) {
+            ok = parse_positive_int(value, &options->overdraw_scale);
+        } else if (strcmp(arg, "--mesh") == 0) {
+            options->mesh = value;
+            ok = true;
+        } else if (strcmp(arg, "--write-mesh") == 0) {
+            options->write_mesh = value;
+            ok = true;
+        } else if (strcmp(arg, "--stream") == 0) {
+            options->stream = value;
+            ok = true;
+        } else if (strcmp(arg, "--stream-format") == 0) {
+            ok = frame_sink_format_from_string(value, &options->stream_format);
+        } else if (strcmp(arg, "--trace") == 0) {
+            options->trace = value;
+            ok = true;
+        } else {
+            options->output = value;
+            ok = !strchr(value, '%') || is_frame_pattern(value);
+        }
+
+        if (!ok) {
+            fprintf(stderr, "Invalid value for %s: %s\n", arg, value);
+            return 0;
+        }
+        i++;
+    }
+
+    if (options->write_mesh && !options->mesh) {
+        fprintf(stderr, "--write-mesh needs a mesh loaded with --mesh\n");
+        return 0;
+    }
+
+    // The benchmark report goes to stdout, so frames cannot be streamed there too
+    if (options->bench && options->stream && strcmp(options->stream, "-") == 0) {
+        fprintf(stderr, "--bench cannot be combined with --stream -\n");
+        return 0;
+    }
+
+    if (options->frames == 0) {
+        options->frames = options->bench ? DEFAULT_BENCH_FRAMES : DEFAULT_FRAMES;
+    }
+
+    return 1;
+}
+
+// Case-insensitive check of a file name's extension, given with its dot
+static bool has_extension(const char* filename, const char* extension) {
+    size_t length = strlen(filename);
+    size_t extension_length = strlen(extension);
+    if (length < extension_length) {
+        return false;
+    }
+
+    const char* suffix = filename + length - extension_length;
+    for (size_t i = 0; i < extension_length; i++) {
+        if (tolower((unsigned char)suffix[i]) != tolower((unsigned char)extension[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Saves as QOI when the path ends in .qoi and as binary PPM otherwise
+static bool save_image(PixelBuffer* buffer, const char* filename) {
+    bool ok = has_extension(filename, ".qoi") ? save_to_qoi(buffer, filename) : save_to_ppm(buffer, filename);
+    if (!ok) {
+        fprintf(stderr, "Failed to save the frame to %s\n", filename);
+    }
+    return ok;
+}
+
+// Returns false if the frame had to be saved and could not be
+static bool save_frame(const HeadlessOptions* options, PixelBuffer* buffer, int frame) {
+    if (!options->output) {
+        return true;
+    }
+
+    if (strchr(options->output, '%')) {
+        char filename[1024];
+        int length = snprintf(filename, sizeof(filename), options->output, frame);
+        if (length < 0 || (size_t)length >= sizeof(filename)) {
+            fprintf(stderr, "The file name for frame %d is too long\n", frame);
+            return false;
+        }
+        return save_image(buffer, filename);
+    } else if (frame == options->frames - 1) {
+        return save_image(buffer, options->output);
+    }
+    return true;
+}
+
+// Loads every mesh instanced by the default scene of a .glb file. Each primitive is converted
+// and reordered once, however many nodes draw it.
+static Scene* load_gltf_scene(const HeadlessOptions* options) {
+    if (options->write_mesh) {
+        fprintf(stderr, "--write-mesh saves a single mesh and cannot be used with a .glb scene\n");
+        return NULL;
+    }
+
+    double start = timer_now();
+    GltfModel* model = load_gltf_model(options->mesh);
+    if (!model) {
+        return NULL;
+    }
+
+    Mesh** by_primitive = calloc(model->primitiveCount + 1, sizeof(Mesh*));
+    Mesh** meshes = calloc(model->primitiveCount + 1, sizeof(Mesh*));
+    MeshInstance* instances = calloc(model->instanceCount + 1, sizeof(MeshInstance));
+    size_t mesh_count = 0;
+    size_t triangles = 0;
+    bool ok = by_primitive && meshes && instances;
+    for (size_t i = 0; ok && i < model->instanceCount; i++) {
+        size_t primitive = model->instances[i].primitive;
+        if (!by_primitive[primitive]) {
+            by_primitive[primitive] = gltf_primitive_to_mesh(model, primitive);
+            if (!by_primitive[primitive]) {
+                ok = false;
+                break;
+            }
+            if (options->optimize) {
+                optimize_mesh(by_primitive[primitive]);
+            }
+            meshes[mesh_count++] = by_primitive[primitive];
+        }
+        instances[i] = (MeshInstance){by_primitive[primitive], model->instances[i].transform};
+        triangles += by_primitive[primitive]->indexCount / 3;
+    }
+
+    Scene* scene = NULL;
+    if (ok) {
+        fprintf(stderr, "Loaded %s: %zu meshes, %zu instances, %zu triangles in %.3f s\n",
+                options->mesh, mesh_count, model->instanceCount, triangles, timer_now() - start);
+        scene = create_mesh_instances_scene(meshes, mesh_count, instances, model->instanceCount);
+        if (!scene) {
+            fprintf(stderr, "The scene in %s has nothing to draw, or more than %d meshes or %d instances\n",
+                    options->mesh, SCENE_MAX_MESHES, SCENE_MAX_OBJECTS);
+        }
+    } else {
+        for (size_t i = 0; i < mesh_count; i++) {
+            destroy_mesh(meshes[i]);
+        }
+    }
+
+    // Meshes that use indices in place keep the file mapped after the model is gone
+    free(by_primitive);
+    free(meshes);
+    free(instances);
+    destroy_gltf_model(model);
+    return scene;
+}
+
+// Loads the mesh given with --mesh, parsing text formats on as many threads as rasterize,
+// reorders it for drawing, and writes it back out as a cache if asked to. Caches hold the mesh
+// as it was written, already reordered, so they are drawn as they are.
+static Scene* load_mesh_scene(const HeadlessOptions* options) {
+    double start = timer_now();
+    Mesh* mesh;
+    if (has_extension(options->mesh, ".rmesh")) {
+        mesh = load_mesh_cache(options->mesh);
+    } else if (has_extension(options->mesh, ".stl")) {
+        mesh = load_mesh_from_stl(options->mesh);
+    } else if (has_extension(options->mesh, ".ply")) {
+        mesh = load_mesh_from_ply(options->mesh);
+    } else {
+        mesh = load_mesh_from_obj_parallel(options->mesh, options->threads > 0 ? options->threads : 1);
+    }
+    if (!mesh) {
+        return NULL;
+    }
+
+    fprintf(stderr, "Loaded %s: %zu vertices, %zu triangles in %.3f s\n",
+            options->mesh, mesh->vertexCount, mesh->indexCount / 3, timer_now() - start);
+
+    if (options->optimize && !has_extension(options->mesh, ".rmesh")) {
+        start = timer_now();
+        float before = mesh_cache_miss_ratio(mesh, MESH_OPTIMIZE_CACHE_SIZE);
+        if (optimize_mesh(mesh)) {
+            fprintf(stderr, "Reordered the mesh in %.3f s: %.3f vertex cache misses per triangle, down from %.3f\n",
+                    timer_now() - start, mesh_cache_miss_ratio(mesh, MESH_OPTIMIZE_CACHE_SIZE), before);
+        }
+    }
+
+    if (options->write_mesh && !save_mesh_cache(mesh, options->write_mesh)) {
+        destroy_mesh(mesh);
+        return NULL;
+    }
+    return create_mesh_scene(mesh);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_bench_results(const HeadlessOptions* options, BenchResults* results) {
+    int n = options->frames;
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        total += results->frame_seconds[i];
+    }
+
+    qsort(results->frame_seconds, n, sizeof(double), compare_doubles);
+    double min_ms    = results->frame_seconds[0] * 1000.0;
+    double median_ms = results->frame_seconds[n / 2] * 1000.0;
+    double p99_ms    = results->frame_seconds[(int)ceil(0.99 * n) - 1] * 1000.0;
+    double mean_ms   = total / n * 1000.0;
+
+    printf("{\n");
+    printf("  \"scene\": \"%s\",\n", options->mesh ? "mesh" : scene_type_name(options->scene));
+    printf("  \"width\": %d,\n", options->width);
+    printf("  \"height\": %d,\n", options->height);
+    printf("  \"frames\": %d,\n", n);
+    printf("  \"threads\": %d,\n", options->threads);
+    printf("  \"hiz\": %s,\n", options->hiz ? "true" : "false");
+    printf("  \"simd\": \"%s\",\n", raster_path_name(raster_get_path()));
+    printf("  \"vertex_layout\": \"%s\",\n", options->vertex_arrays ? "soa" : "aos");
+    printf("  \"layout\": \"%s\",\n", options->layout == PIXEL_LAYOUT_TILED ? "tiled" : "linear");
+    printf("  \"depth\": \"%s\",\n", depth_format_name(options->depth_format));
+    printf("  \"frame_ms\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"mean\": %.4f},\n",
+           min_ms, median_ms, p99_ms, mean_ms);
+    printf("  \"triangles_per_frame\": %.1f,\n", (double)results->triangles / n);
+    printf("  \"pixels_per_frame\": %.1f,\n", (double)results->pixels / n);
+    printf("  \"triangles_per_second\": %.1f,\n", total > 0.0 ? results->triangles / total : 0.0);
+    printf("  \"pixels_per_second\": %.1f\n", total > 0.0 ? results->pixels / total : 0.0);
+    printf("}\n");
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    RasterPath path;
+    if (raster_path_from_string(options.simd, &path) && !raster_set_path(path)) {
+        fprintf(stderr, "This CPU does not support the %s rasterizer\n", options.simd);
+        return -1;
+    }
+
+#ifdef SIGPIPE
+    // A stream reader that exits early should fail the write rather than kill the process
+    if (options.stream) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+#endif
+
+    trace_set_thread_name("main");
+    if (options.trace && !trace_open(options.trace)) {
+        fprintf(stderr, "Failed to start the trace\n");
+        return -1;
+    }
+
+    PixelBuffer* pixel_buffer = create_pixel_buffer_with_layout(options.width, options.height, options.layout);
+    void* depth_buffer = pixel_buffer ? create_depth_buffer_with_format(pixel_buffer->storage_width, pixel_buffer->storage_height,
+                                                                        options.depth_format) : NULL;
+    Scene* scene;
+    if (!options.mesh) {
+        scene = create_scene(options.scene);
+    } else if (has_extension(options.mesh, ".glb")) {
+        scene = load_gltf_scene(&options);
+    } else {
+        scene = load_mesh_scene(&options);
+    }
+    // Meshes that cannot get arrays are still drawn, from their interleaved vertices
+    for (size_t i = 0; scene && options.vertex_arrays && i < scene->meshCount; i++) {
+        if (!mesh_build_vertex_arrays(scene->meshes[i])) {
+            fprintf(stderr, "Out of memory for the vertex arrays of mesh %zu\n", i);
+        }
+    }
+    TileRenderer* tiles = options.threads > 0 ? create_tile_renderer(options.width, options.height, options.threads) : NULL;
+    HiZBuffer* hiz = options.hiz ? create_hiz_buffer(options.width, options.height) : NULL;
+    ClearTiles* clear = create_clear_tiles(options.width, options.height, options.depth_format);
+    OverdrawBuffer* overdraw = options.overdraw && pixel_buffer
+        ? create_overdraw_buffer(pixel_buffer->storage_width, pixel_buffer->storage_height) : NULL;
+    FrameSink* sink = options.stream ? create_frame_sink(options.stream, options.stream_format, options.width, options.height,
+                                                         FRAME_RATE, STREAM_QUEUE_DEPTH) : NULL;
+    BenchResults results = {0};
+    if (options.bench) {
+        results.frame_seconds = malloc(sizeof(double) * options.frames);
+    }
+    if (!pixel_buffer || !pixel_buffer->pixels || !depth_buffer || !scene || (options.threads > 0 && !tiles) ||
+        (options.hiz && !hiz) || !clear || (options.overdraw && !overdraw) || (options.stream && !sink) ||
+        (options.bench && !results.frame_seconds)) {
+        fprintf(stderr, "Failed to allocate renderer resources\n");
+        free(results.frame_seconds);
+        destroy_frame_sink(sink);
+        destroy_overdraw_buffer(overdraw);
+        destroy_clear_tiles(clear);
+        destroy_hiz_buffer(hiz);
+        destroy_tile_renderer(tiles);
+        destroy_scene(scene);
+        destroy_depth_buffer(depth_buffer);
+        destroy_pixel_buffer(pixel_buffer);
+        // Closing the trace still leaves a valid file with whatever loading recorded
+        if (options.trace) {
+            trace_close();
+        }
+        return -1;
+    }
+
+    Camera camera;
+    camera_init(&camera,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center,
+        (Vec3){0.0f, 1.0f,  0.0f},
+        CAMERA_FOV,
+        (float)options.width / options.height,
+        CAMERA_NEAR,
+        CAMERA_FAR
+    );
+
+    // Each fixed-point or reversed format needs the projection that produces its depth range
+    float aspect = (float)options.width / options.height;
+    if (options.depth_format == DEPTH_FORMAT_FLOAT32_REVERSED) {
+        camera.projection_matrix = mat4_perspective_reversed(CAMERA_FOV, aspect, CAMERA_NEAR, CAMERA_FAR);
+    } else if (options.depth_format != DEPTH_FORMAT_FLOAT32) {
+        camera.projection_matrix = mat4_perspective_zero_to_one(CAMERA_FOV, aspect, CAMERA_NEAR, CAMERA_FAR);
+    }
+
+    RenderStats stats = {0};
+    RenderTarget target = {
+        .buffer = pixel_buffer,
+        .depth_buffer = depth_buffer,
+        .width = options.width,
+        .height = options.height,
+        .tiles = tiles,
+        .hiz = hiz,
+        .clear = clear,
+        .stream = create_vertex_stream(),
+        .cull_mode = options.cull_mode,
+        .depth_format = options.depth_format,
+        .stats = options.stats ? &stats : NULL,
+        .overdraw = overdraw
+    };
+
+    bool saved = true;
+    int frames_done = 0;
+    for (int frame = 0; frame < options.frames; frame++) {
+        double frame_start = timer_now();
+        TraceZone frame_zone = trace_begin("frame");
+
+        clear_tiles_begin(clear, (Color){0,0,0,255});
+        if (hiz) {
+            clear_hiz_buffer(hiz);
+        }
+        if (overdraw) {
+            clear_overdraw_buffer(overdraw);
+        }
+        RENDER_STATS_TIME(target.stats, RENDER_STAGE_CLEAR, frame_start);
+
+        if (options.bench) {
+            scene_camera_path(scene, &camera, (float)frame / options.frames);
+        } else {
+            camera.view_matrix = camera_get_view_matrix(&camera);
+        }
+
+        SceneStats scene_stats;
+        scene_update(scene, frame * FRAME_TIME_STEP);
+        draw_scene(scene, &camera, &target, &scene_stats);
+
+        if (options.bench) {
+            results.frame_seconds[frame] = timer_now() - frame_start;
+            results.triangles += scene_stats.triangles;
+            results.pixels += scene_stats.pixels;
+        }
+
+        trace_end(frame_zone);
+
+        if (overdraw) {
+            draw_overdraw_heatmap(overdraw, options.overdraw_counter, pixel_buffer, (uint32_t)options.overdraw_scale);
+        }
+
+        TraceZone save_zone = trace_begin("save_frame");
+        saved = save_frame(&options, pixel_buffer, frame);
+        trace_end(save_zone);
+        if (!saved) {
+            break;
+        }
+
+        if (sink && !frame_sink_push(sink, pixel_buffer)) {
+            fprintf(stderr, "Stopped streaming after %d frames\n", frame_sink_frames_written(sink));
+            break;
+        }
+        frames_done++;
+    }
+
+    // Waits for the writer to finish the queued frames
+    bool streamed = !sink || destroy_frame_sink(sink);
+
+    // A run cut short by a failed save or stream has no timings for its remaining frames
+    if (options.bench && frames_done == options.frames) {
+        print_bench_results(&options, &results);
+    }
+    free(results.frame_seconds);
+
+    if (target.stats) {
+        render_stats_print(target.stats, stderr);
+    }
+
+    if (overdraw) {
+        uint64_t total;
+        uint32_t max = overdraw_max(overdraw, options.overdraw_counter, pixel_buffer, &total);
+        fprintf(stderr, "Fragments %s in the last frame: %.2f per pixel on average, at most %u\n",
+                options.overdraw_counter == OVERDRAW_TESTED ? "tested" : "written",
+                (double)total / ((double)options.width * options.height), max);
+    }
+
+    destroy_vertex_stream(target.stream);
+    destroy_overdraw_buffer(overdraw);
+    destroy_clear_tiles(clear);
+    destroy_hiz_buffer(hiz);
+    destroy_tile_renderer(tiles);
+    destroy_scene(scene);
+    destroy_pixel_buffer(pixel_buffer);
+    destroy_depth_buffer(depth_buffer);
+
+    if (options.trace && !trace_close()) {
+        fprintf(stderr, "Failed to write the trace to %s\n", options.trace);
+        return -1;
+    }
+
+    return streamed && saved ? 0 : -1;
+}
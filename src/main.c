@@ -1,22 +1,44 @@
 #include <stdio.h>
+#include <string.h>
 #include <GLFW/glfw3.h>
 #include "core/pixel_buffer.h"
 #include "core/camera.h"
+#include "core/trace.h"
 #include "render/depth_buffer.h"
-#include "render/triangle.h"
+#include "render/render_stats.h"
+#include "render/scene.h"
 #include "math/mat4.h"
-#include "mesh/mesh.h"
 
 #define WIDTH 800
 #define HEIGHT 600
 
+// How often the render loop prints the frame stats, when they are compiled in
+#define STATS_INTERVAL 1.0
+
 void upload_pixel_buffer_to_texture(PixelBuffer* buffer, GLuint texture_id) {
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buffer->width, buffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer->pixels);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    TraceZone zone = trace_begin("upload");
+    const Color* pixels = resolve_pixel_buffer(buffer);
+    if (pixels) {
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buffer->width, buffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    trace_end(zone);
 }
 
-int main(void) {
+int main(int argc, char** argv) {
+    // --trace PATH records every frame until the window closes and writes a Chrome trace to PATH
+    const char* trace_path = argc == 3 && strcmp(argv[1], "--trace") == 0 ? argv[2] : NULL;
+    if (argc != 1 && !trace_path) {
+        fprintf(stderr, "Usage: %s [--trace PATH]\n", argv[0]);
+        return -1;
+    }
+    trace_set_thread_name("main");
+    if (trace_path && !trace_open(trace_path)) {
+        fprintf(stderr, "Failed to start the trace\n");
+        return -1;
+    }
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
         return -1;
@@ -30,8 +52,16 @@ int main(void) {
     }
     glfwMakeContextCurrent(window);
 
-    PixelBuffer* pixel_buffer = create_pixel_buffer(WIDTH, HEIGHT);
-    float* depth_buffer = create_depth_buffer(WIDTH, HEIGHT);
+    PixelBuffer* pixel_buffer = create_pixel_buffer_with_layout(WIDTH, HEIGHT, PIXEL_LAYOUT_TILED);
+    float* depth_buffer = pixel_buffer ? create_depth_buffer(pixel_buffer->storage_width, pixel_buffer->storage_height) : NULL;
+    if (!pixel_buffer || !pixel_buffer->pixels || !depth_buffer) {
+        fprintf(stderr, "Failed to allocate the pixel and depth buffers\n");
+        destroy_depth_buffer(depth_buffer);
+        destroy_pixel_buffer(pixel_buffer);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
 
     GLuint texture_id;
     glGenTextures(1, &texture_id);
@@ -51,59 +81,51 @@ int main(void) {
         100.0f
     );
 
-    Mesh* cube    = create_cube_mesh();
-    Mesh* pyramid = create_pyramid_mesh();
-    if (!cube || !pyramid) {
-        fprintf(stderr, "Failed to create meshes\n");
+    RenderStats stats = {0};
+    double stats_start = glfwGetTime();
+
+    RenderTarget target = {
+        .buffer = pixel_buffer,
+        .depth_buffer = depth_buffer,
+        .width = WIDTH,
+        .height = HEIGHT,
+        .clear = create_clear_tiles(WIDTH, HEIGHT, DEPTH_FORMAT_FLOAT32),
+        .stream = create_vertex_stream(),
+        .stats = RENDER_STATS_ENABLED ? &stats : NULL
+    };
+
+    Scene* scene = create_scene(SCENE_DEFAULT);
+    if (!scene) {
+        fprintf(stderr, "Failed to create scene\n");
         return -1;
     }
 
     while (!glfwWindowShouldClose(window)) {
-        clear_buffer(pixel_buffer, (Color){0,0,0,255});
-        clear_depth_buffer(depth_buffer, WIDTH, HEIGHT);
-
-        camera.view_matrix = camera_get_view_matrix(&camera);
-
-        float angle = (float)glfwGetTime();
-
-        Mat4 cube_model_matrix    = mat4_multiply(mat4_translation(-1.5f,  0.0f, 0.0f), mat4_rotation_y(angle));
-        Mat4 pyramid_model_matrix = mat4_multiply(mat4_translation( 1.5f, -0.5f, 0.0f), mat4_rotation_y(angle));
-
-        // Fill pass: draw triangles
-        Mat4 cube_mvp    = mat4_multiply(camera.projection_matrix, mat4_multiply(camera.view_matrix, cube_model_matrix));
-        for (size_t i = 0; i < cube->indexCount; i += 3) {
-            draw_triangle(
-                cube->vertices[cube->indices[i + 0]],
-                cube->vertices[cube->indices[i + 1]],
-                cube->vertices[cube->indices[i + 2]],
-                cube_mvp,
-                pixel_buffer,
-                depth_buffer,
-                WIDTH,
-                HEIGHT
-            );
+        TraceZone frame_zone = trace_begin("frame");
+        double clear_start = RENDER_STATS_CLOCK();
+        if (target.clear) {
+            clear_tiles_begin(target.clear, (Color){0,0,0,255});
+        } else {
+            clear_buffer(pixel_buffer, (Color){0,0,0,255});
+            clear_depth_buffer(depth_buffer, pixel_buffer->storage_width, pixel_buffer->storage_height);
         }
+        RENDER_STATS_TIME(target.stats, RENDER_STAGE_CLEAR, clear_start);
 
-        Mat4 pyramid_mvp = mat4_multiply(camera.projection_matrix, mat4_multiply(camera.view_matrix, pyramid_model_matrix));
-        for (size_t i = 0; i < pyramid->indexCount; i += 3) {
-            draw_triangle(
-                pyramid->vertices[pyramid->indices[i + 0]],
-                pyramid->vertices[pyramid->indices[i + 1]],
-                pyramid->vertices[pyramid->indices[i + 2]],
-                pyramid_mvp,
-                pixel_buffer,
-                depth_buffer,
-                WIDTH,
-                HEIGHT
-            );
-        }
+        camera.view_matrix = camera_get_view_matrix(&camera);
 
-        // Wireframe pass: draw only boundary edges
-        draw_wireframe(cube,    cube_mvp,    pixel_buffer, depth_buffer, WIDTH, HEIGHT);
-        draw_wireframe(pyramid, pyramid_mvp, pixel_buffer, depth_buffer, WIDTH, HEIGHT);
+        scene_update(scene, (float)glfwGetTime());
+        draw_scene(scene, &camera, &target, NULL);
 
         // Upload and display
+        double upload_start = RENDER_STATS_CLOCK();
         upload_pixel_buffer_to_texture(pixel_buffer, texture_id);
+        RENDER_STATS_TIME(target.stats, RENDER_STAGE_UPLOAD, upload_start);
+
+        if (target.stats && glfwGetTime() - stats_start >= STATS_INTERVAL) {
+            render_stats_print(target.stats, stdout);
+            render_stats_reset(target.stats);
+            stats_start = glfwGetTime();
+        }
 
         glClear(GL_COLOR_BUFFER_BIT);
         glEnable(GL_TEXTURE_2D);
@@ -122,17 +144,25 @@ int main(void) {
         glDisable(GL_TEXTURE_2D);
         glDisable(GL_BLEND);
 
+        trace_end(frame_zone);
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    destroy_mesh(cube);
-    destroy_mesh(pyramid);
+    destroy_vertex_stream(target.stream);
+    destroy_clear_tiles(target.clear);
+    destroy_scene(scene);
     destroy_pixel_buffer(pixel_buffer);
     destroy_depth_buffer(depth_buffer);
     glDeleteTextures(1, &texture_id);
     glfwDestroyWindow(window);
     glfwTerminate();
 
+    if (trace_path && !trace_close()) {
+        fprintf(stderr, "Failed to write the trace to %s\n", trace_path);
+        return -1;
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -55,10 +55,26 @@ Mat4 mat4_perspective(float fov, float aspect, float near, float far) {
     Mat4 matrix = {{0.0f}};
     matrix.m[0] = f / aspect;
     matrix.m[5] = f;
-    matrix.m[10] = far / (far - near);
+    matrix.m[10] = (far + near) / (far - near);
     matrix.m[11] = 1.0f;
-    matrix.m[14] = (near * far) / (far - near);
+    matrix.m[14] = -2.0f * near * far / (far - near);
+
+    return matrix;
+}
 
+// The variants only rewrite the depth row of mat4_perspective: averaging it with the w row maps
+// -1..1 to 0..1, and subtracting that from the w row flips it to 1..0
+Mat4 mat4_perspective_zero_to_one(float fov, float aspect, float near, float far) {
+    Mat4 matrix = mat4_perspective(fov, aspect, near, far);
+    matrix.m[10] = far / (far - near);
+    matrix.m[14] = -(near * far) / (far - near);
+    return matrix;
+}
+
+Mat4 mat4_perspective_reversed(float fov, float aspect, float near, float far) {
+    Mat4 matrix = mat4_perspective(fov, aspect, near, far);
+    matrix.m[10] = -near / (far - near);
+    matrix.m[14] = (near * far) / (far - near);
     return matrix;
 }
 
@@ -0,0 +1,565 @@
+#include "mesh/gltf.h"
+#include "core/json.h"
+#include "core/trace.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLB_MAGIC 0x46546c67u           // "glTF"
+#define GLB_VERSION 2
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+#define GLB_CHUNK_JSON 0x4e4f534au      // "JSON"
+#define GLB_CHUNK_BIN 0x004e4942u       // "BIN\0"
+#define GLTF_MODE_TRIANGLES 4
+
+// Token indices of the elements of a top-level array, so that lookups by index are direct
+typedef struct {
+    int* tokens;
+    size_t count;
+} GltfTable;
+
+// State shared while a file is loaded
+typedef struct {
+    const JsonDocument* json;
+    const unsigned char* bin;
+    size_t bin_size;
+    GltfModel* model;
+    GltfTable accessors;
+    GltfTable views;
+    GltfTable meshes;
+    GltfTable nodes;
+    size_t* mesh_first;             // First primitive of each glTF mesh in the model
+    size_t* mesh_primitives;        // Number of triangle primitives of each glTF mesh
+    size_t instance_capacity;
+} GltfLoader;
+
+static uint32_t read_u32_le(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static size_t component_size(GltfComponentType type) {
+    switch (type) {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:  return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:          return 4;
+    }
+    return 0;
+}
+
+static int type_components(const JsonDocument* json, int type) {
+    if (json_string_equals(json, type, "SCALAR")) return 1;
+    if (json_string_equals(json, type, "VEC2")) return 2;
+    if (json_string_equals(json, type, "VEC3")) return 3;
+    if (json_string_equals(json, type, "VEC4")) return 4;
+    return 0;
+}
+
+static bool build_table(const JsonDocument* json, const char* key, GltfTable* out) {
+    int array = json_object_get(json, 0, key);
+    out->count = json_array_count(json, array);
+    out->tokens = malloc((out->count + 1) * sizeof(int));
+    if (!out->tokens) {
+        return false;
+    }
+
+    // Elements follow the array token, each one starting where the one before it ends
+    size_t token = (size_t)array + 1;
+    for (size_t i = 0; i < out->count; i++) {
+        out->tokens[i] = (int)token;
+        token = json->tokens[token].next;
+    }
+    return true;
+}
+
+static int table_get(const GltfTable* table, size_t index) {
+    return index < table->count ? table->tokens[index] : -1;
+}
+
+// Reads a non-negative integer member, returning false if it is present but not one
+static bool read_index(const JsonDocument* json, int object, const char* key, size_t fallback, size_t* out) {
+    int token = json_object_get(json, object, key);
+    if (token < 0) {
+        *out = fallback;
+        return true;
+    }
+
+    double value = json_number(json, token, -1.0);
+    if (value < 0.0 || value > (double)SIZE_MAX / 2 || value != (double)(size_t)value) {
+        return false;
+    }
+    *out = (size_t)value;
+    return true;
+}
+
+// Builds the view of an accessor and checks that every element lies inside the binary chunk
+static bool build_accessor(const GltfLoader* loader, size_t index, GltfAccessor* out) {
+    const JsonDocument* json = loader->json;
+    int accessor = table_get(&loader->accessors, index);
+    if (accessor < 0 || json_object_get(json, accessor, "sparse") >= 0) {
+        return false;
+    }
+
+    size_t view_index, accessor_offset, count, type_value;
+    if (!read_index(json, accessor, "bufferView", SIZE_MAX, &view_index) ||
+        !read_index(json, accessor, "byteOffset", 0, &accessor_offset) ||
+        !read_index(json, accessor, "count", SIZE_MAX, &count) ||
+        !read_index(json, accessor, "componentType", 0, &type_value)) {
+        return false;
+    }
+
+    GltfComponentType type = (GltfComponentType)type_value;
+    int components = type_components(json, json_object_get(json, accessor, "type"));
+    size_t element_size = component_size(type) * (size_t)components;
+    int view = table_get(&loader->views, view_index);
+    if (view < 0 || count == SIZE_MAX || element_size == 0) {
+        return false;
+    }
+
+    // Only the file's own binary chunk can back a view
+    size_t buffer, view_offset, view_length, stride;
+    if (!read_index(json, view, "buffer", SIZE_MAX, &buffer) ||
+        !read_index(json, view, "byteOffset", 0, &view_offset) ||
+        !read_index(json, view, "byteLength", SIZE_MAX, &view_length) ||
+        !read_index(json, view, "byteStride", element_size, &stride)) {
+        return false;
+    }
+    int buffer_token = json_array_get(json, json_object_get(json, 0, "buffers"), buffer);
+    if (buffer != 0 || buffer_token < 0 || json_object_get(json, buffer_token, "uri") >= 0 || !loader->bin) {
+        return false;
+    }
+    if (stride < element_size || view_offset > loader->bin_size || view_length > loader->bin_size - view_offset) {
+        return false;
+    }
+
+    // The last element must end inside the view
+    if (count > 0) {
+        if (accessor_offset > view_length || (count - 1) > (view_length - accessor_offset) / stride) {
+            return false;
+        }
+        if (accessor_offset + (count - 1) * stride + element_size > view_length) {
+            return false;
+        }
+    }
+
+    bool normalized = false;
+    int normalized_token = json_object_get(json, accessor, "normalized");
+    if (normalized_token >= 0 && json->tokens[normalized_token].type == JSON_BOOL) {
+        normalized = json->text[json->tokens[normalized_token].start] == 't';
+    }
+
+    *out = (GltfAccessor){
+        loader->bin + view_offset + accessor_offset, count, stride, type, components, normalized
+    };
+    return true;
+}
+
+// Builds the view of a named attribute of a primitive, leaving it absent if there is none
+static bool build_attribute(const GltfLoader* loader, int attributes, const char* name, GltfAccessor* out) {
+    int token = json_object_get(loader->json, attributes, name);
+    if (token < 0) {
+        *out = (GltfAccessor){0};
+        return true;
+    }
+
+    double index = json_number(loader->json, token, -1.0);
+    return index >= 0.0 && build_accessor(loader, (size_t)index, out);
+}
+
+static bool is_integer(GltfComponentType type) {
+    return type == GLTF_UNSIGNED_BYTE || type == GLTF_UNSIGNED_SHORT || type == GLTF_UNSIGNED_INT;
+}
+
+// Adds the triangle primitives of every mesh to the model
+static bool load_primitives(GltfLoader* loader) {
+    const JsonDocument* json = loader->json;
+    size_t mesh_count = loader->meshes.count;
+    loader->mesh_first = calloc(mesh_count + 1, sizeof(size_t));
+    loader->mesh_primitives = calloc(mesh_count + 1, sizeof(size_t));
+    if (!loader->mesh_first || !loader->mesh_primitives) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (size_t m = 0; m < mesh_count; m++) {
+        total += json_array_count(json, json_object_get(json, loader->meshes.tokens[m], "primitives"));
+    }
+    loader->model->primitives = calloc(total + 1, sizeof(GltfPrimitive));
+    if (!loader->model->primitives) {
+        return false;
+    }
+
+    for (size_t m = 0; m < mesh_count; m++) {
+        int primitives = json_object_get(json, loader->meshes.tokens[m], "primitives");
+        loader->mesh_first[m] = loader->model->primitiveCount;
+
+        for (size_t p = 0; p < json_array_count(json, primitives); p++) {
+            int primitive = json_array_get(json, primitives, p);
+            size_t mode;
+            if (!read_index(json, primitive, "mode", GLTF_MODE_TRIANGLES, &mode)) {
+                return false;
+            }
+            // Only triangle lists are read; points and lines have nothing to fill, and exporters
+            // rarely write strips or fans
+            if (mode != GLTF_MODE_TRIANGLES) {
+                continue;
+            }
+
+            GltfPrimitive* out = &loader->model->primitives[loader->model->primitiveCount];
+            int attributes = json_object_get(json, primitive, "attributes");
+            if (!build_attribute(loader, attributes, "POSITION", &out->positions) || !out->positions.data ||
+                out->positions.components != 3 ||
+                !build_attribute(loader, attributes, "NORMAL", &out->normals) ||
+                !build_attribute(loader, attributes, "COLOR_0", &out->colors)) {
+                return false;
+            }
+            if ((out->normals.data && (out->normals.count != out->positions.count || out->normals.components != 3)) ||
+                (out->colors.data && (out->colors.count != out->positions.count || out->colors.components < 3))) {
+                return false;
+            }
+
+            int indices = json_object_get(json, primitive, "indices");
+            if (indices >= 0) {
+                double index = json_number(json, indices, -1.0);
+                if (index < 0.0 || !build_accessor(loader, (size_t)index, &out->indices) ||
+                    out->indices.components != 1 || !is_integer(out->indices.component_type)) {
+                    return false;
+                }
+            }
+
+            loader->model->primitiveCount++;
+            loader->mesh_primitives[m]++;
+        }
+    }
+    return true;
+}
+
+static Mat4 quaternion_matrix(float x, float y, float z, float w) {
+    Mat4 matrix = mat4_identity();
+    matrix.m[0] = 1.0f - 2.0f * (y * y + z * z);
+    matrix.m[1] = 2.0f * (x * y + z * w);
+    matrix.m[2] = 2.0f * (x * z - y * w);
+    matrix.m[4] = 2.0f * (x * y - z * w);
+    matrix.m[5] = 1.0f - 2.0f * (x * x + z * z);
+    matrix.m[6] = 2.0f * (y * z + x * w);
+    matrix.m[8] = 2.0f * (x * z + y * w);
+    matrix.m[9] = 2.0f * (y * z - x * w);
+    matrix.m[10] = 1.0f - 2.0f * (x * x + y * y);
+    return matrix;
+}
+
+// Reads element i of a number array, or the fallback if the array or the element is missing
+static float array_number(const JsonDocument* json, int array, size_t i, float fallback) {
+    return (float)json_number(json, json_array_get(json, array, i), fallback);
+}
+
+// A node's transform relative to its parent, from a matrix or from translation, rotation and scale
+static Mat4 node_transform(const JsonDocument* json, int node) {
+    int matrix = json_object_get(json, node, "matrix");
+    if (json_array_count(json, matrix) == 16) {
+        // Both glTF and Mat4 store matrices column by column
+        Mat4 result;
+        for (size_t i = 0; i < 16; i++) {
+            result.m[i] = array_number(json, matrix, i, 0.0f);
+        }
+        return result;
+    }
+
+    int t = json_object_get(json, node, "translation");
+    int r = json_object_get(json, node, "rotation");
+    int s = json_object_get(json, node, "scale");
+    Mat4 translation = mat4_translation(array_number(json, t, 0, 0.0f), array_number(json, t, 1, 0.0f),
+                                        array_number(json, t, 2, 0.0f));
+    Mat4 rotation = quaternion_matrix(array_number(json, r, 0, 0.0f), array_number(json, r, 1, 0.0f),
+                                      array_number(json, r, 2, 0.0f), array_number(json, r, 3, 1.0f));
+    Mat4 scale = mat4_scale(array_number(json, s, 0, 1.0f), array_number(json, s, 1, 1.0f),
+                            array_number(json, s, 2, 1.0f));
+    return mat4_multiply(translation, mat4_multiply(rotation, scale));
+}
+
+static bool add_instance(GltfLoader* loader, size_t primitive, Mat4 transform) {
+    GltfModel* model = loader->model;
+    if (model->instanceCount == loader->instance_capacity) {
+        size_t capacity = loader->instance_capacity ? loader->instance_capacity * 2 : 16;
+        GltfInstance* instances = realloc(model->instances, capacity * sizeof(GltfInstance));
+        if (!instances) {
+            return false;
+        }
+        model->instances = instances;
+        loader->instance_capacity = capacity;
+    }
+
+    model->instances[model->instanceCount++] = (GltfInstance){primitive, transform};
+    return true;
+}
+
+// Adds the instances of a node and its descendants. Nodes form a forest, so a path longer than
+// the node count can only come from a cycle in a malformed file.
+static bool visit_node(GltfLoader* loader, size_t index, Mat4 parent, size_t depth) {
+    const JsonDocument* json = loader->json;
+    int node = table_get(&loader->nodes, index);
+    if (node < 0 || depth > loader->nodes.count) {
+        return false;
+    }
+
+    Mat4 transform = mat4_multiply(parent, node_transform(json, node));
+    size_t mesh;
+    if (!read_index(json, node, "mesh", SIZE_MAX, &mesh)) {
+        return false;
+    }
+    if (mesh != SIZE_MAX) {
+        if (mesh >= loader->meshes.count) {
+            return false;
+        }
+        for (size_t p = 0; p < loader->mesh_primitives[mesh]; p++) {
+            if (!add_instance(loader, loader->mesh_first[mesh] + p, transform)) {
+                return false;
+            }
+        }
+    }
+
+    int children = json_object_get(json, node, "children");
+    for (size_t i = 0; i < json_array_count(json, children); i++) {
+        double child = json_number(json, json_array_get(json, children, i), -1.0);
+        if (child < 0.0 || !visit_node(loader, (size_t)child, transform, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Instances the nodes of the default scene, or every root node if the file has no scenes
+static bool load_instances(GltfLoader* loader) {
+    const JsonDocument* json = loader->json;
+    size_t scene_index;
+    if (!read_index(json, 0, "scene", 0, &scene_index)) {
+        return false;
+    }
+
+    int scene = json_array_get(json, json_object_get(json, 0, "scenes"), scene_index);
+    if (scene >= 0) {
+        int roots = json_object_get(json, scene, "nodes");
+        for (size_t i = 0; i < json_array_count(json, roots); i++) {
+            double root = json_number(json, json_array_get(json, roots, i), -1.0);
+            if (root < 0.0 || !visit_node(loader, (size_t)root, mat4_identity(), 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t node_count = loader->nodes.count;
+    bool* is_child = calloc(node_count + 1, sizeof(bool));
+    if (!is_child) {
+        return false;
+    }
+    for (size_t n = 0; n < node_count; n++) {
+        int children = json_object_get(json, loader->nodes.tokens[n], "children");
+        for (size_t i = 0; i < json_array_count(json, children); i++) {
+            double child = json_number(json, json_array_get(json, children, i), -1.0);
+            if (child >= 0.0 && child < (double)node_count) {
+                is_child[(size_t)child] = true;
+            }
+        }
+    }
+
+    bool ok = true;
+    for (size_t n = 0; n < node_count && ok; n++) {
+        ok = is_child[n] || visit_node(loader, n, mat4_identity(), 0);
+    }
+    free(is_child);
+    return ok;
+}
+
+GltfModel* load_gltf_model(const char* filepath) {
+    TraceZone zone = trace_begin("load_gltf_model");
+    GltfModel* model = calloc(1, sizeof(GltfModel));
+    if (!model) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    model->file = map_file(filepath);
+    const unsigned char* data = model->file ? model->file->data : NULL;
+    size_t size = model->file ? model->file->size : 0;
+
+    // The header and the JSON chunk come first, then an optional binary chunk
+    bool ok = size >= GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE && read_u32_le(data) == GLB_MAGIC &&
+              read_u32_le(data + 4) == GLB_VERSION && read_u32_le(data + 8) <= size;
+    JsonDocument* json = NULL;
+    GltfLoader loader = {0};
+    if (ok) {
+        size = read_u32_le(data + 8);
+        size_t json_length = read_u32_le(data + GLB_HEADER_SIZE);
+        size_t json_start = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE;
+        ok = read_u32_le(data + GLB_HEADER_SIZE + 4) == GLB_CHUNK_JSON && json_length <= size - json_start;
+        if (ok) {
+            json = json_parse((const char*)data + json_start, json_length);
+            ok = json && json->tokens[0].type == JSON_OBJECT;
+        }
+
+        size_t bin_header = json_start + (json_length + 3) / 4 * 4;
+        if (ok && bin_header + GLB_CHUNK_HEADER_SIZE <= size && read_u32_le(data + bin_header + 4) == GLB_CHUNK_BIN) {
+            size_t bin_length = read_u32_le(data + bin_header);
+            ok = bin_length <= size - bin_header - GLB_CHUNK_HEADER_SIZE;
+            loader.bin = data + bin_header + GLB_CHUNK_HEADER_SIZE;
+            loader.bin_size = bin_length;
+        }
+    }
+
+    loader.json = json;
+    loader.model = model;
+    ok = ok && build_table(json, "accessors", &loader.accessors) && build_table(json, "bufferViews", &loader.views) &&
+         build_table(json, "meshes", &loader.meshes) && build_table(json, "nodes", &loader.nodes) &&
+         load_primitives(&loader) && load_instances(&loader);
+
+    free(loader.accessors.tokens);
+    free(loader.views.tokens);
+    free(loader.meshes.tokens);
+    free(loader.nodes.tokens);
+    free(loader.mesh_first);
+    free(loader.mesh_primitives);
+    json_destroy(json);
+    if (!ok) {
+        fprintf(stderr, "Failed to load glTF binary from %s\n", filepath);
+        destroy_gltf_model(model);
+        trace_end(zone);
+        return NULL;
+    }
+
+    trace_end(zone);
+    return model;
+}
+
+void destroy_gltf_model(GltfModel* model) {
+    if (!model) {
+        return;
+    }
+
+    unmap_file(model->file);
+    free(model->primitives);
+    free(model->instances);
+    free(model);
+}
+
+float gltf_accessor_float(const GltfAccessor* accessor, size_t element, int component) {
+    const unsigned char* p = accessor->data + element * accessor->stride +
+                             (size_t)component * component_size(accessor->component_type);
+    switch (accessor->component_type) {
+        case GLTF_BYTE: {
+            float v = (float)(signed char)p[0];
+            return accessor->normalized ? (v < -127.0f ? -1.0f : v / 127.0f) : v;
+        }
+        case GLTF_UNSIGNED_BYTE:
+            return accessor->normalized ? p[0] / 255.0f : (float)p[0];
+        case GLTF_SHORT: {
+            float v = (float)(int16_t)(p[0] | p[1] << 8);
+            return accessor->normalized ? (v < -32767.0f ? -1.0f : v / 32767.0f) : v;
+        }
+        case GLTF_UNSIGNED_SHORT: {
+            float v = (float)(p[0] | p[1] << 8);
+            return accessor->normalized ? v / 65535.0f : v;
+        }
+        case GLTF_UNSIGNED_INT:
+            return (float)read_u32_le(p);
+        case GLTF_FLOAT: {
+            uint32_t bits = read_u32_le(p);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+uint32_t gltf_accessor_uint(const GltfAccessor* accessor, size_t element) {
+    const unsigned char* p = accessor->data + element * accessor->stride;
+    switch (accessor->component_type) {
+        case GLTF_UNSIGNED_BYTE:  return p[0];
+        case GLTF_UNSIGNED_SHORT: return (uint32_t)(p[0] | p[1] << 8);
+        default:                  return read_u32_le(p);
+    }
+}
+
+static unsigned char color_channel(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+    return value >= 1.0f ? 255 : (unsigned char)(value * 255.0f + 0.5f);
+}
+
+// Indices can be used where they lie when they already have the layout of the mesh's int array
+static bool indices_in_place(const GltfAccessor* indices) {
+    const uint32_t probe = 1;
+    unsigned char first_byte;
+    memcpy(&first_byte, &probe, 1);
+    return first_byte == 1 && indices->component_type == GLTF_UNSIGNED_INT && indices->stride == sizeof(int) &&
+           (uintptr_t)indices->data % _Alignof(int) == 0;
+}
+
+Mesh* gltf_primitive_to_mesh(const GltfModel* model, size_t primitive) {
+    TraceZone zone = trace_begin("gltf_primitive_to_mesh");
+    const GltfPrimitive* source = &model->primitives[primitive];
+    size_t vertex_count = source->positions.count;
+    size_t index_count = source->indices.data ? source->indices.count : vertex_count;
+    index_count -= index_count % 3;
+
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    bool ok = mesh && vertex_count > 0 && vertex_count <= INT_MAX && index_count <= INT_MAX;
+    if (ok) {
+        mesh->vertices = malloc(vertex_count * sizeof(Vertex));
+        ok = mesh->vertices != NULL;
+    }
+
+    for (size_t i = 0; ok && i < vertex_count; i++) {
+        Vertex* v = &mesh->vertices[i];
+        v->position = (Vec4){gltf_accessor_float(&source->positions, i, 0), gltf_accessor_float(&source->positions, i, 1),
+                             gltf_accessor_float(&source->positions, i, 2), 1.0f};
+        v->normal = (Vec3){0.0f, 0.0f, 0.0f};
+        if (source->normals.data) {
+            v->normal = (Vec3){gltf_accessor_float(&source->normals, i, 0), gltf_accessor_float(&source->normals, i, 1),
+                               gltf_accessor_float(&source->normals, i, 2)};
+        }
+        v->color = (Color){255, 255, 255, 255};
+        if (source->colors.data) {
+            v->color.r = color_channel(gltf_accessor_float(&source->colors, i, 0));
+            v->color.g = color_channel(gltf_accessor_float(&source->colors, i, 1));
+            v->color.b = color_channel(gltf_accessor_float(&source->colors, i, 2));
+            if (source->colors.components == 4) {
+                v->color.a = color_channel(gltf_accessor_float(&source->colors, i, 3));
+            }
+        }
+    }
+
+    if (ok && source->indices.data && indices_in_place(&source->indices)) {
+        mesh->indices = (int*)source->indices.data;
+        mesh->mapping = retain_mapped_file(model->file);
+    } else if (ok) {
+        mesh->indices = malloc((index_count + 1) * sizeof(int));
+        ok = mesh->indices != NULL;
+        for (size_t i = 0; ok && i < index_count; i++) {
+            mesh->indices[i] = source->indices.data ? (int)gltf_accessor_uint(&source->indices, i) : (int)i;
+        }
+    }
+
+    // Indices read in place are checked here too; a negative int is one too large for an int
+    for (size_t i = 0; ok && i < index_count; i++) {
+        ok = mesh->indices[i] >= 0 && (size_t)mesh->indices[i] < vertex_count;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to convert glTF primitive %zu to a mesh\n", primitive);
+        destroy_mesh(mesh);
+        trace_end(zone);
+        return NULL;
+    }
+
+    mesh->vertexCount = vertex_count;
+    mesh->indexCount = index_count;
+    trace_end(zone);
+    return mesh;
+}
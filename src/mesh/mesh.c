@@ -1,4 +1,5 @@
 #include "mesh/mesh.h"
+#include "core/trace.h"
 #include <stdlib.h>
 #include <stdint.h>
 
@@ -9,6 +10,7 @@ static uint64_t pack_edge(uint32_t a, uint32_t b) {
 }
 
 size_t mesh_get_boundary_edges(const Mesh* mesh, Edge** outEdges) {
+    TraceZone zone = trace_begin("mesh_get_boundary_edges");
     size_t triCount = mesh->indexCount / 3;
     size_t tableCap = triCount * 3;
     EdgeCount* table = calloc(tableCap, sizeof(*table));
@@ -52,6 +54,7 @@ size_t mesh_get_boundary_edges(const Mesh* mesh, Edge** outEdges) {
 
     free(table);
     *outEdges = edges;
+    trace_end(zone);
     return outN;
 }
 
@@ -62,6 +65,8 @@ Mesh* create_cube_mesh() {
         return NULL;
     }
 
+    mesh->mapping = NULL;
+    mesh->arrays = NULL;
     mesh->vertexCount = 8;
     mesh->vertices = (Vertex*)malloc(mesh->vertexCount * sizeof(Vertex));
     if (!mesh->vertices) {
@@ -108,6 +113,8 @@ Mesh* create_pyramid_mesh() {
         return NULL;
     }
 
+    mesh->mapping = NULL;
+    mesh->arrays = NULL;
     mesh->vertexCount = 5;
     mesh->vertices = (Vertex*)malloc(mesh->vertexCount * sizeof(Vertex));
     if (!mesh->vertices) {
@@ -145,7 +152,52 @@ void destroy_mesh(Mesh* mesh) {
         return;
     }
 
-    free(mesh->vertices);
-    free(mesh->indices);
+    // Arrays inside the mapping go away with it
+    if (!mapped_file_contains(mesh->mapping, mesh->vertices)) {
+        free(mesh->vertices);
+    }
+    if (!mapped_file_contains(mesh->mapping, mesh->indices)) {
+        free(mesh->indices);
+    }
+    unmap_file(mesh->mapping);
+    if (mesh->arrays) {
+        free(mesh->arrays->x);
+        free(mesh->arrays);
+    }
     free(mesh);
 }
+
+bool mesh_build_vertex_arrays(Mesh* mesh) {
+    size_t n = mesh->vertexCount;
+    VertexArrays* arrays = mesh->arrays;
+    if (!arrays || arrays->capacity < n) {
+        // One block holds the six float arrays followed by the colors. The old block is dropped
+        // first, so a failure leaves the mesh without arrays rather than with arrays too short.
+        if (arrays) {
+            free(arrays->x);
+        } else {
+            arrays = malloc(sizeof(VertexArrays));
+        }
+        float* block = arrays ? malloc(n * (6 * sizeof(float) + sizeof(Color)) + 1) : NULL;
+        if (!block) {
+            free(arrays);
+            mesh->arrays = NULL;
+            return false;
+        }
+        *arrays = (VertexArrays){block, block + n, block + 2 * n, block + 3 * n, block + 4 * n, block + 5 * n,
+                                 (Color*)(block + 6 * n), n};
+        mesh->arrays = arrays;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const Vertex* v = &mesh->vertices[i];
+        arrays->x[i] = v->position.x;
+        arrays->y[i] = v->position.y;
+        arrays->z[i] = v->position.z;
+        arrays->nx[i] = v->normal.x;
+        arrays->ny[i] = v->normal.y;
+        arrays->nz[i] = v->normal.z;
+        arrays->colors[i] = v->color;
+    }
+    return true;
+}
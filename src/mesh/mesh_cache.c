@@ -0,0 +1,111 @@
+#include "mesh/mesh_cache.h"
+#include "core/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(MeshCacheHeader) == 64, "the mesh cache header has a fixed size");
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+// Writes zero bytes up to the given file offset
+static bool write_padding(FILE* file, uint64_t* position, uint64_t offset) {
+    static const unsigned char zeros[MESH_CACHE_ALIGNMENT] = {0};
+    size_t count = (size_t)(offset - *position);
+    *position = offset;
+    return count == 0 || fwrite(zeros, 1, count, file) == count;
+}
+
+bool save_mesh_cache(const Mesh* mesh, const char* filepath) {
+    MeshCacheHeader header = {0};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.header_size = sizeof(MeshCacheHeader);
+    header.vertex_size = sizeof(Vertex);
+    header.index_size = sizeof(int);
+    header.byte_order = MESH_CACHE_BYTE_ORDER;
+    header.vertex_count = mesh->vertexCount;
+    header.index_count = mesh->indexCount;
+    header.vertex_offset = align_offset(sizeof(MeshCacheHeader));
+    header.index_offset = align_offset(header.vertex_offset + mesh->vertexCount * sizeof(Vertex));
+
+    FILE* file = fopen(filepath, "wb");
+    if (!file) {
+        perror("Failed to open file");
+        return false;
+    }
+
+    uint64_t position = sizeof(header);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              write_padding(file, &position, header.vertex_offset) &&
+              fwrite(mesh->vertices, sizeof(Vertex), mesh->vertexCount, file) == mesh->vertexCount;
+    position += mesh->vertexCount * sizeof(Vertex);
+    ok = ok && write_padding(file, &position, header.index_offset) &&
+         fwrite(mesh->indices, sizeof(int), mesh->indexCount, file) == mesh->indexCount;
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        perror("Failed to write mesh cache");
+    }
+    return ok;
+}
+
+// Checks that an array of count elements of the given size starts at an aligned offset and
+// ends inside the file
+static bool array_fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t file_size) {
+    return offset % MESH_CACHE_ALIGNMENT == 0 && offset <= file_size &&
+           count <= (file_size - offset) / size;
+}
+
+Mesh* load_mesh_cache(const char* filepath) {
+    TraceZone zone = trace_begin("load_mesh_cache");
+    MappedFile* file = map_file(filepath);
+    if (!file) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    MeshCacheHeader header;
+    bool ok = file->size >= sizeof(header);
+    if (ok) {
+        memcpy(&header, file->data, sizeof(header));
+        ok = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+             header.version == MESH_CACHE_VERSION &&
+             header.header_size == sizeof(MeshCacheHeader) &&
+             header.vertex_size == sizeof(Vertex) &&
+             header.index_size == sizeof(int) &&
+             header.byte_order == MESH_CACHE_BYTE_ORDER &&
+             header.vertex_count > 0 && header.vertex_count <= INT32_MAX &&
+             array_fits(header.vertex_offset, header.vertex_count, sizeof(Vertex), file->size) &&
+             array_fits(header.index_offset, header.index_count, sizeof(int), file->size) &&
+             header.vertex_offset >= sizeof(MeshCacheHeader) &&
+             header.index_offset >= header.vertex_offset + header.vertex_count * sizeof(Vertex);
+    }
+
+    // Rendering trusts the indices, so a corrupt cache is caught here rather than read out of bounds
+    const int* indices = ok ? (const int*)(file->data + header.index_offset) : NULL;
+    for (uint64_t i = 0; ok && i < header.index_count; i++) {
+        ok = indices[i] >= 0 && (uint64_t)indices[i] < header.vertex_count;
+    }
+
+    Mesh* mesh = ok ? malloc(sizeof(Mesh)) : NULL;
+    if (!mesh) {
+        fprintf(stderr, "Failed to load mesh cache from %s\n", filepath);
+        unmap_file(file);
+        trace_end(zone);
+        return NULL;
+    }
+
+    mesh->vertices = (Vertex*)(file->data + header.vertex_offset);
+    mesh->indices = (int*)(file->data + header.index_offset);
+    mesh->vertexCount = (size_t)header.vertex_count;
+    mesh->indexCount = (size_t)header.index_count;
+    mesh->mapping = file;
+    mesh->arrays = NULL;
+    trace_end(zone);
+    return mesh;
+}
@@ -0,0 +1,381 @@
+#include "mesh/mesh_optimize.h"
+#include "core/trace.h"
+#include "math/vec3.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Simulated FIFO vertex cache. A vertex is cached while fewer than size vertices have entered
+// the cache after it, which timestamps track without storing the FIFO itself.
+typedef struct {
+    unsigned int* time;     // When each vertex last entered the cache
+    unsigned int now;
+    unsigned int size;
+} VertexCache;
+
+// A run of consecutive triangles that the overdraw pass moves as a whole
+typedef struct {
+    size_t first;
+    size_t count;
+    float sort_key;
+} TriangleCluster;
+
+static bool vertex_cache_init(VertexCache* cache, size_t vertex_count, int size) {
+    cache->time = calloc(vertex_count + 1, sizeof(unsigned int));
+    cache->size = (unsigned int)size;
+    cache->now = cache->size + 1;
+    return cache->time != NULL;
+}
+
+// Empties the cache by moving the clock past every timestamp in it
+static void vertex_cache_flush(VertexCache* cache) {
+    cache->now += cache->size + 1;
+}
+
+// Touches a vertex and tells whether it missed
+static bool vertex_cache_miss(VertexCache* cache, int vertex) {
+    if (cache->now - cache->time[vertex] > cache->size) {
+        cache->time[vertex] = cache->now++;
+        return true;
+    }
+    return false;
+}
+
+static int triangle_misses(VertexCache* cache, const int* triangle) {
+    return vertex_cache_miss(cache, triangle[0]) + vertex_cache_miss(cache, triangle[1]) +
+           vertex_cache_miss(cache, triangle[2]);
+}
+
+// Swaps in a new index array, freeing the old one unless it lives in the mesh's mapped file
+static void replace_indices(Mesh* mesh, int* indices) {
+    if (!mapped_file_contains(mesh->mapping, mesh->indices)) {
+        free(mesh->indices);
+    }
+    mesh->indices = indices;
+}
+
+float mesh_cache_miss_ratio(const Mesh* mesh, int cache_size) {
+    size_t triangle_count = mesh->indexCount / 3;
+    VertexCache cache;
+    if (triangle_count == 0 || !vertex_cache_init(&cache, mesh->vertexCount, cache_size)) {
+        return 0.0f;
+    }
+
+    size_t misses = 0;
+    for (size_t t = 0; t < triangle_count; t++) {
+        misses += (size_t)triangle_misses(&cache, &mesh->indices[t * 3]);
+    }
+    free(cache.time);
+    return (float)misses / (float)triangle_count;
+}
+
+// Picks the next vertex to fan around: of the candidates that will still be in the cache after
+// their remaining triangles are emitted, the one that entered it earliest. Falls back to the
+// most recently used vertex with triangles left, then to the lowest such vertex.
+static int next_fanning_vertex(const VertexCache* cache, const int* live, const int* candidates, size_t candidate_count,
+                               int* dead_ends, size_t* dead_end_count, int* cursor, int vertex_count) {
+    int best = -1;
+    long best_priority = 0;
+    for (size_t i = 0; i < candidate_count; i++) {
+        int v = candidates[i];
+        if (live[v] == 0) {
+            continue;
+        }
+
+        long age = (long)(cache->now - cache->time[v]);
+        long priority = age + 2 * live[v] <= (long)cache->size ? age : 0;
+        if (priority > best_priority) {
+            best = v;
+            best_priority = priority;
+        }
+    }
+    if (best >= 0) {
+        return best;
+    }
+
+    while (*dead_end_count > 0) {
+        int v = dead_ends[--*dead_end_count];
+        if (live[v] > 0) {
+            return v;
+        }
+    }
+    while (*cursor < vertex_count) {
+        if (live[*cursor] > 0) {
+            return *cursor;
+        }
+        (*cursor)++;
+    }
+    return -1;
+}
+
+bool optimize_mesh_vertex_cache(Mesh* mesh, int cache_size) {
+    size_t triangle_count = mesh->indexCount / 3;
+    int vertex_count = (int)mesh->vertexCount;
+    if (triangle_count == 0) {
+        return true;
+    }
+    TraceZone zone = trace_begin("optimize_mesh_vertex_cache");
+
+    // Triangles around each vertex, and how many of them are still to be emitted
+    int* live = calloc((size_t)vertex_count + 1, sizeof(int));
+    size_t* first = calloc((size_t)vertex_count + 2, sizeof(size_t));
+    int* adjacency = malloc(triangle_count * 3 * sizeof(int));
+    bool* emitted = calloc(triangle_count, sizeof(bool));
+    int* dead_ends = malloc(triangle_count * 3 * sizeof(int));
+    int* indices = malloc(mesh->indexCount * sizeof(int));
+    VertexCache cache = {0};
+    bool ok = live && first && adjacency && emitted && dead_ends && indices &&
+              vertex_cache_init(&cache, mesh->vertexCount, cache_size);
+
+    int max_live = 0;
+    int* candidates = NULL;
+    if (ok) {
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            live[mesh->indices[i]]++;
+        }
+        for (int v = 0; v < vertex_count; v++) {
+            first[v + 1] = first[v] + (size_t)live[v];
+            max_live = live[v] > max_live ? live[v] : max_live;
+        }
+        // Fill each vertex's list from its end, using first[v + 1] as the cursor
+        for (size_t t = triangle_count; t-- > 0;) {
+            for (int c = 0; c < 3; c++) {
+                adjacency[--first[mesh->indices[t * 3 + c] + 1]] = (int)t;
+            }
+        }
+        for (int v = 0; v < vertex_count; v++) {
+            first[v + 1] = first[v] + (size_t)live[v];
+        }
+        candidates = malloc((size_t)max_live * 3 * sizeof(int));
+        ok = candidates != NULL;
+    }
+
+    if (ok) {
+        size_t written = 0;
+        size_t dead_end_count = 0;
+        int cursor = 0;
+        int fan = next_fanning_vertex(&cache, live, NULL, 0, dead_ends, &dead_end_count, &cursor, vertex_count);
+        while (fan >= 0) {
+            size_t candidate_count = 0;
+            for (size_t a = first[fan]; a < first[fan + 1]; a++) {
+                size_t t = (size_t)adjacency[a];
+                if (emitted[t]) {
+                    continue;
+                }
+                emitted[t] = true;
+
+                for (int c = 0; c < 3; c++) {
+                    int v = mesh->indices[t * 3 + c];
+                    indices[written++] = v;
+                    dead_ends[dead_end_count++] = v;
+                    candidates[candidate_count++] = v;
+                    live[v]--;
+                    vertex_cache_miss(&cache, v);
+                }
+            }
+            fan = next_fanning_vertex(&cache, live, candidates, candidate_count, dead_ends, &dead_end_count,
+                                      &cursor, vertex_count);
+        }
+
+        // A trailing partial triangle is kept where it was
+        memcpy(&indices[written], &mesh->indices[written], (mesh->indexCount - written) * sizeof(int));
+        replace_indices(mesh, indices);
+        indices = NULL;
+    }
+
+    free(live);
+    free(first);
+    free(adjacency);
+    free(emitted);
+    free(dead_ends);
+    free(candidates);
+    free(indices);
+    free(cache.time);
+    trace_end(zone);
+    return ok;
+}
+
+// In the renderer's left-handed space a triangle facing the viewer winds counter-clockwise on
+// screen, so its outward normal is (c - a) x (b - a). Its length is twice the area.
+static Vec3 front_normal(const Mesh* mesh, const int* triangle) {
+    Vec4 a = mesh->vertices[triangle[0]].position;
+    Vec4 b = mesh->vertices[triangle[1]].position;
+    Vec4 c = mesh->vertices[triangle[2]].position;
+    Vec3 ab = {b.x - a.x, b.y - a.y, b.z - a.z};
+    Vec3 ac = {c.x - a.x, c.y - a.y, c.z - a.z};
+    return vec3_cross(ac, ab);
+}
+
+static Vec3 triangle_centroid(const Mesh* mesh, const int* triangle) {
+    Vec4 a = mesh->vertices[triangle[0]].position;
+    Vec4 b = mesh->vertices[triangle[1]].position;
+    Vec4 c = mesh->vertices[triangle[2]].position;
+    return (Vec3){(a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f};
+}
+
+static int compare_clusters(const void* a, const void* b) {
+    const TriangleCluster* x = a;
+    const TriangleCluster* y = b;
+    if (x->sort_key != y->sort_key) {
+        return x->sort_key < y->sort_key ? 1 : -1;
+    }
+    return (x->first > y->first) - (x->first < y->first);
+}
+
+// Cuts the triangles into clusters. A triangle that misses the cache on all three vertices
+// starts a new cluster, since the cache order already restarted there. Each of those is cut
+// again wherever its miss ratio so far is within the threshold of its overall miss ratio.
+static size_t build_clusters(const Mesh* mesh, float threshold, TriangleCluster* clusters, VertexCache* cache) {
+    size_t triangle_count = mesh->indexCount / 3;
+    size_t cluster_count = 0;
+    size_t start = 0;
+    while (start < triangle_count) {
+        size_t end = start + 1;
+        triangle_misses(cache, &mesh->indices[start * 3]);
+        int cluster_misses = 3;
+        while (end < triangle_count) {
+            int misses = triangle_misses(cache, &mesh->indices[end * 3]);
+            if (misses == 3) {
+                break;
+            }
+            cluster_misses += misses;
+            end++;
+        }
+
+        // Replay the cluster from an empty cache and cut it where it is doing well enough
+        float target = threshold * (float)cluster_misses / (float)(end - start);
+        vertex_cache_flush(cache);
+        size_t sub_start = start;
+        int sub_misses = 0;
+        for (size_t t = start; t < end; t++) {
+            sub_misses += triangle_misses(cache, &mesh->indices[t * 3]);
+            if ((float)sub_misses / (float)(t + 1 - sub_start) <= target && t + 1 < end) {
+                clusters[cluster_count++] = (TriangleCluster){sub_start, t + 1 - sub_start, 0.0f};
+                sub_start = t + 1;
+                sub_misses = 0;
+                vertex_cache_flush(cache);
+            }
+        }
+        clusters[cluster_count++] = (TriangleCluster){sub_start, end - sub_start, 0.0f};
+
+        // The triangle that ended the cluster starts the next one from an empty cache
+        vertex_cache_flush(cache);
+        start = end;
+    }
+    return cluster_count;
+}
+
+bool optimize_mesh_overdraw(Mesh* mesh, int cache_size, float threshold) {
+    size_t triangle_count = mesh->indexCount / 3;
+    if (triangle_count == 0) {
+        return true;
+    }
+    TraceZone zone = trace_begin("optimize_mesh_overdraw");
+
+    TriangleCluster* clusters = malloc(triangle_count * sizeof(TriangleCluster));
+    int* indices = malloc(mesh->indexCount * sizeof(int));
+    VertexCache cache = {0};
+    bool ok = clusters && indices && vertex_cache_init(&cache, mesh->vertexCount, cache_size);
+    if (ok) {
+        size_t cluster_count = build_clusters(mesh, threshold, clusters, &cache);
+
+        // Area-weighted center of the whole mesh
+        Vec3 center = {0.0f, 0.0f, 0.0f};
+        float total_area = 0.0f;
+        for (size_t t = 0; t < triangle_count; t++) {
+            float area = vec3_length(front_normal(mesh, &mesh->indices[t * 3]));
+            center = vec3_add(center, vec3_scale(triangle_centroid(mesh, &mesh->indices[t * 3]), area));
+            total_area += area;
+        }
+        center = total_area > 0.0f ? vec3_scale(center, 1.0f / total_area) : center;
+
+        // Clusters far out along the way they face are the likeliest to hide the rest
+        for (size_t i = 0; i < cluster_count; i++) {
+            TriangleCluster* cluster = &clusters[i];
+            Vec3 centroid = {0.0f, 0.0f, 0.0f};
+            Vec3 normal = {0.0f, 0.0f, 0.0f};
+            float area = 0.0f;
+            for (size_t t = cluster->first; t < cluster->first + cluster->count; t++) {
+                Vec3 n = front_normal(mesh, &mesh->indices[t * 3]);
+                float a = vec3_length(n);
+                centroid = vec3_add(centroid, vec3_scale(triangle_centroid(mesh, &mesh->indices[t * 3]), a));
+                normal = vec3_add(normal, n);
+                area += a;
+            }
+            if (area > 0.0f && vec3_length(normal) > 0.0f) {
+                centroid = vec3_scale(centroid, 1.0f / area);
+                cluster->sort_key = vec3_dot(vec3_sub(centroid, center), vec3_normalize(normal));
+            }
+        }
+        qsort(clusters, cluster_count, sizeof(TriangleCluster), compare_clusters);
+
+        size_t written = 0;
+        for (size_t i = 0; i < cluster_count; i++) {
+            size_t count = clusters[i].count * 3;
+            memcpy(&indices[written], &mesh->indices[clusters[i].first * 3], count * sizeof(int));
+            written += count;
+        }
+        memcpy(&indices[written], &mesh->indices[written], (mesh->indexCount - written) * sizeof(int));
+        replace_indices(mesh, indices);
+        indices = NULL;
+    }
+
+    free(clusters);
+    free(indices);
+    free(cache.time);
+    trace_end(zone);
+    return ok;
+}
+
+bool optimize_mesh_vertex_fetch(Mesh* mesh) {
+    if (mesh->vertexCount == 0) {
+        return true;
+    }
+    TraceZone zone = trace_begin("optimize_mesh_vertex_fetch");
+
+    int* remap = malloc(mesh->vertexCount * sizeof(int));
+    Vertex* vertices = malloc(mesh->vertexCount * sizeof(Vertex));
+    int* indices = malloc((mesh->indexCount + 1) * sizeof(int));
+    bool ok = remap && vertices && indices;
+    if (ok) {
+        memset(remap, 0xff, mesh->vertexCount * sizeof(int));
+        int next = 0;
+        for (size_t i = 0; i < mesh->indexCount; i++) {
+            int v = mesh->indices[i];
+            if (remap[v] < 0) {
+                remap[v] = next++;
+            }
+            indices[i] = remap[v];
+        }
+        for (size_t v = 0; v < mesh->vertexCount; v++) {
+            if (remap[v] < 0) {
+                remap[v] = next++;
+            }
+            vertices[remap[v]] = mesh->vertices[v];
+        }
+
+        if (!mapped_file_contains(mesh->mapping, mesh->vertices)) {
+            free(mesh->vertices);
+        }
+        mesh->vertices = vertices;
+        replace_indices(mesh, indices);
+        vertices = NULL;
+        indices = NULL;
+
+        // Separate arrays built before the renumbering follow it
+        if (mesh->arrays) {
+            mesh_build_vertex_arrays(mesh);
+        }
+    }
+
+    free(remap);
+    free(vertices);
+    free(indices);
+    trace_end(zone);
+    return ok;
+}
+
+bool optimize_mesh(Mesh* mesh) {
+    return optimize_mesh_vertex_cache(mesh, MESH_OPTIMIZE_CACHE_SIZE) &&
+           optimize_mesh_overdraw(mesh, MESH_OPTIMIZE_CACHE_SIZE, MESH_OPTIMIZE_OVERDRAW_THRESHOLD) &&
+           optimize_mesh_vertex_fetch(mesh);
+}
@@ -0,0 +1,679 @@
+#include "mesh/mesh.h"
+#include "core/mapped_file.h"
+#include "core/trace.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Chunks smaller than this are not worth a thread of their own
+#define OBJ_MIN_CHUNK_BYTES (1 << 20)
+
+// A face corner: 0-based position and normal indices, with -1 for a missing normal
+typedef struct {
+    int32_t position;
+    int32_t normal;
+} ObjCorner;
+
+// A corner of the face being parsed, before the polygon is fanned out
+typedef struct {
+    ObjCorner corner;
+    bool relative_position;
+    bool relative_normal;
+} PolygonCorner;
+
+// The data parsed from one range of lines. Negative (relative) indices are resolved against the
+// chunk's own element counts and recorded in fixups, to be offset once the counts of every
+// earlier chunk are known. Each fixup is a corner index shifted left by one, with the low bit
+// set for a normal index.
+typedef struct {
+    const char* begin;
+    const char* end;
+    Vec3* positions;
+    Color* colors;
+    size_t position_count;
+    size_t position_capacity;
+    Vec3* normals;
+    size_t normal_count;
+    size_t normal_capacity;
+    ObjCorner* corners;         // Three per triangle, polygons already fanned out
+    size_t corner_count;
+    size_t corner_capacity;
+    uint64_t* fixups;
+    size_t fixup_count;
+    size_t fixup_capacity;
+    PolygonCorner* polygon;     // Scratch space for the corners of the face being parsed
+    size_t polygon_capacity;
+    bool failed;
+} ObjChunk;
+
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool grow_array(void** items, size_t* capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    size_t new_capacity = *capacity ? *capacity : 256;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void* grown = realloc(*items, new_capacity * item_size);
+    if (!grown) {
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skip_separators(const char* p, const char* end) {
+    while (p < end && is_separator(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Parses a decimal float such as -1.25e-3. Up to 19 significant digits are kept, which is
+// far more than a float holds. Returns the end of the number, or NULL if there is none.
+static const char* parse_float(const char* p, const char* end, float* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; p < end && is_digit(*p); p++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+        any = true;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && is_digit(*p); p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+            any = true;
+        }
+    }
+    if (!any) {
+        return NULL;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negative_exponent = *q == '-';
+            q++;
+        }
+        if (q < end && is_digit(*q)) {
+            int value = 0;
+            for (; q < end && is_digit(*q); q++) {
+                if (value < 10000) {
+                    value = value * 10 + (*q - '0');
+                }
+            }
+            exponent += negative_exponent ? -value : value;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    while (exponent > 22 && value != 0.0) {
+        value *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22 && value != 0.0) {
+        value /= 1e22;
+        exponent += 22;
+    }
+    if (value != 0.0) {
+        value = exponent >= 0 ? value * POWERS_OF_TEN[exponent] : value / POWERS_OF_TEN[-exponent];
+    }
+
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+static const char* parse_int(const char* p, const char* end, int64_t* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end || !is_digit(*p)) {
+        return NULL;
+    }
+
+    int64_t value = 0;
+    for (; p < end && is_digit(*p); p++) {
+        value = value * 10 + (*p - '0');
+        if (value > INT32_MAX) {
+            return NULL;
+        }
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+// Converts a 1-based index, or a negative one counting back from the last element, to a
+// 0-based index into the chunk's own elements. Relative indices may point into earlier chunks.
+static bool resolve_index(int64_t index, size_t chunk_count, int32_t* out, bool* relative) {
+    if (index > 0) {
+        *out = (int32_t)(index - 1);
+        *relative = false;
+        return true;
+    }
+    if (index < 0) {
+        int64_t resolved = (int64_t)chunk_count + index;
+        if (resolved < INT32_MIN) {
+            return false;
+        }
+        *out = (int32_t)resolved;
+        *relative = true;
+        return true;
+    }
+    return false;
+}
+
+static uint8_t unit_to_byte(float value) {
+    float clamped = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+    return (uint8_t)(clamped * 255.0f + 0.5f);
+}
+
+static bool parse_vertex(ObjChunk* chunk, const char* p, const char* end) {
+    float values[6];
+    int count = 0;
+    while (count < 6) {
+        p = skip_separators(p, end);
+        const char* next = parse_float(p, end, &values[count]);
+        if (!next) {
+            break;
+        }
+        p = next;
+        count++;
+    }
+    if (count < 3) {
+        return false;
+    }
+
+    // Colors share the positions' capacity
+    if (chunk->position_count == chunk->position_capacity) {
+        size_t capacity = chunk->position_capacity;
+        if (!grow_array((void**)&chunk->colors, &capacity, chunk->position_count + 1, sizeof(Color)) ||
+            !grow_array((void**)&chunk->positions, &chunk->position_capacity, chunk->position_count + 1, sizeof(Vec3))) {
+            return false;
+        }
+    }
+
+    // Six values are positions followed by the widely used per-vertex color extension; a fourth
+    // value alone is the rarely used w, which is ignored
+    Color color = {255, 255, 255, 255};
+    if (count == 6) {
+        color.r = unit_to_byte(values[3]);
+        color.g = unit_to_byte(values[4]);
+        color.b = unit_to_byte(values[5]);
+    }
+    chunk->positions[chunk->position_count] = (Vec3){values[0], values[1], values[2]};
+    chunk->colors[chunk->position_count] = color;
+    chunk->position_count++;
+    return true;
+}
+
+static bool parse_normal(ObjChunk* chunk, const char* p, const char* end) {
+    float values[3];
+    for (int i = 0; i < 3; i++) {
+        p = parse_float(skip_separators(p, end), end, &values[i]);
+        if (!p) {
+            return false;
+        }
+    }
+
+    if (!grow_array((void**)&chunk->normals, &chunk->normal_capacity, chunk->normal_count + 1, sizeof(Vec3))) {
+        return false;
+    }
+    chunk->normals[chunk->normal_count++] = (Vec3){values[0], values[1], values[2]};
+    return true;
+}
+
+static bool push_corner(ObjChunk* chunk, size_t polygon_index) {
+    const PolygonCorner* corner = &chunk->polygon[polygon_index];
+    uint64_t corner_index = chunk->corner_count;
+    chunk->corners[chunk->corner_count++] = corner->corner;
+
+    bool relative_position = corner->relative_position;
+    bool relative_normal = corner->relative_normal;
+    if (!relative_position && !relative_normal) {
+        return true;
+    }
+    if (!grow_array((void**)&chunk->fixups, &chunk->fixup_capacity, chunk->fixup_count + 2, sizeof(uint64_t))) {
+        return false;
+    }
+    if (relative_position) {
+        chunk->fixups[chunk->fixup_count++] = corner_index << 1;
+    }
+    if (relative_normal) {
+        chunk->fixups[chunk->fixup_count++] = corner_index << 1 | 1;
+    }
+    return true;
+}
+
+// Parses the corners of a face ("v", "v/t", "v//n" or "v/t/n" each) and fans the polygon out
+// into triangles around its first corner
+static bool parse_face(ObjChunk* chunk, const char* p, const char* end) {
+    size_t count = 0;
+    for (;;) {
+        p = skip_separators(p, end);
+        if (p == end) {
+            break;
+        }
+
+        int64_t position;
+        int64_t normal = 0;
+        p = parse_int(p, end, &position);
+        if (!p) {
+            return false;
+        }
+        if (p < end && *p == '/') {
+            p++;
+            int64_t texcoord;
+            if (p < end && *p != '/') {
+                p = parse_int(p, end, &texcoord);
+                if (!p) {
+                    return false;
+                }
+            }
+            if (p < end && *p == '/') {
+                p = parse_int(p + 1, end, &normal);
+                if (!p) {
+                    return false;
+                }
+            }
+        }
+        if (p < end && !is_separator(*p)) {
+            return false;
+        }
+
+        if (!grow_array((void**)&chunk->polygon, &chunk->polygon_capacity, count + 1, sizeof(PolygonCorner))) {
+            return false;
+        }
+
+        PolygonCorner* corner = &chunk->polygon[count];
+        if (!resolve_index(position, chunk->position_count, &corner->corner.position, &corner->relative_position)) {
+            return false;
+        }
+        if (normal == 0) {
+            corner->corner.normal = -1;
+            corner->relative_normal = false;
+        } else if (!resolve_index(normal, chunk->normal_count, &corner->corner.normal, &corner->relative_normal)) {
+            return false;
+        }
+        count++;
+    }
+    if (count < 3) {
+        return false;
+    }
+
+    size_t triangles = count - 2;
+    if (!grow_array((void**)&chunk->corners, &chunk->corner_capacity, chunk->corner_count + triangles * 3, sizeof(ObjCorner))) {
+        return false;
+    }
+    for (size_t i = 1; i + 1 < count; i++) {
+        if (!push_corner(chunk, 0) || !push_corner(chunk, i) || !push_corner(chunk, i + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parses every line of a chunk. Unknown statements, texture coordinates, groups and
+// materials are skipped.
+static void parse_chunk(ObjChunk* chunk) {
+    TraceZone zone = trace_begin("parse_obj_chunk");
+    const char* p = chunk->begin;
+    const char* end = chunk->end;
+
+    while (p < end) {
+        const char* line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) {
+            line_end = end;
+        }
+
+        const char* s = skip_separators(p, line_end);
+        bool ok = true;
+        if (line_end - s >= 2 && s[0] == 'v' && is_separator(s[1])) {
+            ok = parse_vertex(chunk, s + 2, line_end);
+        } else if (line_end - s >= 3 && s[0] == 'v' && s[1] == 'n' && is_separator(s[2])) {
+            ok = parse_normal(chunk, s + 3, line_end);
+        } else if (line_end - s >= 2 && s[0] == 'f' && is_separator(s[1])) {
+            ok = parse_face(chunk, s + 2, line_end);
+        }
+
+        if (!ok) {
+            chunk->failed = true;
+            break;
+        }
+        p = line_end + 1;
+    }
+    trace_end(zone);
+}
+
+static void* parse_chunk_main(void* arg) {
+    trace_set_thread_name("obj loader");
+    parse_chunk(arg);
+    return NULL;
+}
+
+static void free_chunk(ObjChunk* chunk) {
+    free(chunk->positions);
+    free(chunk->colors);
+    free(chunk->normals);
+    free(chunk->corners);
+    free(chunk->fixups);
+    free(chunk->polygon);
+}
+
+// Open-addressed map from a (position, normal) pair to the vertex built for it, consulted only
+// for positions that are used with more than one normal
+typedef struct {
+    uint64_t* keys;             // Pair plus one, so that zero marks an empty slot
+    uint32_t* values;
+    size_t capacity;
+    size_t count;
+} CornerMap;
+
+static uint64_t corner_key(ObjCorner corner) {
+    return ((uint64_t)(uint32_t)corner.position << 32 | (uint32_t)(corner.normal + 1)) + 1;
+}
+
+static size_t corner_slot(uint64_t key, size_t capacity) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key & (capacity - 1);
+}
+
+static bool corner_map_grow(CornerMap* map) {
+    size_t capacity = map->capacity ? map->capacity * 2 : 1024;
+    uint64_t* keys = calloc(capacity, sizeof(uint64_t));
+    uint32_t* values = malloc(capacity * sizeof(uint32_t));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->keys[i]) {
+            size_t slot = corner_slot(map->keys[i], capacity);
+            while (keys[slot]) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            keys[slot] = map->keys[i];
+            values[slot] = map->values[i];
+        }
+    }
+
+    free(map->keys);
+    free(map->values);
+    map->keys = keys;
+    map->values = values;
+    map->capacity = capacity;
+    return true;
+}
+
+// Finds the vertex for a corner, or returns the slot where a new one should be recorded
+static uint32_t* corner_map_find(CornerMap* map, ObjCorner corner, bool* found) {
+    if ((map->count + 1) * 2 > map->capacity && !corner_map_grow(map)) {
+        return NULL;
+    }
+
+    uint64_t key = corner_key(corner);
+    size_t slot = corner_slot(key, map->capacity);
+    while (map->keys[slot] && map->keys[slot] != key) {
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    *found = map->keys[slot] != 0;
+    if (!*found) {
+        map->keys[slot] = key;
+        map->count++;
+    }
+    return &map->values[slot];
+}
+
+// Turns the parsed chunks into an indexed mesh, creating one vertex per distinct
+// (position, normal) pair in order of first use
+static Mesh* build_mesh(ObjChunk* chunks, int chunk_count) {
+    TraceZone zone = trace_begin("build_obj_mesh");
+    size_t position_total = 0;
+    size_t normal_total = 0;
+    size_t corner_total = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        position_total += chunks[i].position_count;
+        normal_total += chunks[i].normal_count;
+        corner_total += chunks[i].corner_count;
+    }
+    if (position_total == 0 || corner_total == 0 || position_total > INT32_MAX || corner_total > INT32_MAX) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    Vec3* positions = malloc(position_total * sizeof(Vec3));
+    Color* colors = malloc(position_total * sizeof(Color));
+    Vec3* normals = malloc((normal_total ? normal_total : 1) * sizeof(Vec3));
+    int32_t* first_normal = malloc(position_total * sizeof(int32_t));
+    uint32_t* first_vertex = malloc(position_total * sizeof(uint32_t));
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    CornerMap map = {0};
+    size_t vertex_capacity = position_total;
+    if (mesh) {
+        mesh->vertices = malloc(vertex_capacity * sizeof(Vertex));
+        mesh->indices = malloc(corner_total * sizeof(int));
+    }
+    bool ok = positions && colors && normals && first_normal && first_vertex && mesh && mesh->vertices && mesh->indices;
+
+    // Gather the elements of every chunk and rebase each chunk's relative indices
+    size_t position_base = 0;
+    size_t normal_base = 0;
+    for (int i = 0; ok && i < chunk_count; i++) {
+        ObjChunk* chunk = &chunks[i];
+        memcpy(positions + position_base, chunk->positions, chunk->position_count * sizeof(Vec3));
+        memcpy(colors + position_base, chunk->colors, chunk->position_count * sizeof(Color));
+        if (chunk->normal_count) {
+            memcpy(normals + normal_base, chunk->normals, chunk->normal_count * sizeof(Vec3));
+        }
+        for (size_t f = 0; f < chunk->fixup_count; f++) {
+            ObjCorner* corner = &chunk->corners[chunk->fixups[f] >> 1];
+            int32_t* index = (chunk->fixups[f] & 1) ? &corner->normal : &corner->position;
+            int64_t rebased = (int64_t)*index + (int64_t)((chunk->fixups[f] & 1) ? normal_base : position_base);
+            if (rebased < 0) {
+                ok = false;
+                break;
+            }
+            *index = (int32_t)rebased;
+        }
+        position_base += chunk->position_count;
+        normal_base += chunk->normal_count;
+    }
+
+    for (size_t i = 0; ok && i < position_total; i++) {
+        first_normal[i] = INT32_MIN;
+    }
+
+    // Most positions are only ever paired with one normal, so the first pairing of each is kept
+    // in flat arrays and the hash map only sees the seams where normals split
+    size_t vertex_count = 0;
+    size_t index = 0;
+    for (int i = 0; ok && i < chunk_count; i++) {
+        const ObjChunk* chunk = &chunks[i];
+        for (size_t c = 0; c < chunk->corner_count; c++) {
+            ObjCorner corner = chunk->corners[c];
+            if (corner.position < 0 || (size_t)corner.position >= position_total ||
+                corner.normal < -1 || (corner.normal >= 0 && (size_t)corner.normal >= normal_total)) {
+                ok = false;
+                break;
+            }
+
+            uint32_t* vertex_slot;
+            bool found;
+            if (first_normal[corner.position] == INT32_MIN) {
+                first_normal[corner.position] = corner.normal;
+                vertex_slot = &first_vertex[corner.position];
+                found = false;
+            } else if (first_normal[corner.position] == corner.normal) {
+                vertex_slot = &first_vertex[corner.position];
+                found = true;
+            } else {
+                vertex_slot = corner_map_find(&map, corner, &found);
+                if (!vertex_slot) {
+                    ok = false;
+                    break;
+                }
+            }
+
+            if (!found) {
+                if (vertex_count == vertex_capacity) {
+                    Vertex* vertices = realloc(mesh->vertices, vertex_capacity * 2 * sizeof(Vertex));
+                    if (!vertices) {
+                        ok = false;
+                        break;
+                    }
+                    mesh->vertices = vertices;
+                    vertex_capacity *= 2;
+                }
+                Vec3 p = positions[corner.position];
+                Vec3 n = corner.normal >= 0 ? normals[corner.normal] : (Vec3){0.0f, 0.0f, 0.0f};
+                mesh->vertices[vertex_count] = (Vertex){{p.x, p.y, p.z, 1.0f}, n, colors[corner.position]};
+                *vertex_slot = (uint32_t)vertex_count++;
+            }
+            mesh->indices[index++] = (int)*vertex_slot;
+        }
+    }
+
+    free(positions);
+    free(colors);
+    free(normals);
+    free(first_normal);
+    free(first_vertex);
+    free(map.keys);
+    free(map.values);
+
+    if (!ok) {
+        destroy_mesh(mesh);
+        trace_end(zone);
+        return NULL;
+    }
+
+    Vertex* vertices = realloc(mesh->vertices, vertex_count * sizeof(Vertex));
+    if (vertices) {
+        mesh->vertices = vertices;
+    }
+    mesh->vertexCount = vertex_count;
+    mesh->indexCount = corner_total;
+    trace_end(zone);
+    return mesh;
+}
+
+Mesh* load_mesh_from_obj_parallel(const char* filepath, int thread_count) {
+    TraceZone zone = trace_begin("load_mesh_from_obj");
+    MappedFile* file = map_file(filepath);
+    if (!file) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    const char* text = (const char*)file->data;
+    size_t size = file->size;
+    int chunk_count = thread_count > 1 ? thread_count : 1;
+    if ((size_t)chunk_count > size / OBJ_MIN_CHUNK_BYTES) {
+        chunk_count = size / OBJ_MIN_CHUNK_BYTES > 1 ? (int)(size / OBJ_MIN_CHUNK_BYTES) : 1;
+    }
+
+    ObjChunk* chunks = calloc(chunk_count, sizeof(ObjChunk));
+    pthread_t* threads = calloc(chunk_count, sizeof(pthread_t));
+    bool* started = calloc(chunk_count, sizeof(bool));
+    if (!chunks || !threads || !started) {
+        free(chunks);
+        free(threads);
+        free(started);
+        unmap_file(file);
+        trace_end(zone);
+        return NULL;
+    }
+
+    // Split into roughly equal ranges, each extended to the end of the line it stops in
+    const char* begin = text;
+    for (int i = 0; i < chunk_count; i++) {
+        const char* end = text + size;
+        if (i + 1 < chunk_count) {
+            end = text + size / chunk_count * (i + 1);
+            if (end < begin) {
+                end = begin;
+            }
+            const char* newline = memchr(end, '\n', (size_t)(text + size - end));
+            end = newline ? newline + 1 : text + size;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+
+    // The calling thread parses the first chunk while the others run on their own threads
+    for (int i = 1; i < chunk_count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, parse_chunk_main, &chunks[i]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    bool ok = !chunks[0].failed;
+    for (int i = 1; i < chunk_count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            parse_chunk(&chunks[i]);
+        }
+        ok = ok && !chunks[i].failed;
+    }
+
+    Mesh* mesh = ok ? build_mesh(chunks, chunk_count) : NULL;
+    if (!mesh) {
+        fprintf(stderr, "Failed to load OBJ mesh from %s\n", filepath);
+    }
+
+    for (int i = 0; i < chunk_count; i++) {
+        free_chunk(&chunks[i]);
+    }
+    free(chunks);
+    free(threads);
+    free(started);
+    unmap_file(file);
+    trace_end(zone);
+    return mesh;
+}
+
+Mesh* load_mesh_from_obj(const char* filepath) {
+    return load_mesh_from_obj_parallel(filepath, 1);
+}
@@ -0,0 +1,433 @@
+#include "mesh/mesh.h"
+#include "core/chunk_reader.h"
+#include "core/trace.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLY_CHUNK_SIZE (1 << 20)
+#define PLY_MAX_PROPERTIES 32
+#define PLY_MAX_ELEMENTS 16
+#define PLY_MAX_FACE_CORNERS 256
+
+typedef enum {
+    PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64,
+    PLY_TYPE_INVALID
+} PlyType;
+
+// Properties the loader reads; every other property is skipped
+typedef enum {
+    PLY_ROLE_NONE,
+    PLY_ROLE_X, PLY_ROLE_Y, PLY_ROLE_Z,
+    PLY_ROLE_NX, PLY_ROLE_NY, PLY_ROLE_NZ,
+    PLY_ROLE_RED, PLY_ROLE_GREEN, PLY_ROLE_BLUE, PLY_ROLE_ALPHA,
+    PLY_ROLE_VERTEX_INDICES
+} PlyRole;
+
+typedef struct {
+    PlyType type;
+    PlyType count_type;         // Type of a list's length; PLY_TYPE_INVALID for scalars
+    PlyRole role;
+    size_t offset;              // Byte offset within a fixed-size record
+} PlyProperty;
+
+typedef struct {
+    char name[32];
+    size_t count;
+    PlyProperty properties[PLY_MAX_PROPERTIES];
+    int property_count;
+    size_t record_size;         // Size of one record, or 0 if it holds a list
+} PlyElement;
+
+typedef struct {
+    PlyElement elements[PLY_MAX_ELEMENTS];
+    int element_count;
+    bool big_endian;
+} PlyHeader;
+
+static const size_t PLY_TYPE_SIZES[] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+static PlyType parse_type(const char* name) {
+    static const struct { const char* name; PlyType type; } TYPES[] = {
+        {"char", PLY_INT8}, {"int8", PLY_INT8}, {"uchar", PLY_UINT8}, {"uint8", PLY_UINT8},
+        {"short", PLY_INT16}, {"int16", PLY_INT16}, {"ushort", PLY_UINT16}, {"uint16", PLY_UINT16},
+        {"int", PLY_INT32}, {"int32", PLY_INT32}, {"uint", PLY_UINT32}, {"uint32", PLY_UINT32},
+        {"float", PLY_FLOAT32}, {"float32", PLY_FLOAT32}, {"double", PLY_FLOAT64}, {"float64", PLY_FLOAT64}
+    };
+    for (size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); i++) {
+        if (strcmp(name, TYPES[i].name) == 0) {
+            return TYPES[i].type;
+        }
+    }
+    return PLY_TYPE_INVALID;
+}
+
+static PlyRole parse_role(const char* element, const char* property) {
+    if (strcmp(element, "vertex") == 0) {
+        static const struct { const char* name; PlyRole role; } ROLES[] = {
+            {"x", PLY_ROLE_X}, {"y", PLY_ROLE_Y}, {"z", PLY_ROLE_Z},
+            {"nx", PLY_ROLE_NX}, {"ny", PLY_ROLE_NY}, {"nz", PLY_ROLE_NZ},
+            {"red", PLY_ROLE_RED}, {"green", PLY_ROLE_GREEN}, {"blue", PLY_ROLE_BLUE}, {"alpha", PLY_ROLE_ALPHA}
+        };
+        for (size_t i = 0; i < sizeof(ROLES) / sizeof(ROLES[0]); i++) {
+            if (strcmp(property, ROLES[i].name) == 0) {
+                return ROLES[i].role;
+            }
+        }
+    } else if (strcmp(element, "face") == 0 &&
+               (strcmp(property, "vertex_indices") == 0 || strcmp(property, "vertex_index") == 0)) {
+        return PLY_ROLE_VERTEX_INDICES;
+    }
+    return PLY_ROLE_NONE;
+}
+
+// Splits a header line into at most max_words space-separated, terminated words
+static int split_words(const char* line, size_t length, char words[][32], int max_words) {
+    int count = 0;
+    size_t i = 0;
+    while (i < length && count < max_words) {
+        while (i < length && (line[i] == ' ' || line[i] == '\t')) {
+            i++;
+        }
+        if (i == length) {
+            break;
+        }
+        size_t n = 0;
+        while (i < length && line[i] != ' ' && line[i] != '\t') {
+            if (n + 1 < sizeof(words[0])) {
+                words[count][n++] = line[i];
+            }
+            i++;
+        }
+        words[count][n] = '\0';
+        count++;
+    }
+    return count;
+}
+
+static bool parse_header(ChunkReader* reader, PlyHeader* header) {
+    size_t length;
+    const char* line = chunk_reader_line(reader, &length);
+    if (!line || length != 3 || memcmp(line, "ply", 3) != 0) {
+        return false;
+    }
+
+    bool has_format = false;
+    PlyElement* element = NULL;
+    while ((line = chunk_reader_line(reader, &length))) {
+        char words[5][32];
+        int count = split_words(line, length, words, 5);
+        if (count == 0 || strcmp(words[0], "comment") == 0 || strcmp(words[0], "obj_info") == 0) {
+            continue;
+        }
+
+        if (strcmp(words[0], "end_header") == 0) {
+            return has_format;
+        } else if (strcmp(words[0], "format") == 0 && count >= 2) {
+            // Only binary files are read; text PLY is rare for large scans
+            if (strcmp(words[1], "binary_little_endian") == 0) {
+                header->big_endian = false;
+            } else if (strcmp(words[1], "binary_big_endian") == 0) {
+                header->big_endian = true;
+            } else {
+                return false;
+            }
+            has_format = true;
+        } else if (strcmp(words[0], "element") == 0 && count >= 3) {
+            if (header->element_count == PLY_MAX_ELEMENTS) {
+                return false;
+            }
+            element = &header->elements[header->element_count++];
+            snprintf(element->name, sizeof(element->name), "%s", words[1]);
+            char* end;
+            element->count = (size_t)strtoull(words[2], &end, 10);
+            if (*end != '\0') {
+                return false;
+            }
+        } else if (strcmp(words[0], "property") == 0 && element) {
+            if (element->property_count == PLY_MAX_PROPERTIES) {
+                return false;
+            }
+            PlyProperty* property = &element->properties[element->property_count++];
+            if (count >= 5 && strcmp(words[1], "list") == 0) {
+                property->count_type = parse_type(words[2]);
+                property->type = parse_type(words[3]);
+                property->role = parse_role(element->name, words[4]);
+                if (property->count_type == PLY_TYPE_INVALID || property->type == PLY_TYPE_INVALID) {
+                    return false;
+                }
+            } else if (count >= 3) {
+                property->count_type = PLY_TYPE_INVALID;
+                property->type = parse_type(words[1]);
+                property->role = parse_role(element->name, words[2]);
+                if (property->type == PLY_TYPE_INVALID) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void compute_record_layout(PlyElement* element) {
+    size_t offset = 0;
+    for (int i = 0; i < element->property_count; i++) {
+        PlyProperty* property = &element->properties[i];
+        if (property->count_type != PLY_TYPE_INVALID) {
+            element->record_size = 0;
+            return;
+        }
+        property->offset = offset;
+        offset += PLY_TYPE_SIZES[property->type];
+    }
+    element->record_size = offset;
+}
+
+static double read_value(const unsigned char* p, PlyType type, bool big_endian) {
+    unsigned char bytes[8];
+    size_t size = PLY_TYPE_SIZES[type];
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = big_endian ? p[size - 1 - i] : p[i];
+    }
+
+    // Values are assembled little-endian, so this is correct on any host byte order
+    uint64_t bits = 0;
+    for (size_t i = 0; i < size; i++) {
+        bits |= (uint64_t)bytes[i] << (8 * i);
+    }
+    switch (type) {
+        case PLY_INT8:    return (int8_t)bits;
+        case PLY_UINT8:   return (uint8_t)bits;
+        case PLY_INT16:   return (int16_t)bits;
+        case PLY_UINT16:  return (uint16_t)bits;
+        case PLY_INT32:   return (int32_t)bits;
+        case PLY_UINT32:  return (uint32_t)bits;
+        case PLY_FLOAT32: { uint32_t b = (uint32_t)bits; float f; memcpy(&f, &b, sizeof(f)); return f; }
+        case PLY_FLOAT64: { double d; memcpy(&d, &bits, sizeof(d)); return d; }
+        default:          return 0.0;
+    }
+}
+
+// Color channels are bytes, or fractions for float types, and 16-bit values are scaled down
+static uint8_t read_channel(const unsigned char* p, PlyType type, bool big_endian) {
+    double value = read_value(p, type, big_endian);
+    if (type == PLY_FLOAT32 || type == PLY_FLOAT64) {
+        value *= 255.0;
+    } else if (type == PLY_UINT16) {
+        value /= 257.0;
+    }
+    return (uint8_t)(value < 0.0 ? 0.0 : value > 255.0 ? 255.0 : value + 0.5);
+}
+
+static bool read_vertices(ChunkReader* reader, const PlyElement* element, bool big_endian, Mesh* mesh) {
+    if (element->record_size == 0 || element->count == 0 || element->count > INT32_MAX) {
+        return false;
+    }
+
+    // Positions are required; normals and colors are optional
+    unsigned roles = 0;
+    for (int i = 0; i < element->property_count; i++) {
+        roles |= 1u << element->properties[i].role;
+    }
+    unsigned position_roles = 1u << PLY_ROLE_X | 1u << PLY_ROLE_Y | 1u << PLY_ROLE_Z;
+    if ((roles & position_roles) != position_roles) {
+        return false;
+    }
+    mesh->vertices = malloc(element->count * sizeof(Vertex));
+    if (!mesh->vertices) {
+        return false;
+    }
+
+    for (size_t v = 0; v < element->count; v++) {
+        const unsigned char* record = chunk_reader_take(reader, element->record_size);
+        if (!record) {
+            return false;
+        }
+
+        Vertex vertex = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {255, 255, 255, 255}};
+        for (int i = 0; i < element->property_count; i++) {
+            const PlyProperty* property = &element->properties[i];
+            const unsigned char* p = record + property->offset;
+            switch (property->role) {
+                case PLY_ROLE_X:     vertex.position.x = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_Y:     vertex.position.y = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_Z:     vertex.position.z = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_NX:    vertex.normal.x = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_NY:    vertex.normal.y = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_NZ:    vertex.normal.z = (float)read_value(p, property->type, big_endian); break;
+                case PLY_ROLE_RED:   vertex.color.r = read_channel(p, property->type, big_endian); break;
+                case PLY_ROLE_GREEN: vertex.color.g = read_channel(p, property->type, big_endian); break;
+                case PLY_ROLE_BLUE:  vertex.color.b = read_channel(p, property->type, big_endian); break;
+                case PLY_ROLE_ALPHA: vertex.color.a = read_channel(p, property->type, big_endian); break;
+                default: break;
+            }
+        }
+        mesh->vertices[mesh->vertexCount++] = vertex;
+    }
+    return true;
+}
+
+// Reads one record of an element that holds lists. When corners is given, the vertex index
+// list is stored there and its length returned through corner_count.
+static bool read_list_record(ChunkReader* reader, const PlyElement* element, bool big_endian,
+                             int64_t* corners, size_t* corner_count) {
+    for (int i = 0; i < element->property_count; i++) {
+        const PlyProperty* property = &element->properties[i];
+        size_t count = 1;
+        if (property->count_type != PLY_TYPE_INVALID) {
+            const unsigned char* p = chunk_reader_take(reader, PLY_TYPE_SIZES[property->count_type]);
+            if (!p) {
+                return false;
+            }
+            double length = read_value(p, property->count_type, big_endian);
+            if (length < 0.0 || length > PLY_MAX_FACE_CORNERS) {
+                return false;
+            }
+            count = (size_t)length;
+        }
+
+        size_t size = PLY_TYPE_SIZES[property->type];
+        const unsigned char* p = chunk_reader_take(reader, count * size);
+        if (!p && count > 0) {
+            return false;
+        }
+        if (corners && property->role == PLY_ROLE_VERTEX_INDICES) {
+            for (size_t c = 0; c < count; c++) {
+                corners[c] = (int64_t)read_value(p + c * size, property->type, big_endian);
+            }
+            *corner_count = count;
+        }
+    }
+    return true;
+}
+
+// Reads the faces, fanning polygons into triangles
+static bool read_faces(ChunkReader* reader, const PlyElement* element, bool big_endian, Mesh* mesh) {
+    size_t capacity = element->count * 3;
+    mesh->indices = malloc((capacity ? capacity : 1) * sizeof(int));
+    if (!mesh->indices) {
+        return false;
+    }
+
+    int64_t corners[PLY_MAX_FACE_CORNERS];
+    for (size_t f = 0; f < element->count; f++) {
+        size_t corner_count = 0;
+        if (!read_list_record(reader, element, big_endian, corners, &corner_count)) {
+            return false;
+        }
+        for (size_t c = 0; c < corner_count; c++) {
+            if (corners[c] < 0 || (uint64_t)corners[c] >= mesh->vertexCount) {
+                return false;
+            }
+        }
+        if (corner_count < 3) {
+            continue;
+        }
+
+        size_t needed = mesh->indexCount + (corner_count - 2) * 3;
+        if (needed > INT32_MAX) {
+            return false;
+        }
+        if (needed > capacity) {
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+            int* indices = realloc(mesh->indices, capacity * sizeof(int));
+            if (!indices) {
+                return false;
+            }
+            mesh->indices = indices;
+        }
+        for (size_t c = 1; c + 1 < corner_count; c++) {
+            mesh->indices[mesh->indexCount++] = (int)corners[0];
+            mesh->indices[mesh->indexCount++] = (int)corners[c];
+            mesh->indices[mesh->indexCount++] = (int)corners[c + 1];
+        }
+    }
+
+    int* indices = realloc(mesh->indices, (mesh->indexCount ? mesh->indexCount : 1) * sizeof(int));
+    if (indices) {
+        mesh->indices = indices;
+    }
+    return true;
+}
+
+// Checks the element's count against the bytes left in the file, taking the smallest size a
+// record can have, so that a corrupt or truncated header cannot make the readers allocate
+// far more than the file could fill
+static bool element_fits(const ChunkReader* reader, const PlyElement* element) {
+    uint64_t min_record_size = 0;
+    for (int i = 0; i < element->property_count; i++) {
+        const PlyProperty* property = &element->properties[i];
+        PlyType type = property->count_type != PLY_TYPE_INVALID ? property->count_type : property->type;
+        min_record_size += PLY_TYPE_SIZES[type];
+    }
+    if (min_record_size == 0) {
+        return element->count == 0;
+    }
+    return element->count <= chunk_reader_remaining(reader) / min_record_size;
+}
+
+static bool skip_element(ChunkReader* reader, const PlyElement* element, bool big_endian) {
+    for (size_t i = 0; i < element->count; i++) {
+        bool ok = element->record_size > 0 ? chunk_reader_take(reader, element->record_size) != NULL
+                                           : read_list_record(reader, element, big_endian, NULL, NULL);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Mesh* load_mesh_from_ply(const char* filepath) {
+    TraceZone zone = trace_begin("load_mesh_from_ply");
+    ChunkReader* reader = create_chunk_reader(filepath, PLY_CHUNK_SIZE);
+    if (!reader) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    PlyHeader* header = calloc(1, sizeof(PlyHeader));
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    bool ok = header && mesh && parse_header(reader, header);
+
+    // Elements are stored in header order; faces can only refer to vertices read before them
+    bool has_vertices = false;
+    bool has_faces = false;
+    for (int i = 0; ok && i < header->element_count; i++) {
+        PlyElement* element = &header->elements[i];
+        compute_record_layout(element);
+        if (!element_fits(reader, element)) {
+            fprintf(stderr, "%s: the header gives %zu %s elements, more than the rest of the file can hold\n",
+                    filepath, element->count, element->name);
+            ok = false;
+        } else if (strcmp(element->name, "vertex") == 0 && !has_vertices) {
+            ok = read_vertices(reader, element, header->big_endian, mesh);
+            has_vertices = true;
+        } else if (strcmp(element->name, "face") == 0 && has_vertices && !has_faces) {
+            ok = read_faces(reader, element, header->big_endian, mesh);
+            has_faces = true;
+        } else {
+            ok = skip_element(reader, element, header->big_endian);
+        }
+    }
+    ok = ok && has_faces && mesh->indexCount > 0;
+
+    free(header);
+    destroy_chunk_reader(reader);
+    if (!ok) {
+        fprintf(stderr, "Failed to load binary PLY mesh from %s\n", filepath);
+        destroy_mesh(mesh);
+        trace_end(zone);
+        return NULL;
+    }
+
+    trace_end(zone);
+    return mesh;
+}
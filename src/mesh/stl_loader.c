@@ -0,0 +1,174 @@
+#include "mesh/mesh.h"
+#include "core/chunk_reader.h"
+#include "core/trace.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STL_HEADER_SIZE 80
+#define STL_RECORD_SIZE 50      // Facet normal, three corners and a 16-bit attribute
+#define STL_RECORDS_PER_CHUNK 20000
+#define WELD_EMPTY UINT32_MAX
+
+// Spatial hash welding bit-identical corner positions into shared vertices. Slots hold vertex
+// indices; positions are compared against the vertices themselves, so a slot costs 4 bytes.
+typedef struct {
+    uint32_t* slots;
+    size_t capacity;
+} WeldTable;
+
+static float read_float_le(const unsigned char* p) {
+    uint32_t bits = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    // Adding zero turns -0 into +0, so both weld together
+    return value + 0.0f;
+}
+
+static size_t weld_slot(Vec3 p, size_t capacity) {
+    uint32_t bits[3];
+    memcpy(bits, &p, sizeof(bits));
+    uint64_t h = bits[0] * 0x9e3779b97f4a7c15ULL;
+    h ^= (h >> 29) ^ bits[1] * 0xbf58476d1ce4e5b9ULL;
+    h ^= (h >> 32) ^ bits[2] * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (size_t)h & (capacity - 1);
+}
+
+static bool same_position(Vec4 a, Vec3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool weld_table_resize(WeldTable* table, const Vertex* vertices, size_t vertex_count, size_t capacity) {
+    uint32_t* slots = malloc(capacity * sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < vertex_count; i++) {
+        Vec4 p = vertices[i].position;
+        size_t slot = weld_slot((Vec3){p.x, p.y, p.z}, capacity);
+        while (slots[slot] != WELD_EMPTY) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = (uint32_t)i;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return true;
+}
+
+// Returns the vertex at a position, appending one if it is new
+static bool weld_vertex(WeldTable* table, Mesh* mesh, size_t* vertex_capacity, Vec3 p, int* out_index) {
+    size_t slot = weld_slot(p, table->capacity);
+    while (table->slots[slot] != WELD_EMPTY) {
+        if (same_position(mesh->vertices[table->slots[slot]].position, p)) {
+            *out_index = (int)table->slots[slot];
+            return true;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    if (mesh->vertexCount == *vertex_capacity) {
+        size_t capacity = *vertex_capacity * 2;
+        Vertex* vertices = realloc(mesh->vertices, capacity * sizeof(Vertex));
+        if (!vertices) {
+            return false;
+        }
+        mesh->vertices = vertices;
+        *vertex_capacity = capacity;
+    }
+
+    size_t index = mesh->vertexCount++;
+    mesh->vertices[index] = (Vertex){{p.x, p.y, p.z, 1.0f}, {0.0f, 0.0f, 0.0f}, {255, 255, 255, 255}};
+    table->slots[slot] = (uint32_t)index;
+    *out_index = (int)index;
+
+    // Keep the table at most half full
+    if (mesh->vertexCount * 2 > table->capacity) {
+        return weld_table_resize(table, mesh->vertices, mesh->vertexCount, table->capacity * 2);
+    }
+    return true;
+}
+
+Mesh* load_mesh_from_stl(const char* filepath) {
+    TraceZone zone = trace_begin("load_mesh_from_stl");
+    ChunkReader* reader = create_chunk_reader(filepath, (size_t)STL_RECORD_SIZE * STL_RECORDS_PER_CHUNK);
+    if (!reader) {
+        trace_end(zone);
+        return NULL;
+    }
+
+    const unsigned char* header = chunk_reader_take(reader, STL_HEADER_SIZE + 4);
+    uint32_t triangle_count = 0;
+    if (header) {
+        const unsigned char* p = header + STL_HEADER_SIZE;
+        triangle_count = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    // The records must fill the rest of the file exactly. This rejects truncated files and
+    // ASCII STL, whose text would otherwise be read as a huge count, before anything is allocated.
+    if (header && (uint64_t)triangle_count * STL_RECORD_SIZE != chunk_reader_remaining(reader)) {
+        if (memcmp(header, "solid", 5) == 0) {
+            fprintf(stderr, "%s looks like an ASCII STL file, which is not supported\n", filepath);
+        } else {
+            fprintf(stderr, "%s is not a binary STL file: its header gives %u triangles for %llu bytes of records\n",
+                    filepath, triangle_count, (unsigned long long)chunk_reader_remaining(reader));
+        }
+        destroy_chunk_reader(reader);
+        trace_end(zone);
+        return NULL;
+    }
+
+    // Indices are sized exactly from the header. A closed surface has about half as many
+    // vertices as triangles, which is where the vertex array starts.
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    WeldTable table = {0};
+    size_t vertex_capacity = triangle_count / 2 + 16;
+    bool ok = header && triangle_count > 0 && (uint64_t)triangle_count * 3 <= INT32_MAX && mesh;
+    if (ok) {
+        mesh->vertices = malloc(vertex_capacity * sizeof(Vertex));
+        mesh->indices = malloc((size_t)triangle_count * 3 * sizeof(int));
+        size_t table_capacity = 64;
+        while (table_capacity < vertex_capacity * 2) {
+            table_capacity *= 2;
+        }
+        ok = mesh->vertices && mesh->indices && weld_table_resize(&table, NULL, 0, table_capacity);
+    }
+
+    for (uint32_t t = 0; ok && t < triangle_count; t++) {
+        const unsigned char* record = chunk_reader_take(reader, STL_RECORD_SIZE);
+        if (!record) {
+            ok = false;
+            break;
+        }
+
+        // The stored facet normal is skipped; shading derives it from the corners
+        for (int corner = 0; corner < 3 && ok; corner++) {
+            const unsigned char* p = record + 12 + corner * 12;
+            Vec3 position = {read_float_le(p), read_float_le(p + 4), read_float_le(p + 8)};
+            ok = weld_vertex(&table, mesh, &vertex_capacity, position, &mesh->indices[mesh->indexCount++]);
+        }
+    }
+
+    free(table.slots);
+    destroy_chunk_reader(reader);
+    if (!ok) {
+        fprintf(stderr, "Failed to load binary STL mesh from %s\n", filepath);
+        destroy_mesh(mesh);
+        trace_end(zone);
+        return NULL;
+    }
+
+    Vertex* vertices = realloc(mesh->vertices, mesh->vertexCount * sizeof(Vertex));
+    if (vertices) {
+        mesh->vertices = vertices;
+    }
+    trace_end(zone);
+    return mesh;
+}
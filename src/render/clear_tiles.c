@@ -0,0 +1,109 @@
+#include "render/clear_tiles.h"
+#include "core/trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+ClearTiles* create_clear_tiles(int width, int height, DepthFormat depth_format) {
+    ClearTiles* clear = calloc(1, sizeof(ClearTiles));
+    if (!clear) {
+        return NULL;
+    }
+
+    clear->width = width;
+    clear->height = height;
+    clear->tiles_x = (width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+    clear->tiles_y = (height + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+    clear->pending = calloc(clear->tiles_x * clear->tiles_y, 1);
+    if (!clear->pending) {
+        free(clear);
+        return NULL;
+    }
+
+    clear->depth_size = depth_format_size(depth_format);
+    for (int i = 0; i < CLEAR_TILE_SIZE; i++) {
+        depth_format_clear_value(depth_format, &clear->depth_row[i * clear->depth_size]);
+    }
+    return clear;
+}
+
+void destroy_clear_tiles(ClearTiles* clear) {
+    if (!clear) {
+        return;
+    }
+    free(clear->pending);
+    free(clear);
+}
+
+void clear_tiles_begin(ClearTiles* clear, Color color) {
+    for (int i = 0; i < CLEAR_TILE_SIZE; i++) {
+        clear->color_row[i] = color;
+    }
+    memset(clear->pending, CLEAR_COLOR_PENDING | CLEAR_DEPTH_PENDING, clear->tiles_x * clear->tiles_y);
+}
+
+// Copies the clear values over count consecutive pixels starting at index
+static void fill_run(ClearTiles* clear, PixelBuffer* buffer, void* depth_buffer, size_t index, int count, unsigned char flags) {
+    for (int done = 0; done < count; done += CLEAR_TILE_SIZE) {
+        int n = count - done < CLEAR_TILE_SIZE ? count - done : CLEAR_TILE_SIZE;
+        if (flags & CLEAR_COLOR_PENDING) {
+            memcpy(&buffer->pixels[index + done], clear->color_row, n * sizeof(Color));
+        }
+        if (flags & CLEAR_DEPTH_PENDING) {
+            memcpy((unsigned char*)depth_buffer + (index + done) * clear->depth_size, clear->depth_row, n * clear->depth_size);
+        }
+    }
+}
+
+// Copies the clear values over the parts of one tile that are still pending
+static void fill_tile(ClearTiles* clear, PixelBuffer* buffer, void* depth_buffer, int tile_x, int tile_y, unsigned char flags) {
+    int x0 = tile_x * CLEAR_TILE_SIZE;
+    int y0 = tile_y * CLEAR_TILE_SIZE;
+    int w = buffer->storage_width - x0 < CLEAR_TILE_SIZE ? buffer->storage_width - x0 : CLEAR_TILE_SIZE;
+    int h = buffer->storage_height - y0 < CLEAR_TILE_SIZE ? buffer->storage_height - y0 : CLEAR_TILE_SIZE;
+
+    if (buffer->layout == PIXEL_LAYOUT_LINEAR) {
+        for (int y = y0; y < y0 + h; y++) {
+            fill_run(clear, buffer, depth_buffer, pixel_index(buffer, x0, y), w, flags);
+        }
+        return;
+    }
+
+    // The pixel tiles along one tile row of a clear tile are stored back to back
+    for (int y = y0; y < y0 + h; y += PIXEL_TILE_SIZE) {
+        fill_run(clear, buffer, depth_buffer, pixel_index(buffer, x0, y), w * PIXEL_TILE_SIZE, flags);
+    }
+}
+
+void clear_tiles_resolve(ClearTiles* clear, PixelBuffer* buffer, void* depth_buffer, int x0, int y0, int x1, int y1) {
+    x0 = x0 > 0 ? x0 : 0;
+    y0 = y0 > 0 ? y0 : 0;
+    x1 = x1 < clear->width - 1 ? x1 : clear->width - 1;
+    y1 = y1 < clear->height - 1 ? y1 : clear->height - 1;
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    for (int ty = y0 / CLEAR_TILE_SIZE; ty <= y1 / CLEAR_TILE_SIZE; ty++) {
+        for (int tx = x0 / CLEAR_TILE_SIZE; tx <= x1 / CLEAR_TILE_SIZE; tx++) {
+            unsigned char* flags = &clear->pending[ty * clear->tiles_x + tx];
+            if (*flags) {
+                fill_tile(clear, buffer, depth_buffer, tx, ty, *flags);
+                *flags = 0;
+            }
+        }
+    }
+}
+
+void clear_tiles_resolve_color(ClearTiles* clear, PixelBuffer* buffer) {
+    TraceZone zone = trace_begin("clear_tiles_resolve_color");
+    for (int ty = 0; ty < clear->tiles_y; ty++) {
+        for (int tx = 0; tx < clear->tiles_x; tx++) {
+            unsigned char* flags = &clear->pending[ty * clear->tiles_x + tx];
+            if (*flags & CLEAR_COLOR_PENDING) {
+                fill_tile(clear, buffer, NULL, tx, ty, CLEAR_COLOR_PENDING);
+                *flags &= ~CLEAR_COLOR_PENDING;
+            }
+        }
+    }
+    trace_end(zone);
+}
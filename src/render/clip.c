@@ -0,0 +1,148 @@
+#include "render/clip.h"
+
+// Planes the polygon is clipped against, as dot(plane, v) >= 0 for the inside
+static const Vec4 CLIP_PLANES[] = {
+    { 0.0f,  0.0f, 0.0f, 1.0f },                // w >= epsilon (handled by the offset below)
+    { 1.0f,  0.0f, 0.0f, CLIP_GUARD_BAND },     // x >= -G * w
+    {-1.0f,  0.0f, 0.0f, CLIP_GUARD_BAND },     // x <=  G * w
+    { 0.0f,  1.0f, 0.0f, CLIP_GUARD_BAND },     // y >= -G * w
+    { 0.0f, -1.0f, 0.0f, CLIP_GUARD_BAND }      // y <=  G * w
+};
+static const float CLIP_OFFSETS[] = { -CLIP_W_EPSILON, 0.0f, 0.0f, 0.0f, 0.0f };
+
+unsigned clip_outcode(Vec4 v) {
+    unsigned code = 0;
+    if (v.x < -v.w) code |= CLIP_OUTSIDE_LEFT;
+    if (v.x >  v.w) code |= CLIP_OUTSIDE_RIGHT;
+    if (v.y < -v.w) code |= CLIP_OUTSIDE_BOTTOM;
+    if (v.y >  v.w) code |= CLIP_OUTSIDE_TOP;
+    if (v.w < CLIP_W_EPSILON) code |= CLIP_OUTSIDE_NEAR;
+    float guard = CLIP_GUARD_BAND * v.w;
+    if (v.x < -guard || v.x > guard || v.y < -guard || v.y > guard) code |= CLIP_OUTSIDE_GUARD;
+    return code;
+}
+
+static float plane_distance(int plane, Vec4 v) {
+    const Vec4* p = &CLIP_PLANES[plane];
+    return p->x * v.x + p->y * v.y + p->z * v.z + p->w * v.w + CLIP_OFFSETS[plane];
+}
+
+static Vec4 lerp4(Vec4 a, Vec4 b, float t) {
+    return (Vec4){
+        a.x + (b.x - a.x) * t,
+        a.y + (b.y - a.y) * t,
+        a.z + (b.z - a.z) * t,
+        a.w + (b.w - a.w) * t
+    };
+}
+
+// Sutherland-Hodgman against one plane
+static void clip_against_plane(const ClipPolygon* in, int plane, ClipPolygon* out) {
+    out->count = 0;
+
+    for (int i = 0; i < in->count; i++) {
+        int next = (i + 1) % in->count;
+        Vec4 a = in->vertices[i];
+        Vec4 b = in->vertices[next];
+        float da = plane_distance(plane, a);
+        float db = plane_distance(plane, b);
+
+        if (da >= 0.0f) {
+            out->vertices[out->count] = a;
+            out->original_edge[out->count] = in->original_edge[i];
+            out->count++;
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            // The new vertex continues edge a-b when entering, and runs along the plane when leaving
+            out->vertices[out->count] = lerp4(a, b, da / (da - db));
+            out->original_edge[out->count] = da < 0.0f && in->original_edge[i];
+            out->count++;
+        }
+    }
+}
+
+int clip_triangle(Vec4 c0, Vec4 c1, Vec4 c2, ClipPolygon* out) {
+    unsigned code0 = clip_outcode(c0);
+    unsigned code1 = clip_outcode(c1);
+    unsigned code2 = clip_outcode(c2);
+
+    out->vertices[0] = c0;
+    out->vertices[1] = c1;
+    out->vertices[2] = c2;
+    out->original_edge[0] = out->original_edge[1] = out->original_edge[2] = true;
+    out->count = 3;
+
+    // Every vertex outside the same plane: nothing can be visible
+    if (code0 & code1 & code2) {
+        out->count = 0;
+        return 0;
+    }
+
+    // Common case: in front of the eye and inside the guard band, so the rasterizer can take it as is
+    if (!((code0 | code1 | code2) & CLIP_NEEDS_CLIPPING)) {
+        return 3;
+    }
+
+    ClipPolygon scratch;
+    ClipPolygon* src = out;
+    ClipPolygon* dst = &scratch;
+    int plane_count = (int)(sizeof(CLIP_PLANES) / sizeof(CLIP_PLANES[0]));
+
+    for (int plane = 0; plane < plane_count && src->count > 0; plane++) {
+        clip_against_plane(src, plane, dst);
+        ClipPolygon* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != out) {
+        *out = *src;
+    }
+    if (out->count < 3) {
+        out->count = 0;
+    }
+    return out->count;
+}
+
+bool clip_line(Vec4* a, Vec4* b) {
+    unsigned code_a = clip_outcode(*a);
+    unsigned code_b = clip_outcode(*b);
+    if (code_a & code_b) {
+        return false;
+    }
+    if (!((code_a | code_b) & CLIP_NEEDS_CLIPPING)) {
+        return true;
+    }
+
+    // Both ends are cut from the original segment, so neither cut moves the other
+    Vec4 start = *a;
+    Vec4 end = *b;
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    int plane_count = (int)(sizeof(CLIP_PLANES) / sizeof(CLIP_PLANES[0]));
+    for (int plane = 0; plane < plane_count; plane++) {
+        float da = plane_distance(plane, start);
+        float db = plane_distance(plane, end);
+        if (da < 0.0f && db < 0.0f) {
+            return false;
+        }
+        if (da < 0.0f) {
+            float t = da / (da - db);
+            t0 = t > t0 ? t : t0;
+        } else if (db < 0.0f) {
+            float t = da / (da - db);
+            t1 = t < t1 ? t : t1;
+        }
+    }
+    if (t0 > t1) {
+        return false;
+    }
+
+    if (t0 > 0.0f) {
+        *a = lerp4(start, end, t0);
+    }
+    if (t1 < 1.0f) {
+        *b = lerp4(start, end, t1);
+    }
+    return true;
+}
@@ -1,6 +1,9 @@
 #include "render/depth_buffer.h"
+#include "core/trace.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 float* create_depth_buffer(int width, int height) {
     int n = width * height;
@@ -9,18 +12,114 @@ float* create_depth_buffer(int width, int height) {
         return NULL;
     }
 
-    for (int i = 0; i < n; i++) {
-        buffer[i] = INFINITY;
+    clear_depth_buffer(buffer, width, height);
+    return buffer;
+}
+
+void clear_depth_buffer(float* buffer, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Fill the first row, then copy it down in memory order
+    TraceZone zone = trace_begin("clear_depth_buffer");
+    for (int x = 0; x < width; x++) {
+        buffer[x] = INFINITY;
+    }
+    for (int y = 1; y < height; y++) {
+        memcpy(&buffer[(size_t)y * width], buffer, width * sizeof(float));
+    }
+    trace_end(zone);
+}
+
+size_t depth_format_size(DepthFormat format) {
+    switch (format) {
+        case DEPTH_FORMAT_UNORM24: return 3;
+        case DEPTH_FORMAT_UNORM16: return sizeof(uint16_t);
+        default: return sizeof(float);
+    }
+}
+
+static const char* const DEPTH_FORMAT_NAMES[] = { "float32", "reversed", "unorm24", "unorm16" };
+
+int depth_format_from_string(const char* name, DepthFormat* format) {
+    for (int i = 0; i < (int)(sizeof(DEPTH_FORMAT_NAMES) / sizeof(DEPTH_FORMAT_NAMES[0])); i++) {
+        if (strcmp(name, DEPTH_FORMAT_NAMES[i]) == 0) {
+            *format = (DepthFormat)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char* depth_format_name(DepthFormat format) {
+    return DEPTH_FORMAT_NAMES[format];
+}
+
+void depth_format_clear_value(DepthFormat format, void* out) {
+    switch (format) {
+        case DEPTH_FORMAT_FLOAT32: {
+            float value = INFINITY;
+            memcpy(out, &value, sizeof(value));
+            break;
+        }
+        case DEPTH_FORMAT_FLOAT32_REVERSED: {
+            float value = 0.0f;
+            memcpy(out, &value, sizeof(value));
+            break;
+        }
+        case DEPTH_FORMAT_UNORM24:
+            memset(out, 0xFF, 3);
+            break;
+        case DEPTH_FORMAT_UNORM16: {
+            uint16_t value = DEPTH_UNORM16_MAX;
+            memcpy(out, &value, sizeof(value));
+            break;
+        }
+    }
+}
+
+void* create_depth_buffer_with_format(int width, int height, DepthFormat format) {
+    void* buffer = malloc((size_t)width * height * depth_format_size(format));
+    if (!buffer) {
+        return NULL;
     }
 
+    clear_depth_buffer_with_format(buffer, width, height, format);
     return buffer;
 }
 
-void clear_depth_buffer(float* buffer, int width, int height) {
-    int n = width * height;
+void clear_depth_buffer_with_format(void* buffer, int width, int height, DepthFormat format) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
 
-    for (int i = 0; i < n; i++) {
-        buffer[i] = INFINITY;
+    // Fill the first row, then copy it down in memory order
+    TraceZone zone = trace_begin("clear_depth_buffer");
+    size_t size = depth_format_size(format);
+    size_t row_bytes = (size_t)width * size;
+    unsigned char* bytes = buffer;
+    for (int x = 0; x < width; x++) {
+        depth_format_clear_value(format, bytes + x * size);
+    }
+    for (int y = 1; y < height; y++) {
+        memcpy(bytes + y * row_bytes, bytes, row_bytes);
+    }
+    trace_end(zone);
+}
+
+float read_depth(const void* buffer, DepthFormat format, size_t index) {
+    switch (format) {
+        case DEPTH_FORMAT_FLOAT32_REVERSED:
+            return 1.0f + ((const float*)buffer)[index];
+        case DEPTH_FORMAT_UNORM24: {
+            const unsigned char* bytes = (const unsigned char*)buffer + index * 3;
+            return (bytes[0] | bytes[1] << 8 | (uint32_t)bytes[2] << 16) / (float)DEPTH_UNORM24_MAX;
+        }
+        case DEPTH_FORMAT_UNORM16:
+            return ((const uint16_t*)buffer)[index] / (float)DEPTH_UNORM16_MAX;
+        default:
+            return ((const float*)buffer)[index];
     }
 }
 
@@ -37,4 +136,49 @@ float get_depth(float* depth_buffer, int width, int x, int y) {
 
 void set_depth(float* depth_buffer, int width, int x, int y, float z) {
     depth_buffer[y * width + x] = z;
+}
+
+HiZBuffer* create_hiz_buffer(int width, int height) {
+    HiZBuffer* hiz = calloc(1, sizeof(HiZBuffer));
+    if (!hiz) {
+        return NULL;
+    }
+
+    hiz->blocks_x = (width + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+    hiz->blocks_y = (height + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+    hiz->tiles_x = (width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+    hiz->tiles_y = (height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+    hiz->block_max = malloc(sizeof(float) * hiz->blocks_x * hiz->blocks_y);
+    hiz->tile_max = malloc(sizeof(float) * hiz->tiles_x * hiz->tiles_y);
+    hiz->tile_dirty = malloc(hiz->tiles_x * hiz->tiles_y);
+    if (!hiz->block_max || !hiz->tile_max || !hiz->tile_dirty) {
+        destroy_hiz_buffer(hiz);
+        return NULL;
+    }
+
+    clear_hiz_buffer(hiz);
+    return hiz;
+}
+
+void clear_hiz_buffer(HiZBuffer* hiz) {
+    int blocks = hiz->blocks_x * hiz->blocks_y;
+    int tiles = hiz->tiles_x * hiz->tiles_y;
+
+    for (int i = 0; i < blocks; i++) {
+        hiz->block_max[i] = INFINITY;
+    }
+    for (int i = 0; i < tiles; i++) {
+        hiz->tile_max[i] = INFINITY;
+    }
+    memset(hiz->tile_dirty, 0, tiles);
+}
+
+void destroy_hiz_buffer(HiZBuffer* hiz) {
+    if (!hiz) {
+        return;
+    }
+    free(hiz->block_max);
+    free(hiz->tile_max);
+    free(hiz->tile_dirty);
+    free(hiz);
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "render/overdraw.h"
+#include <stdlib.h>
+#include <string.h>
+
+OverdrawBuffer* create_overdraw_buffer(int width, int height) {
+    OverdrawBuffer* overdraw = calloc(1, sizeof(OverdrawBuffer));
+    if (!overdraw) {
+        return NULL;
+    }
+
+    overdraw->width = width;
+    overdraw->height = height;
+    overdraw->tested = calloc((size_t)width * height, sizeof(uint32_t));
+    overdraw->written = calloc((size_t)width * height, sizeof(uint32_t));
+    if (!overdraw->tested || !overdraw->written) {
+        destroy_overdraw_buffer(overdraw);
+        return NULL;
+    }
+
+    return overdraw;
+}
+
+void destroy_overdraw_buffer(OverdrawBuffer* overdraw) {
+    if (!overdraw) {
+        return;
+    }
+    free(overdraw->tested);
+    free(overdraw->written);
+    free(overdraw);
+}
+
+void clear_overdraw_buffer(OverdrawBuffer* overdraw) {
+    size_t bytes = (size_t)overdraw->width * overdraw->height * sizeof(uint32_t);
+    memset(overdraw->tested, 0, bytes);
+    memset(overdraw->written, 0, bytes);
+}
+
+bool overdraw_counter_from_string(const char* name, OverdrawCounter* out_counter) {
+    if (strcmp(name, "tested") == 0) {
+        *out_counter = OVERDRAW_TESTED;
+    } else if (strcmp(name, "written") == 0) {
+        *out_counter = OVERDRAW_WRITTEN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const uint32_t* counter_values(const OverdrawBuffer* overdraw, OverdrawCounter counter) {
+    return counter == OVERDRAW_TESTED ? overdraw->tested : overdraw->written;
+}
+
+uint32_t overdraw_max(const OverdrawBuffer* overdraw, OverdrawCounter counter, const PixelBuffer* buffer, uint64_t* out_total) {
+    const uint32_t* values = counter_values(overdraw, counter);
+    uint32_t max = 0;
+    uint64_t total = 0;
+
+    for (int y = 0; y < buffer->height; y++) {
+        for (int x = 0; x < buffer->width; x++) {
+            uint32_t count = values[pixel_index(buffer, x, y)];
+            max = count > max ? count : max;
+            total += count;
+        }
+    }
+
+    if (out_total) {
+        *out_total = total;
+    }
+    return max;
+}
+
+// Blue, cyan, green, yellow, red: evenly spaced stops from one fragment up to full scale
+static Color heat_color(uint32_t count, uint32_t full_scale) {
+    static const Color STOPS[] = {
+        {0, 0, 255, 255}, {0, 255, 255, 255}, {0, 255, 0, 255}, {255, 255, 0, 255}, {255, 0, 0, 255}
+    };
+    const int last = sizeof(STOPS) / sizeof(STOPS[0]) - 1;
+
+    if (count == 0) {
+        return (Color){0, 0, 0, 255};
+    }
+    if (count > full_scale) {
+        return (Color){255, 255, 255, 255};
+    }
+
+    float t = full_scale > 1 ? (float)(count - 1) / (float)(full_scale - 1) * last : (float)last;
+    int stop = (int)t < last ? (int)t : last - 1;
+    float f = t - stop;
+    Color a = STOPS[stop];
+    Color b = STOPS[stop + 1];
+    return (Color){
+        (uint8_t)(a.r + (b.r - a.r) * f + 0.5f),
+        (uint8_t)(a.g + (b.g - a.g) * f + 0.5f),
+        (uint8_t)(a.b + (b.b - a.b) * f + 0.5f),
+        255
+    };
+}
+
+void draw_overdraw_heatmap(const OverdrawBuffer* overdraw, OverdrawCounter counter, PixelBuffer* buffer, uint32_t full_scale) {
+    const uint32_t* values = counter_values(overdraw, counter);
+    if (full_scale == 0) {
+        full_scale = overdraw_max(overdraw, counter, buffer, NULL);
+    }
+
+    for (int y = 0; y < buffer->height; y++) {
+        for (int x = 0; x < buffer->width; x++) {
+            size_t index = pixel_index(buffer, x, y);
+            buffer->pixels[index] = heat_color(values[index], full_scale);
+        }
+    }
+}
@@ -0,0 +1,1053 @@
+#include "render/raster.h"
+#include "math/vec4.h"
+#include "render/clip.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+// Largest screen coordinate (in pixels) that survives the snap without overflowing the edge math
+#define MAX_SCREEN_COORD (1 << 20)
+
+// Edge equation E(x, y) = a * x + b * y + c, stepped per pixel
+typedef struct {
+    int64_t step_x;
+    int64_t step_y;
+    int64_t row;
+} EdgeStepper;
+
+Vec3 ndc_to_screen(Vec3 ndc, int width, int height) {
+    Vec3 screen;
+    screen.x = (ndc.x + 1) * (width / 2);
+    screen.y = (1 - ndc.y) * (height / 2);
+    screen.z = ndc.z;
+    return screen;
+}
+
+static bool snap_to_subpixel(Vec3 screen, FixedVertex* out) {
+    if (!(fabsf(screen.x) <= MAX_SCREEN_COORD) || !(fabsf(screen.y) <= MAX_SCREEN_COORD)) {
+        return false;
+    }
+
+    out->x = (int32_t)lrintf(screen.x * SUBPIXEL_ONE);
+    out->y = (int32_t)lrintf(screen.y * SUBPIXEL_ONE);
+    out->z = screen.z;
+    return true;
+}
+
+static int64_t edge_function(const FixedVertex* a, const FixedVertex* b, int64_t px, int64_t py) {
+    return (int64_t)(b->x - a->x) * (py - a->y) - (int64_t)(b->y - a->y) * (px - a->x);
+}
+
+static EdgeStepper edge_setup(const FixedVertex* a, const FixedVertex* b, int64_t px, int64_t py) {
+    EdgeStepper edge;
+    edge.step_x = -(int64_t)(b->y - a->y) * SUBPIXEL_ONE;
+    edge.step_y =  (int64_t)(b->x - a->x) * SUBPIXEL_ONE;
+    edge.row = edge_function(a, b, px, py);
+    return edge;
+}
+
+// Divides by w and snaps the vertex to the subpixel grid
+static bool project_to_screen(ProjectedVertex* v, int width, int height) {
+    Vec4 clip = v->clip;
+    Vec3 ndc = {clip.x / clip.w, clip.y / clip.w, clip.z / clip.w};
+    ndc.z = (ndc.z + 1.0f) * 0.5f;
+    v->screen = ndc_to_screen(ndc, width, height);
+    return snap_to_subpixel(v->screen, &v->fixed);
+}
+
+void project_vertex(ProjectedVertex* out, Vec4 clip, int width, int height) {
+    out->clip = clip;
+    out->outcode = clip_outcode(clip);
+    if (!(out->outcode & CLIP_NEEDS_CLIPPING) && !project_to_screen(out, width, height)) {
+        out->outcode |= CLIP_OUTSIDE_GUARD;
+    }
+}
+
+static int32_t min3(int32_t a, int32_t b, int32_t c) {
+    int32_t m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+static int32_t max3(int32_t a, int32_t b, int32_t c) {
+    int32_t m = a > b ? a : b;
+    return m > c ? m : c;
+}
+
+// Depth of a vertex as the depth format stores it. Float32 keeps the -1..1 range of mat4_perspective
+// mapped to 0..1; the other formats take z / w as is, so reversed-Z keeps its precision near zero.
+static float vertex_depth(const ProjectedVertex* v, DepthFormat depth_format) {
+    if (depth_format == DEPTH_FORMAT_FLOAT32) {
+        return v->screen.z;
+    }
+
+    float depth = (float)((double)v->clip.z / v->clip.w);
+    return depth_format == DEPTH_FORMAT_FLOAT32_REVERSED ? -depth : depth;
+}
+
+// Why setup_screen_triangle rejected a triangle
+typedef enum {
+    SETUP_ACCEPTED,
+    SETUP_CULLED_FACING,
+    SETUP_ZERO_AREA,
+    SETUP_OFF_SCREEN
+} SetupResult;
+
+// Precomputes the edge equations of a triangle already on the screen.
+// original_edge[k] is set when the edge from vertex k to vertex k + 1 belongs to the source triangle.
+static SetupResult setup_screen_triangle(RasterTriangle* tri, const ProjectedVertex* v0, const ProjectedVertex* v1,
+                                  const ProjectedVertex* v2, const bool original_edge[3],
+                                  CullMode cull_mode, DepthFormat depth_format, int width, int height) {
+    FixedVertex p[3] = { v0->fixed, v1->fixed, v2->fixed };
+
+    // The sign of the snapped area gives the winding on screen. With y pointing down, triangles
+    // facing the viewer have a negative area.
+    int64_t total_area = edge_function(&p[0], &p[1], p[2].x, p[2].y);
+    if (total_area == 0) {
+        return SETUP_ZERO_AREA;
+    }
+    if ((cull_mode == CULL_BACK && total_area > 0) || (cull_mode == CULL_FRONT && total_area < 0)) {
+        return SETUP_CULLED_FACING;
+    }
+
+    // Bounding box of the pixel centers the triangle can cover; empty for slivers between centers
+    int32_t fixed_min_x = min3(p[0].x, p[1].x, p[2].x) - SUBPIXEL_HALF;
+    int32_t fixed_min_y = min3(p[0].y, p[1].y, p[2].y) - SUBPIXEL_HALF;
+    int32_t fixed_max_x = max3(p[0].x, p[1].x, p[2].x) - SUBPIXEL_HALF;
+    int32_t fixed_max_y = max3(p[0].y, p[1].y, p[2].y) - SUBPIXEL_HALF;
+    int min_x = (fixed_min_x + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    int min_y = (fixed_min_y + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    int max_x = fixed_max_x >> SUBPIXEL_BITS;
+    int max_y = fixed_max_y >> SUBPIXEL_BITS;
+    if (min_x > max_x || min_y > max_y) {
+        return SETUP_ZERO_AREA;
+    }
+
+    tri->min_x = min_x > 0 ? min_x : 0;
+    tri->min_y = min_y > 0 ? min_y : 0;
+    tri->max_x = max_x < width - 1 ? max_x : width - 1;
+    tri->max_y = max_y < height - 1 ? max_y : height - 1;
+    if (tri->min_x > tri->max_x || tri->min_y > tri->max_y) {
+        return SETUP_OFF_SCREEN;
+    }
+
+    p[0].z = vertex_depth(v0, depth_format);
+    p[1].z = vertex_depth(v1, depth_format);
+    p[2].z = vertex_depth(v2, depth_format);
+
+    // Edge values weight the opposite vertex: w0 belongs to edge 1-2, w1 to edge 2-0 and w2 to edge 0-1
+    bool edge_w0 = original_edge[1];
+    bool edge_w1 = original_edge[2];
+    bool edge_w2 = original_edge[0];
+
+    if (total_area < 0) {
+        FixedVertex temp = p[1];
+        p[1] = p[2];
+        p[2] = temp;
+        bool temp_edge = edge_w1;
+        edge_w1 = edge_w2;
+        edge_w2 = temp_edge;
+        total_area = -total_area;
+    }
+
+    const float EDGE_THRESHOLD = 0.02f;
+
+    tri->depth_format = depth_format;
+    tri->p0 = p[0];
+    tri->p1 = p[1];
+    tri->p2 = p[2];
+
+    // Top-left rule: a pixel center exactly on an edge belongs to the triangle only if the edge is a
+    // left edge (interior to its right) or a top edge (horizontal, interior below). Other edges are
+    // biased by one so their zero value fails the >= 0 coverage test, and a pixel on an edge shared
+    // by two triangles is drawn by exactly one of them.
+    const FixedVertex* from[3] = { &p[1], &p[2], &p[0] };
+    const FixedVertex* to[3]   = { &p[2], &p[0], &p[1] };
+    for (int i = 0; i < 3; i++) {
+        int32_t dx = to[i]->x - from[i]->x;
+        int32_t dy = to[i]->y - from[i]->y;
+        bool left = dy < 0;
+        bool top = dy == 0 && dx > 0;
+        tri->edge_bias[i] = (left || top) ? 0 : -1;
+    }
+
+    // A pixel is drawn as an edge when any barycentric weight is below the threshold. Edges made
+    // by clipping get a limit of zero, which no covered pixel falls below.
+    int64_t edge_limit = (int64_t)ceil(EDGE_THRESHOLD * (double)total_area);
+    tri->edge_limit[0] = (edge_w0 ? edge_limit : 0) + tri->edge_bias[0];
+    tri->edge_limit[1] = (edge_w1 ? edge_limit : 0) + tri->edge_bias[1];
+    tri->edge_limit[2] = (edge_w2 ? edge_limit : 0) + tri->edge_bias[2];
+
+    // Depth is a linear function of the edge values: z = z0 + (z1 - z0) * w1 / area + (z2 - z0) * w2 / area,
+    // with z0 moved so that the biased edge values give the same depth
+    double inv_area = 1.0 / (double)total_area;
+    tri->dz1 = (double)(p[1].z - p[0].z) * inv_area;
+    tri->dz2 = (double)(p[2].z - p[0].z) * inv_area;
+    tri->z0 = p[0].z - tri->dz1 * tri->edge_bias[1] - tri->dz2 * tri->edge_bias[2];
+    tri->min_z = fminf(fminf(p[0].z, p[1].z), p[2].z);
+
+    return SETUP_ACCEPTED;
+}
+
+// Counts a submitted triangle that setup rejected entirely, under the reason of its last piece
+static void count_rejected(RenderStats* stats, SetupResult result) {
+    switch (result) {
+        case SETUP_CULLED_FACING: RENDER_STATS_ADD(stats, triangles_culled_backface, 1); break;
+        case SETUP_ZERO_AREA:     RENDER_STATS_ADD(stats, triangles_culled_zero_area, 1); break;
+        case SETUP_OFF_SCREEN:    RENDER_STATS_ADD(stats, triangles_culled_frustum, 1); break;
+        case SETUP_ACCEPTED:      break;
+    }
+}
+
+int setup_projected_triangle(RasterTriangle out[RASTER_MAX_CLIPPED_TRIANGLES], const ProjectedVertex* v0,
+                             const ProjectedVertex* v1, const ProjectedVertex* v2,
+                             CullMode cull_mode, DepthFormat depth_format, int width, int height,
+                             RenderStats* stats) {
+    static const bool ALL_EDGES[3] = { true, true, true };
+
+    if (v0->outcode & v1->outcode & v2->outcode) {
+        RENDER_STATS_ADD(stats, triangles_culled_frustum, 1);
+        return 0;
+    }
+
+    if (!((v0->outcode | v1->outcode | v2->outcode) & CLIP_NEEDS_CLIPPING)) {
+        SetupResult result = setup_screen_triangle(&out[0], v0, v1, v2, ALL_EDGES, cull_mode, depth_format, width, height);
+        count_rejected(stats, result);
+        return result == SETUP_ACCEPTED ? 1 : 0;
+    }
+
+    RENDER_STATS_ADD(stats, triangles_clipped, 1);
+    ClipPolygon polygon;
+    if (clip_triangle(v0->clip, v1->clip, v2->clip, &polygon) == 0) {
+        RENDER_STATS_ADD(stats, triangles_culled_frustum, 1);
+        return 0;
+    }
+
+    ProjectedVertex projected[CLIP_MAX_VERTICES];
+    for (int i = 0; i < polygon.count; i++) {
+        // Clipped vertices sit on the guard band, so they are projected without classifying them again
+        projected[i].clip = polygon.vertices[i];
+        projected[i].outcode = 0;
+        if (!project_to_screen(&projected[i], width, height)) {
+            RENDER_STATS_ADD(stats, triangles_culled_frustum, 1);
+            return 0;
+        }
+    }
+
+    // Fan out the clipped polygon; only its outline can carry edges of the source triangle
+    int count = 0;
+    SetupResult result = SETUP_OFF_SCREEN;
+    for (int i = 1; i + 1 < polygon.count; i++) {
+        bool original_edge[3] = {
+            i == 1 && polygon.original_edge[0],
+            polygon.original_edge[i],
+            i + 2 == polygon.count && polygon.original_edge[i + 1]
+        };
+        result = setup_screen_triangle(&out[count], &projected[0], &projected[i], &projected[i + 1],
+                                       original_edge, cull_mode, depth_format, width, height);
+        if (result == SETUP_ACCEPTED) {
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        count_rejected(stats, result);
+    }
+    return count;
+}
+
+Color shade_triangle(Vertex v0, Vertex v1, Vertex v2) {
+    Vec3 v0_world = {v0.position.x, v0.position.y, v0.position.z};
+    Vec3 v1_world = {v1.position.x, v1.position.y, v1.position.z};
+    Vec3 v2_world = {v2.position.x, v2.position.y, v2.position.z};
+
+    Vec3 edge1 = vec3_sub(v1_world, v0_world);
+    Vec3 edge2 = vec3_sub(v2_world, v0_world);
+    Vec3 normal = vec3_normalize(vec3_cross(edge1, edge2));
+
+    Vec3 light_dir = vec3_normalize((Vec3){1.0f, 2.0f, -2.0f});
+    float intensity = fmaxf(0.2f, vec3_dot(normal, light_dir));
+
+    uint8_t base_r = (v0.color.r + v1.color.r + v2.color.r) / 3;
+    uint8_t base_g = (v0.color.g + v1.color.g + v2.color.g) / 3;
+    uint8_t base_b = (v0.color.b + v1.color.b + v2.color.b) / 3;
+
+    return (Color){
+        .r = (uint8_t)fminf(255.0f, base_r * intensity),
+        .g = (uint8_t)fminf(255.0f, base_g * intensity),
+        .b = (uint8_t)fminf(255.0f, base_b * intensity),
+        .a = 255
+    };
+}
+
+int setup_triangle(RasterTriangle out[RASTER_MAX_CLIPPED_TRIANGLES], Vertex v0, Vertex v1, Vertex v2,
+                   Mat4 mvp, CullMode cull_mode, int width, int height) {
+    ProjectedVertex p0, p1, p2;
+    project_vertex(&p0, mat4_mul_vec4(mvp, vertex_to_vec4(v0)), width, height);
+    project_vertex(&p1, mat4_mul_vec4(mvp, vertex_to_vec4(v1)), width, height);
+    project_vertex(&p2, mat4_mul_vec4(mvp, vertex_to_vec4(v2)), width, height);
+
+    int count = setup_projected_triangle(out, &p0, &p1, &p2, cull_mode, DEPTH_FORMAT_FLOAT32, width, height, NULL);
+    if (count > 0) {
+        Color fill_color = shade_triangle(v0, v1, v2);
+        for (int i = 0; i < count; i++) {
+            out[i].fill_color = fill_color;
+        }
+    }
+    return count;
+}
+
+
+_Static_assert(HIZ_BLOCK_SIZE == RASTER_BLOCK_SIZE, "hierarchical depth blocks must match raster blocks");
+_Static_assert(HIZ_TILE_SIZE % RASTER_BLOCK_SIZE == 0, "hierarchical depth tiles must hold whole raster blocks");
+_Static_assert(PIXEL_TILE_SIZE == RASTER_BLOCK_SIZE, "tiled pixel buffers must store raster blocks contiguously");
+
+// Everything the block kernels need that stays constant across one rasterize_triangle call
+typedef struct {
+    const RasterTriangle* tri;
+    Color* pixels;
+    void* depth_buffer;     // Stored in the triangle's depth format
+    int load_width;         // Blocks reaching past this column cannot use full-width loads and stores
+    size_t block_pitch;     // Distance in memory between horizontally adjacent blocks
+    size_t block_row_pitch; // Distance in memory between vertically adjacent blocks
+    int row_step;           // Distance in memory between vertically adjacent pixels of a block
+    EdgeStepper e0, e1, e2;
+    int64_t lane_step0[RASTER_BLOCK_SIZE];
+    int64_t lane_step1[RASTER_BLOCK_SIZE];
+    int64_t lane_step2[RASTER_BLOCK_SIZE];
+    float lane_depth[RASTER_BLOCK_SIZE];
+    RenderStats* stats;     // Counts the pixels tested; may be NULL
+    OverdrawBuffer* overdraw;   // Per-pixel fill counters, only updated by the scalar kernels; may be NULL
+} BlockContext;
+
+// Rasterizes the rows [row_begin, row_end] and the columns set in lane_mask of one block.
+// w0..w2 are the edge values at the center of the block's top-left pixel.
+typedef int (*BlockKernel)(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                           int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end);
+
+static const Color EDGE_COLOR = {255, 255, 255, 255};
+
+// Index of a block's top-left pixel in the color and depth buffers
+static size_t block_offset(const BlockContext* ctx, int block_x, int block_y) {
+    return (size_t)(block_y / RASTER_BLOCK_SIZE) * ctx->block_row_pitch + (size_t)(block_x / RASTER_BLOCK_SIZE) * ctx->block_pitch;
+}
+
+// Depth at the left pixel of a block row, evaluated exactly from the edge values
+static float block_row_depth(const RasterTriangle* tri, int64_t w1, int64_t w2) {
+    return (float)(tri->z0 + tri->dz1 * w1 + tri->dz2 * w2);
+}
+
+static int raster_block_scalar(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                               int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end) {
+    const RasterTriangle* tri = ctx->tri;
+    int64_t limit0 = tri->edge_limit[0];
+    int64_t limit1 = tri->edge_limit[1];
+    int64_t limit2 = tri->edge_limit[2];
+    int pixels_written = 0;
+
+    for (int j = row_begin; j <= row_end; j++) {
+        int64_t r0 = w0 + j * ctx->e0.step_y;
+        int64_t r1 = w1 + j * ctx->e1.step_y;
+        int64_t r2 = w2 + j * ctx->e2.step_y;
+        float row_depth = block_row_depth(tri, r1, r2);
+        size_t row = block_offset(ctx, block_x, block_y) + j * ctx->row_step;
+        Color* colors = ctx->pixels + row;
+        float* depths = (float*)ctx->depth_buffer + row;
+        uint32_t* tested = ctx->overdraw ? ctx->overdraw->tested + row : NULL;
+        uint32_t* written = ctx->overdraw ? ctx->overdraw->written + row : NULL;
+
+        for (int i = 0; i < RASTER_BLOCK_SIZE; i++, r0 += ctx->e0.step_x, r1 += ctx->e1.step_x, r2 += ctx->e2.step_x) {
+            if (!(lane_mask & (1u << i)) || (r0 | r1 | r2) < 0) {
+                continue;
+            }
+
+            RENDER_STATS_ADD(ctx->stats, pixels_tested, 1);
+            if (tested) {
+                tested[i]++;
+            }
+            float depth = row_depth + ctx->lane_depth[i];
+            if (depth < depths[i]) {
+                depths[i] = depth;
+                colors[i] = (r0 < limit0 || r1 < limit1 || r2 < limit2) ? EDGE_COLOR : tri->fill_color;
+                pixels_written++;
+                if (written) {
+                    written[i]++;
+                }
+            }
+        }
+    }
+
+    return pixels_written;
+}
+
+// Farthest depth among the first cols columns of rows rows starting at depths, row_step apart
+typedef float (*BlockMaxFn)(const float* depths, int row_step, int cols, int rows);
+
+static float block_max_scalar(const float* depths, int row_step, int cols, int rows) {
+    float farthest = -INFINITY;
+    for (int j = 0; j < rows; j++, depths += row_step) {
+        for (int i = 0; i < cols; i++) {
+            farthest = depths[i] > farthest ? depths[i] : farthest;
+        }
+    }
+    return farthest;
+}
+
+// Largest stored value of a fixed-point depth format, as a float
+static float unorm_depth_max(DepthFormat depth_format) {
+    return depth_format == DEPTH_FORMAT_UNORM16 ? (float)DEPTH_UNORM16_MAX : (float)DEPTH_UNORM24_MAX;
+}
+
+// Fixed-point value of a depth: rounded to nearest and clamped to [0, max]
+static uint32_t quantize_depth(float depth, float max) {
+    float scaled = depth * max + 0.5f;
+    scaled = scaled > 0.0f ? scaled : 0.0f;
+    scaled = scaled < max ? scaled : max;
+    return (uint32_t)scaled;
+}
+
+// A 24-bit depth is stored as 3 bytes, least significant first
+static uint32_t load_unorm24(const unsigned char* bytes) {
+    return bytes[0] | bytes[1] << 8 | (uint32_t)bytes[2] << 16;
+}
+
+static void store_unorm24(unsigned char* bytes, uint32_t depth) {
+    bytes[0] = (unsigned char)depth;
+    bytes[1] = (unsigned char)(depth >> 8);
+    bytes[2] = (unsigned char)(depth >> 16);
+}
+
+// The scalar kernel for the fixed-point depth formats: depth is quantized before the test
+static int raster_block_unorm_scalar(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                                     int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end) {
+    const RasterTriangle* tri = ctx->tri;
+    int64_t limit0 = tri->edge_limit[0];
+    int64_t limit1 = tri->edge_limit[1];
+    int64_t limit2 = tri->edge_limit[2];
+    bool unorm16 = tri->depth_format == DEPTH_FORMAT_UNORM16;
+    float max = unorm_depth_max(tri->depth_format);
+    int pixels_written = 0;
+
+    for (int j = row_begin; j <= row_end; j++) {
+        int64_t r0 = w0 + j * ctx->e0.step_y;
+        int64_t r1 = w1 + j * ctx->e1.step_y;
+        int64_t r2 = w2 + j * ctx->e2.step_y;
+        float row_depth = block_row_depth(tri, r1, r2);
+        size_t row = block_offset(ctx, block_x, block_y) + j * ctx->row_step;
+        Color* colors = ctx->pixels + row;
+        uint16_t* depths16 = (uint16_t*)ctx->depth_buffer + row;
+        unsigned char* depths24 = (unsigned char*)ctx->depth_buffer + row * 3;
+        uint32_t* tested = ctx->overdraw ? ctx->overdraw->tested + row : NULL;
+        uint32_t* written = ctx->overdraw ? ctx->overdraw->written + row : NULL;
+
+        for (int i = 0; i < RASTER_BLOCK_SIZE; i++, r0 += ctx->e0.step_x, r1 += ctx->e1.step_x, r2 += ctx->e2.step_x) {
+            if (!(lane_mask & (1u << i)) || (r0 | r1 | r2) < 0) {
+                continue;
+            }
+
+            RENDER_STATS_ADD(ctx->stats, pixels_tested, 1);
+            if (tested) {
+                tested[i]++;
+            }
+            uint32_t depth = quantize_depth(row_depth + ctx->lane_depth[i], max);
+            if (depth < (unorm16 ? depths16[i] : load_unorm24(depths24 + i * 3))) {
+                if (unorm16) {
+                    depths16[i] = (uint16_t)depth;
+                } else {
+                    store_unorm24(depths24 + i * 3, depth);
+                }
+                colors[i] = (r0 < limit0 || r1 < limit1 || r2 < limit2) ? EDGE_COLOR : tri->fill_color;
+                pixels_written++;
+                if (written) {
+                    written[i]++;
+                }
+            }
+        }
+    }
+
+    return pixels_written;
+}
+
+// Depth below which a triangle's pixels quantize to at least the farthest fixed-point value of
+// the first cols columns of rows rows; the hierarchical depth buffer compares against it as a float
+static float block_max_unorm(const BlockContext* ctx, size_t offset, int cols, int rows) {
+    uint32_t farthest = 0;
+    for (int j = 0; j < rows; j++, offset += ctx->row_step) {
+        for (int i = 0; i < cols; i++) {
+            uint32_t stored = ctx->tri->depth_format == DEPTH_FORMAT_UNORM16
+                ? ((const uint16_t*)ctx->depth_buffer)[offset + i]
+                : load_unorm24((const unsigned char*)ctx->depth_buffer + (offset + i) * 3);
+            farthest = stored > farthest ? stored : farthest;
+        }
+    }
+    return (float)((farthest - 0.5) / unorm_depth_max(ctx->tri->depth_format));
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+
+// The four bytes of a color as one 32-bit value, for broadcasting into SIMD lanes
+static uint32_t color_bits(Color color) {
+    uint32_t bits;
+    memcpy(&bits, &color, sizeof(bits));
+    return bits;
+}
+
+__attribute__((target("sse2")))
+static unsigned sse2_outside_bits(__m128i a, __m128i b, __m128i c) {
+    return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(_mm_or_si128(a, b), c)));
+}
+
+__attribute__((target("sse2")))
+static int raster_block_sse2(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                             int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end) {
+    // Blocks hanging over the right edge of the buffer cannot use full-width loads and stores
+    if (block_x + RASTER_BLOCK_SIZE > ctx->load_width) {
+        return raster_block_scalar(ctx, w0, w1, w2, block_x, block_y, lane_mask, row_begin, row_end);
+    }
+
+    const RasterTriangle* tri = ctx->tri;
+    const __m128i limit0 = _mm_set1_epi64x(tri->edge_limit[0]);
+    const __m128i limit1 = _mm_set1_epi64x(tri->edge_limit[1]);
+    const __m128i limit2 = _mm_set1_epi64x(tri->edge_limit[2]);
+    const __m128i fill = _mm_set1_epi32((int)color_bits(tri->fill_color));
+    const __m128i edge = _mm_set1_epi32((int)color_bits(EDGE_COLOR));
+    int pixels_written = 0;
+
+    for (int j = row_begin; j <= row_end; j++) {
+        int64_t r0 = w0 + j * ctx->e0.step_y;
+        int64_t r1 = w1 + j * ctx->e1.step_y;
+        int64_t r2 = w2 + j * ctx->e2.step_y;
+        float row_depth = block_row_depth(tri, r1, r2);
+        size_t row = block_offset(ctx, block_x, block_y) + j * ctx->row_step;
+        Color* colors = ctx->pixels + row;
+        float* depths = (float*)ctx->depth_buffer + row;
+
+        // Each half of the row is four pixels; each int64 vector holds two of them
+        for (int half = 0; half < 2; half++) {
+            unsigned outside = 0;
+            unsigned near_edge = 0;
+            for (int pair = 0; pair < 2; pair++) {
+                int lane = half * 4 + pair * 2;
+                __m128i a = _mm_add_epi64(_mm_set1_epi64x(r0), _mm_loadu_si128((const __m128i*)&ctx->lane_step0[lane]));
+                __m128i b = _mm_add_epi64(_mm_set1_epi64x(r1), _mm_loadu_si128((const __m128i*)&ctx->lane_step1[lane]));
+                __m128i c = _mm_add_epi64(_mm_set1_epi64x(r2), _mm_loadu_si128((const __m128i*)&ctx->lane_step2[lane]));
+                outside |= sse2_outside_bits(a, b, c) << (pair * 2);
+                near_edge |= sse2_outside_bits(_mm_sub_epi64(a, limit0), _mm_sub_epi64(b, limit1), _mm_sub_epi64(c, limit2)) << (pair * 2);
+            }
+
+            unsigned covered = ~outside & (lane_mask >> (half * 4)) & 0xF;
+            if (!covered) {
+                continue;
+            }
+            RENDER_STATS_ADD(ctx->stats, pixels_tested, __builtin_popcount(covered));
+
+            __m128 depth = _mm_add_ps(_mm_set1_ps(row_depth), _mm_loadu_ps(&ctx->lane_depth[half * 4]));
+            __m128 stored = _mm_loadu_ps(depths + half * 4);
+            unsigned write = covered & (unsigned)_mm_movemask_ps(_mm_cmplt_ps(depth, stored));
+            if (!write) {
+                continue;
+            }
+
+            const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+            __m128i write_mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)write), bits), bits);
+            __m128i edge_mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)near_edge), bits), bits);
+
+            __m128 new_depth = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(write_mask), depth),
+                                         _mm_andnot_ps(_mm_castsi128_ps(write_mask), stored));
+            _mm_storeu_ps(depths + half * 4, new_depth);
+
+            __m128i color = _mm_or_si128(_mm_and_si128(edge_mask, edge), _mm_andnot_si128(edge_mask, fill));
+            __m128i old_color = _mm_loadu_si128((const __m128i*)(colors + half * 4));
+            __m128i new_color = _mm_or_si128(_mm_and_si128(write_mask, color), _mm_andnot_si128(write_mask, old_color));
+            _mm_storeu_si128((__m128i*)(colors + half * 4), new_color);
+
+            pixels_written += __builtin_popcount(write);
+        }
+    }
+
+    return pixels_written;
+}
+
+__attribute__((target("sse2")))
+static float block_max_sse2(const float* depths, int row_step, int cols, int rows) {
+    if (cols < RASTER_BLOCK_SIZE || rows < RASTER_BLOCK_SIZE) {
+        return block_max_scalar(depths, row_step, cols, rows);
+    }
+
+    __m128 farthest = _mm_max_ps(_mm_loadu_ps(depths), _mm_loadu_ps(depths + 4));
+    for (int j = 1; j < RASTER_BLOCK_SIZE; j++) {
+        depths += row_step;
+        farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(depths), _mm_loadu_ps(depths + 4)));
+    }
+    farthest = _mm_max_ps(farthest, _mm_movehl_ps(farthest, farthest));
+    farthest = _mm_max_ss(farthest, _mm_shuffle_ps(farthest, farthest, 1));
+    return _mm_cvtss_f32(farthest);
+}
+
+__attribute__((target("avx2")))
+static unsigned avx2_outside_bits(__m256i a, __m256i b, __m256i c) {
+    return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_or_si256(a, b), c)));
+}
+
+__attribute__((target("avx2")))
+static int raster_block_avx2(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                             int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end) {
+    const RasterTriangle* tri = ctx->tri;
+    const __m256i limit0 = _mm256_set1_epi64x(tri->edge_limit[0]);
+    const __m256i limit1 = _mm256_set1_epi64x(tri->edge_limit[1]);
+    const __m256i limit2 = _mm256_set1_epi64x(tri->edge_limit[2]);
+    const __m256i fill = _mm256_set1_epi32((int)color_bits(tri->fill_color));
+    const __m256i edge = _mm256_set1_epi32((int)color_bits(EDGE_COLOR));
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 lane_depth = _mm256_loadu_ps(ctx->lane_depth);
+    const __m256i step0_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step0[0]);
+    const __m256i step0_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step0[4]);
+    const __m256i step1_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step1[0]);
+    const __m256i step1_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step1[4]);
+    const __m256i step2_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step2[0]);
+    const __m256i step2_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step2[4]);
+
+    // Lanes outside the buffer are never loaded or stored
+    __m256i lane_vector = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)lane_mask), bits), bits);
+    int pixels_written = 0;
+
+    for (int j = row_begin; j <= row_end; j++) {
+        int64_t r0 = w0 + j * ctx->e0.step_y;
+        int64_t r1 = w1 + j * ctx->e1.step_y;
+        int64_t r2 = w2 + j * ctx->e2.step_y;
+
+        __m256i a_lo = _mm256_add_epi64(_mm256_set1_epi64x(r0), step0_lo);
+        __m256i a_hi = _mm256_add_epi64(_mm256_set1_epi64x(r0), step0_hi);
+        __m256i b_lo = _mm256_add_epi64(_mm256_set1_epi64x(r1), step1_lo);
+        __m256i b_hi = _mm256_add_epi64(_mm256_set1_epi64x(r1), step1_hi);
+        __m256i c_lo = _mm256_add_epi64(_mm256_set1_epi64x(r2), step2_lo);
+        __m256i c_hi = _mm256_add_epi64(_mm256_set1_epi64x(r2), step2_hi);
+
+        unsigned outside = avx2_outside_bits(a_lo, b_lo, c_lo) | (avx2_outside_bits(a_hi, b_hi, c_hi) << 4);
+        unsigned covered = ~outside & lane_mask & 0xFF;
+        if (!covered) {
+            continue;
+        }
+        RENDER_STATS_ADD(ctx->stats, pixels_tested, __builtin_popcount(covered));
+
+        size_t row = block_offset(ctx, block_x, block_y) + j * ctx->row_step;
+        Color* colors = ctx->pixels + row;
+        float* depths = (float*)ctx->depth_buffer + row;
+
+        __m256 depth = _mm256_add_ps(_mm256_set1_ps(block_row_depth(tri, r1, r2)), lane_depth);
+        __m256 stored = _mm256_maskload_ps(depths, lane_vector);
+        unsigned write = covered & (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(depth, stored, _CMP_LT_OQ));
+        if (!write) {
+            continue;
+        }
+
+        unsigned near_edge =
+            avx2_outside_bits(_mm256_sub_epi64(a_lo, limit0), _mm256_sub_epi64(b_lo, limit1), _mm256_sub_epi64(c_lo, limit2)) |
+            (avx2_outside_bits(_mm256_sub_epi64(a_hi, limit0), _mm256_sub_epi64(b_hi, limit1), _mm256_sub_epi64(c_hi, limit2)) << 4);
+
+        __m256i write_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)write), bits), bits);
+        __m256i edge_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)near_edge), bits), bits);
+
+        _mm256_maskstore_ps(depths, write_mask, depth);
+        _mm256_maskstore_epi32((int*)colors, write_mask, _mm256_blendv_epi8(fill, edge, edge_mask));
+
+        pixels_written += __builtin_popcount(write);
+    }
+
+    return pixels_written;
+}
+// The 24 bytes of eight packed 24-bit depths, widened to one 32-bit lane each
+__attribute__((target("avx2")))
+static __m256i load_unorm24_avx2(const unsigned char* bytes) {
+    const __m256i widen = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                           0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i lo = _mm_loadu_si128((const __m128i*)bytes);
+    __m128i hi = _mm_alignr_epi8(_mm_loadl_epi64((const __m128i*)(bytes + 16)), lo, 12);
+    return _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), widen);
+}
+
+// Narrows eight 32-bit lanes back to 24 bytes of packed depths
+__attribute__((target("avx2")))
+static void store_unorm24_avx2(unsigned char* bytes, __m256i depths) {
+    const __m256i narrow = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i packed = _mm256_shuffle_epi8(depths, narrow);
+    __m128i lo = _mm256_castsi256_si128(packed);
+    __m128i hi = _mm256_extracti128_si256(packed, 1);
+    _mm_storeu_si128((__m128i*)bytes, _mm_or_si128(lo, _mm_slli_si128(hi, 12)));
+    _mm_storel_epi64((__m128i*)(bytes + 16), _mm_srli_si128(hi, 4));
+}
+
+// The AVX2 kernel for the fixed-point depth formats. Eight depths are quantized at once and
+// compared as 32-bit integers; stored depths are widened on load and narrowed on store.
+__attribute__((target("avx2")))
+static int raster_block_unorm_avx2(const BlockContext* ctx, int64_t w0, int64_t w1, int64_t w2,
+                                   int block_x, int block_y, unsigned lane_mask, int row_begin, int row_end) {
+    const RasterTriangle* tri = ctx->tri;
+    bool unorm16 = tri->depth_format == DEPTH_FORMAT_UNORM16;
+
+    // Rows are loaded and stored whole, which must not reach past the end of the buffer
+    if (block_x + RASTER_BLOCK_SIZE > ctx->load_width) {
+        return raster_block_unorm_scalar(ctx, w0, w1, w2, block_x, block_y, lane_mask, row_begin, row_end);
+    }
+
+    const __m256i limit0 = _mm256_set1_epi64x(tri->edge_limit[0]);
+    const __m256i limit1 = _mm256_set1_epi64x(tri->edge_limit[1]);
+    const __m256i limit2 = _mm256_set1_epi64x(tri->edge_limit[2]);
+    const __m256i fill = _mm256_set1_epi32((int)color_bits(tri->fill_color));
+    const __m256i edge = _mm256_set1_epi32((int)color_bits(EDGE_COLOR));
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 lane_depth = _mm256_loadu_ps(ctx->lane_depth);
+    const __m256 max = _mm256_set1_ps(unorm_depth_max(tri->depth_format));
+    const __m256i step0_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step0[0]);
+    const __m256i step0_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step0[4]);
+    const __m256i step1_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step1[0]);
+    const __m256i step1_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step1[4]);
+    const __m256i step2_lo = _mm256_loadu_si256((const __m256i*)&ctx->lane_step2[0]);
+    const __m256i step2_hi = _mm256_loadu_si256((const __m256i*)&ctx->lane_step2[4]);
+
+    int pixels_written = 0;
+
+    for (int j = row_begin; j <= row_end; j++) {
+        int64_t r0 = w0 + j * ctx->e0.step_y;
+        int64_t r1 = w1 + j * ctx->e1.step_y;
+        int64_t r2 = w2 + j * ctx->e2.step_y;
+
+        __m256i a_lo = _mm256_add_epi64(_mm256_set1_epi64x(r0), step0_lo);
+        __m256i a_hi = _mm256_add_epi64(_mm256_set1_epi64x(r0), step0_hi);
+        __m256i b_lo = _mm256_add_epi64(_mm256_set1_epi64x(r1), step1_lo);
+        __m256i b_hi = _mm256_add_epi64(_mm256_set1_epi64x(r1), step1_hi);
+        __m256i c_lo = _mm256_add_epi64(_mm256_set1_epi64x(r2), step2_lo);
+        __m256i c_hi = _mm256_add_epi64(_mm256_set1_epi64x(r2), step2_hi);
+
+        unsigned outside = avx2_outside_bits(a_lo, b_lo, c_lo) | (avx2_outside_bits(a_hi, b_hi, c_hi) << 4);
+        unsigned covered = ~outside & lane_mask & 0xFF;
+        if (!covered) {
+            continue;
+        }
+        RENDER_STATS_ADD(ctx->stats, pixels_tested, __builtin_popcount(covered));
+
+        size_t row = block_offset(ctx, block_x, block_y) + j * ctx->row_step;
+        Color* colors = ctx->pixels + row;
+        uint16_t* depths16 = (uint16_t*)ctx->depth_buffer + row;
+        unsigned char* depths24 = (unsigned char*)ctx->depth_buffer + row * 3;
+
+        // Same rounding and clamping as quantize_depth
+        __m256 depth = _mm256_add_ps(_mm256_set1_ps(block_row_depth(tri, r1, r2)), lane_depth);
+        __m256 scaled = _mm256_add_ps(_mm256_mul_ps(depth, max), _mm256_set1_ps(0.5f));
+        scaled = _mm256_min_ps(_mm256_max_ps(scaled, _mm256_setzero_ps()), max);
+        __m256i quantized = _mm256_cvttps_epi32(scaled);
+
+        __m256i stored = unorm16 ? _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)depths16))
+                                 : load_unorm24_avx2(depths24);
+        unsigned write = covered & (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(stored, quantized)));
+        if (!write) {
+            continue;
+        }
+
+        unsigned near_edge =
+            avx2_outside_bits(_mm256_sub_epi64(a_lo, limit0), _mm256_sub_epi64(b_lo, limit1), _mm256_sub_epi64(c_lo, limit2)) |
+            (avx2_outside_bits(_mm256_sub_epi64(a_hi, limit0), _mm256_sub_epi64(b_hi, limit1), _mm256_sub_epi64(c_hi, limit2)) << 4);
+
+        __m256i write_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)write), bits), bits);
+        __m256i edge_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)near_edge), bits), bits);
+
+        __m256i merged = _mm256_blendv_epi8(stored, quantized, write_mask);
+        if (unorm16) {
+            __m128i narrowed = _mm_packus_epi32(_mm256_castsi256_si128(merged), _mm256_extracti128_si256(merged, 1));
+            _mm_storeu_si128((__m128i*)depths16, narrowed);
+        } else {
+            store_unorm24_avx2(depths24, merged);
+        }
+        _mm256_maskstore_epi32((int*)colors, write_mask, _mm256_blendv_epi8(fill, edge, edge_mask));
+
+        pixels_written += __builtin_popcount(write);
+    }
+
+    return pixels_written;
+}
+
+__attribute__((target("avx2")))
+static float block_max_avx2(const float* depths, int row_step, int cols, int rows) {
+    if (cols < RASTER_BLOCK_SIZE || rows < RASTER_BLOCK_SIZE) {
+        return block_max_scalar(depths, row_step, cols, rows);
+    }
+
+    __m256 farthest = _mm256_loadu_ps(depths);
+    for (int j = 1; j < RASTER_BLOCK_SIZE; j++) {
+        farthest = _mm256_max_ps(farthest, _mm256_loadu_ps(depths + j * row_step));
+    }
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(farthest), _mm256_extractf128_ps(farthest, 1));
+    half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+#endif
+
+static RasterPath active_path = RASTER_PATH_SCALAR;
+static BlockKernel active_kernel = raster_block_scalar;
+static BlockKernel active_unorm_kernel = raster_block_unorm_scalar;
+static BlockMaxFn active_block_max = block_max_scalar;
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static bool raster_path_supported(RasterPath path) {
+    switch (path) {
+        case RASTER_PATH_SCALAR:
+            return true;
+#ifdef RASTER_HAVE_X86_KERNELS
+        case RASTER_PATH_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case RASTER_PATH_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static void raster_use_path(RasterPath path) {
+    active_path = path;
+    switch (path) {
+#ifdef RASTER_HAVE_X86_KERNELS
+        case RASTER_PATH_SSE2:
+            // SSE2 lacks the unsigned packs and widening loads the fixed-point kernel needs
+            active_kernel = raster_block_sse2;
+            active_unorm_kernel = raster_block_unorm_scalar;
+            active_block_max = block_max_sse2;
+            break;
+        case RASTER_PATH_AVX2:
+            active_kernel = raster_block_avx2;
+            active_unorm_kernel = raster_block_unorm_avx2;
+            active_block_max = block_max_avx2;
+            break;
+#endif
+        default:
+            active_kernel = raster_block_scalar;
+            active_unorm_kernel = raster_block_unorm_scalar;
+            active_block_max = block_max_scalar;
+            break;
+    }
+}
+
+static void raster_select_best_path(void) {
+    if (raster_path_supported(RASTER_PATH_AVX2)) {
+        raster_use_path(RASTER_PATH_AVX2);
+    } else if (raster_path_supported(RASTER_PATH_SSE2)) {
+        raster_use_path(RASTER_PATH_SSE2);
+    } else {
+        raster_use_path(RASTER_PATH_SCALAR);
+    }
+}
+
+bool raster_set_path(RasterPath path) {
+    pthread_once(&dispatch_once, raster_select_best_path);
+    if (!raster_path_supported(path)) {
+        return false;
+    }
+
+    raster_use_path(path);
+    return true;
+}
+
+RasterPath raster_get_path(void) {
+    pthread_once(&dispatch_once, raster_select_best_path);
+    return active_path;
+}
+
+const char* raster_path_name(RasterPath path) {
+    switch (path) {
+        case RASTER_PATH_SCALAR: return "scalar";
+        case RASTER_PATH_SSE2:   return "sse2";
+        case RASTER_PATH_AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+bool raster_path_from_string(const char* name, RasterPath* out_path) {
+    for (int path = RASTER_PATH_SCALAR; path <= RASTER_PATH_AVX2; path++) {
+        if (strcmp(name, raster_path_name((RasterPath)path)) == 0) {
+            *out_path = (RasterPath)path;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Relative slack on depth bounds, covering the float rounding of the per-pixel depths
+#define HIZ_DEPTH_MARGIN 1e-6
+
+// Smallest depth the triangle can produce at a pixel of the w by h rectangle whose top-left
+// pixel center has edge values w1 and w2
+static double depth_lower_bound(const RasterTriangle* tri, int64_t w1, int64_t w2, int w, int h,
+                                double depth_step_x, double depth_step_y) {
+    double corner = tri->z0 + tri->dz1 * w1 + tri->dz2 * w2;
+    double bound = corner + fmin(0.0, (w - 1) * depth_step_x) + fmin(0.0, (h - 1) * depth_step_y);
+    bound = fmax(bound, tri->min_z);
+    return bound - HIZ_DEPTH_MARGIN * (fabs(bound) + fabs(depth_step_x) * w + fabs(depth_step_y) * h);
+}
+
+// Recomputes the farthest depth of one block after pixels in it were written
+static void hiz_refresh_block(HiZBuffer* hiz, const BlockContext* ctx, int width, int height, int block_x, int block_y) {
+    int cols = width - block_x < RASTER_BLOCK_SIZE ? width - block_x : RASTER_BLOCK_SIZE;
+    int rows = height - block_y < RASTER_BLOCK_SIZE ? height - block_y : RASTER_BLOCK_SIZE;
+    size_t offset = block_offset(ctx, block_x, block_y);
+    bool unorm = ctx->tri->depth_format == DEPTH_FORMAT_UNORM16 || ctx->tri->depth_format == DEPTH_FORMAT_UNORM24;
+    float farthest = unorm ? block_max_unorm(ctx, offset, cols, rows)
+                           : active_block_max((const float*)ctx->depth_buffer + offset, ctx->row_step, cols, rows);
+
+    float* block_max = &hiz->block_max[(block_y / HIZ_BLOCK_SIZE) * hiz->blocks_x + block_x / HIZ_BLOCK_SIZE];
+    if (farthest < *block_max) {
+        *block_max = farthest;
+        hiz->tile_dirty[(block_y / HIZ_TILE_SIZE) * hiz->tiles_x + block_x / HIZ_TILE_SIZE] = 1;
+    }
+}
+
+// Returns the farthest depth of a tile, folding in blocks that shrank since it was last read
+static float hiz_tile_max(HiZBuffer* hiz, int tile_x, int tile_y) {
+    int tile = tile_y * hiz->tiles_x + tile_x;
+    if (hiz->tile_dirty[tile]) {
+        const int blocks_per_tile = HIZ_TILE_SIZE / HIZ_BLOCK_SIZE;
+        int bx0 = tile_x * blocks_per_tile;
+        int by0 = tile_y * blocks_per_tile;
+        int bx1 = bx0 + blocks_per_tile < hiz->blocks_x ? bx0 + blocks_per_tile : hiz->blocks_x;
+        int by1 = by0 + blocks_per_tile < hiz->blocks_y ? by0 + blocks_per_tile : hiz->blocks_y;
+        float farthest = -INFINITY;
+
+        for (int by = by0; by < by1; by++) {
+            for (int bx = bx0; bx < bx1; bx++) {
+                float block = hiz->block_max[by * hiz->blocks_x + bx];
+                farthest = block > farthest ? block : farthest;
+            }
+        }
+
+        hiz->tile_max[tile] = farthest;
+        hiz->tile_dirty[tile] = 0;
+    }
+
+    return hiz->tile_max[tile];
+}
+
+int rasterize_triangle(const RasterTriangle* tri, int x0, int y0, int x1, int y1,
+                       PixelBuffer* buffer, void* depth_buffer, HiZBuffer* hiz, RenderStats* stats,
+                       OverdrawBuffer* overdraw) {
+    int min_x = x0 > tri->min_x ? x0 : tri->min_x;
+    int min_y = y0 > tri->min_y ? y0 : tri->min_y;
+    int max_x = x1 < tri->max_x ? x1 : tri->max_x;
+    int max_y = y1 < tri->max_y ? y1 : tri->max_y;
+    if (min_x > max_x || min_y > max_y) {
+        return 0;
+    }
+
+    pthread_once(&dispatch_once, raster_select_best_path);
+    bool unorm = tri->depth_format == DEPTH_FORMAT_UNORM16 || tri->depth_format == DEPTH_FORMAT_UNORM24;
+    BlockKernel kernel = unorm ? active_unorm_kernel : active_kernel;
+    if (overdraw) {
+        // Only the scalar kernels count fragments; they write exactly what the SIMD ones would
+        kernel = unorm ? raster_block_unorm_scalar : raster_block_scalar;
+    }
+
+    // Blocks are aligned to the screen, so the same pixel always sees the same arithmetic
+    // no matter how the screen is split into rectangles
+    int first_block_x = min_x & ~(RASTER_BLOCK_SIZE - 1);
+    int first_block_y = min_y & ~(RASTER_BLOCK_SIZE - 1);
+
+    BlockContext ctx;
+    ctx.tri = tri;
+    ctx.pixels = buffer->pixels;
+    ctx.depth_buffer = depth_buffer;
+    ctx.load_width = buffer->storage_width;
+    ctx.block_pitch = pixel_index(buffer, RASTER_BLOCK_SIZE, 0);
+    ctx.block_row_pitch = pixel_index(buffer, 0, RASTER_BLOCK_SIZE);
+    ctx.row_step = pixel_row_step(buffer);
+    ctx.stats = stats;
+    ctx.overdraw = overdraw;
+
+    int64_t origin_x = (int64_t)first_block_x * SUBPIXEL_ONE + SUBPIXEL_HALF;
+    int64_t origin_y = (int64_t)first_block_y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+    ctx.e0 = edge_setup(&tri->p1, &tri->p2, origin_x, origin_y);
+    ctx.e1 = edge_setup(&tri->p2, &tri->p0, origin_x, origin_y);
+    ctx.e2 = edge_setup(&tri->p0, &tri->p1, origin_x, origin_y);
+    ctx.e0.row += tri->edge_bias[0];
+    ctx.e1.row += tri->edge_bias[1];
+    ctx.e2.row += tri->edge_bias[2];
+
+    float depth_step_x = (float)(tri->dz1 * ctx.e1.step_x + tri->dz2 * ctx.e2.step_x);
+    for (int i = 0; i < RASTER_BLOCK_SIZE; i++) {
+        ctx.lane_step0[i] = i * ctx.e0.step_x;
+        ctx.lane_step1[i] = i * ctx.e1.step_x;
+        ctx.lane_step2[i] = i * ctx.e2.step_x;
+        ctx.lane_depth[i] = (float)i * depth_step_x;
+    }
+
+    // Amount to add to an edge value at a block's top-left pixel to get its largest value inside the block
+    const int last = RASTER_BLOCK_SIZE - 1;
+    int64_t reach0 = (ctx.e0.step_x > 0 ? last * ctx.e0.step_x : 0) + (ctx.e0.step_y > 0 ? last * ctx.e0.step_y : 0);
+    int64_t reach1 = (ctx.e1.step_x > 0 ? last * ctx.e1.step_x : 0) + (ctx.e1.step_y > 0 ? last * ctx.e1.step_y : 0);
+    int64_t reach2 = (ctx.e2.step_x > 0 ? last * ctx.e2.step_x : 0) + (ctx.e2.step_y > 0 ? last * ctx.e2.step_y : 0);
+
+    // Depth change per pixel, used to bound the triangle's nearest depth over a region
+    double plane_step_x = tri->dz1 * ctx.e1.step_x + tri->dz2 * ctx.e2.step_x;
+    double plane_step_y = tri->dz1 * ctx.e1.step_y + tri->dz2 * ctx.e2.step_y;
+
+    int pixels_written = 0;
+
+    // Walk the rectangle one hierarchical depth tile at a time so whole tiles can be skipped
+    for (int tile_y = first_block_y / HIZ_TILE_SIZE * HIZ_TILE_SIZE; tile_y <= max_y; tile_y += HIZ_TILE_SIZE) {
+        for (int tile_x = first_block_x / HIZ_TILE_SIZE * HIZ_TILE_SIZE; tile_x <= max_x; tile_x += HIZ_TILE_SIZE) {
+            int span_x0 = tile_x > first_block_x ? tile_x : first_block_x;
+            int span_y0 = tile_y > first_block_y ? tile_y : first_block_y;
+            int span_x1 = tile_x + HIZ_TILE_SIZE - 1 < max_x ? tile_x + HIZ_TILE_SIZE - 1 : max_x;
+            int span_y1 = tile_y + HIZ_TILE_SIZE - 1 < max_y ? tile_y + HIZ_TILE_SIZE - 1 : max_y;
+
+            if (hiz) {
+                int64_t dx = span_x0 - first_block_x;
+                int64_t dy = span_y0 - first_block_y;
+                double nearest = depth_lower_bound(tri, ctx.e1.row + dx * ctx.e1.step_x + dy * ctx.e1.step_y,
+                                                   ctx.e2.row + dx * ctx.e2.step_x + dy * ctx.e2.step_y,
+                                                   span_x1 - span_x0 + 1, span_y1 - span_y0 + 1, plane_step_x, plane_step_y);
+                if (nearest >= hiz_tile_max(hiz, tile_x / HIZ_TILE_SIZE, tile_y / HIZ_TILE_SIZE)) {
+                    continue;
+                }
+            }
+
+            for (int block_y = span_y0; block_y <= span_y1; block_y += RASTER_BLOCK_SIZE) {
+                int row_begin = min_y > block_y ? min_y - block_y : 0;
+                int row_end = max_y < block_y + last ? max_y - block_y : last;
+
+                for (int block_x = span_x0; block_x <= span_x1; block_x += RASTER_BLOCK_SIZE) {
+                    int64_t dx = block_x - first_block_x;
+                    int64_t dy = block_y - first_block_y;
+                    int64_t w0 = ctx.e0.row + dx * ctx.e0.step_x + dy * ctx.e0.step_y;
+                    int64_t w1 = ctx.e1.row + dx * ctx.e1.step_x + dy * ctx.e1.step_y;
+                    int64_t w2 = ctx.e2.row + dx * ctx.e2.step_x + dy * ctx.e2.step_y;
+
+                    // Skip blocks that lie entirely outside one of the edges
+                    if (w0 + reach0 < 0 || w1 + reach1 < 0 || w2 + reach2 < 0) {
+                        continue;
+                    }
+
+                    // Skip blocks where every stored depth is already nearer than the triangle
+                    if (hiz && depth_lower_bound(tri, w1, w2, RASTER_BLOCK_SIZE, RASTER_BLOCK_SIZE, plane_step_x, plane_step_y) >=
+                               hiz->block_max[(block_y / HIZ_BLOCK_SIZE) * hiz->blocks_x + block_x / HIZ_BLOCK_SIZE]) {
+                        continue;
+                    }
+
+                    int col_begin = min_x > block_x ? min_x - block_x : 0;
+                    int col_end = max_x < block_x + last ? max_x - block_x : last;
+                    unsigned lane_mask = ((1u << (col_end + 1)) - 1) & ~((1u << col_begin) - 1);
+
+                    int written = kernel(&ctx, w0, w1, w2, block_x, block_y, lane_mask, row_begin, row_end);
+                    if (hiz && written > 0) {
+                        hiz_refresh_block(hiz, &ctx, buffer->width, buffer->height, block_x, block_y);
+                    }
+                    pixels_written += written;
+                }
+            }
+        }
+    }
+
+    RENDER_STATS_ADD(stats, pixels_depth_passed, pixels_written);
+    RENDER_STATS_ADD(stats, pixels_written, pixels_written);
+    return pixels_written;
+}
@@ -0,0 +1,51 @@
+#include "render/render_stats.h"
+#include <string.h>
+
+void render_stats_reset(RenderStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void render_stats_merge(RenderStats* into, const RenderStats* from) {
+    into->triangles_submitted += from->triangles_submitted;
+    into->triangles_culled_frustum += from->triangles_culled_frustum;
+    into->triangles_culled_backface += from->triangles_culled_backface;
+    into->triangles_culled_zero_area += from->triangles_culled_zero_area;
+    into->triangles_clipped += from->triangles_clipped;
+    into->triangles_rasterized += from->triangles_rasterized;
+    into->pixels_tested += from->pixels_tested;
+    into->pixels_depth_passed += from->pixels_depth_passed;
+    into->pixels_written += from->pixels_written;
+    into->frames += from->frames;
+    for (int i = 0; i < RENDER_STAGE_COUNT; i++) {
+        into->stage_seconds[i] += from->stage_seconds[i];
+    }
+}
+
+const char* render_stage_name(RenderStage stage) {
+    switch (stage) {
+        case RENDER_STAGE_CLEAR:     return "clear";
+        case RENDER_STAGE_TRANSFORM: return "transform";
+        case RENDER_STAGE_RASTER:    return "raster";
+        case RENDER_STAGE_WIREFRAME: return "wireframe";
+        case RENDER_STAGE_UPLOAD:    return "upload";
+        case RENDER_STAGE_COUNT:     break;
+    }
+    return "unknown";
+}
+
+void render_stats_print(const RenderStats* stats, FILE* out) {
+    double frames = stats->frames > 0 ? (double)stats->frames : 1.0;
+
+    fprintf(out, "triangles: %.0f submitted, %.0f frustum culled, %.0f backface culled, %.0f zero area, "
+                 "%.0f clipped, %.0f rasterized | pixels: %.0f tested, %.0f depth passed, %.0f written\n",
+            stats->triangles_submitted / frames, stats->triangles_culled_frustum / frames,
+            stats->triangles_culled_backface / frames, stats->triangles_culled_zero_area / frames,
+            stats->triangles_clipped / frames, stats->triangles_rasterized / frames,
+            stats->pixels_tested / frames, stats->pixels_depth_passed / frames, stats->pixels_written / frames);
+
+    fprintf(out, "ms per frame:");
+    for (int i = 0; i < RENDER_STAGE_COUNT; i++) {
+        fprintf(out, " %s %.3f", render_stage_name((RenderStage)i), stats->stage_seconds[i] * 1000.0 / frames);
+    }
+    fprintf(out, "\n");
+}
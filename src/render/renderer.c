@@ -0,0 +1,147 @@
+#include "render/renderer.h"
+#include "core/trace.h"
+#include <stdlib.h>
+
+VertexStream* create_vertex_stream(void) {
+    return calloc(1, sizeof(VertexStream));
+}
+
+void destroy_vertex_stream(VertexStream* stream) {
+    if (!stream) {
+        return;
+    }
+    free(stream->vertices);
+    free(stream->clip.x);
+    free(stream);
+}
+
+static bool vertex_stream_reserve(VertexStream* stream, size_t count) {
+    if (count <= stream->capacity) {
+        return true;
+    }
+
+    size_t capacity = stream->capacity ? stream->capacity : 256;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    ProjectedVertex* vertices = realloc(stream->vertices, capacity * sizeof(*vertices));
+    if (!vertices) {
+        return false;
+    }
+    stream->vertices = vertices;
+
+    // The clip arrays hold nothing between calls, so they are replaced rather than reallocated
+    float* clip = malloc(4 * capacity * sizeof(float));
+    if (!clip) {
+        return false;
+    }
+    free(stream->clip.x);
+    stream->clip = (ClipArrays){clip, clip + capacity, clip + 2 * capacity, clip + 3 * capacity};
+    stream->capacity = capacity;
+    return true;
+}
+
+// True if every index names a vertex of the mesh
+static bool mesh_indices_in_range(const Mesh* mesh) {
+    for (size_t i = 0; i < mesh->indexCount; i++) {
+        if ((size_t)(unsigned)mesh->indices[i] >= mesh->vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t draw_mesh(const Mesh* mesh, const Mat4* mvp, RenderTarget* target) {
+    RenderStats* stats = target->stats;
+    double start = RENDER_STATS_CLOCK();
+    double raster_seconds = 0.0;
+    RENDER_STATS_ADD(stats, triangles_submitted, mesh->indexCount / 3);
+
+    VertexStream local = {0};
+    VertexStream* stream = target->stream ? target->stream : &local;
+    if (!vertex_stream_reserve(stream, mesh->vertexCount)) {
+        return 0;
+    }
+    TraceZone zone = trace_begin("draw_mesh");
+
+    // Transform and project every vertex exactly once
+    ProjectedVertex* projected = stream->vertices;
+    if (mesh->arrays) {
+        // Positions are transformed in batches from the separate arrays, then projected one by one
+        ClipArrays* clip = &stream->clip;
+        transform_vertex_arrays(mvp, mesh->arrays, mesh->vertexCount, clip);
+        for (size_t i = 0; i < mesh->vertexCount; i++) {
+            project_vertex(&projected[i], (Vec4){clip->x[i], clip->y[i], clip->z[i], clip->w[i]}, target->width, target->height);
+        }
+    } else {
+        for (size_t i = 0; i < mesh->vertexCount; i++) {
+            project_vertex(&projected[i], mat4_mul_vec4(*mvp, vertex_to_vec4(mesh->vertices[i])), target->width, target->height);
+        }
+    }
+
+    // One pass over the indices keeps the triangle loop free of range checks for valid meshes
+    bool indices_in_range = mesh_indices_in_range(mesh);
+
+    size_t pixels = 0;
+    for (size_t t = 0; t + 2 < mesh->indexCount; t += 3) {
+        int i0 = mesh->indices[t + 0];
+        int i1 = mesh->indices[t + 1];
+        int i2 = mesh->indices[t + 2];
+        if (!indices_in_range && ((size_t)(unsigned)i0 >= mesh->vertexCount || (size_t)(unsigned)i1 >= mesh->vertexCount ||
+                                  (size_t)(unsigned)i2 >= mesh->vertexCount)) {
+            continue;
+        }
+
+        // Cheapest rejection first: all three vertices outside the same side of the frustum
+        if (projected[i0].outcode & projected[i1].outcode & projected[i2].outcode) {
+            RENDER_STATS_ADD(stats, triangles_culled_frustum, 1);
+            continue;
+        }
+
+        RasterTriangle local_tris[RASTER_MAX_CLIPPED_TRIANGLES];
+        RasterTriangle* tris = target->tiles ? tile_renderer_begin_triangle(target->tiles) : local_tris;
+        if (!tris) {
+            continue;
+        }
+
+        int count = setup_projected_triangle(tris, &projected[i0], &projected[i1], &projected[i2],
+                                             target->cull_mode, target->depth_format, target->width, target->height, stats);
+        if (count == 0) {
+            continue;
+        }
+        RENDER_STATS_ADD(stats, triangles_rasterized, count);
+
+        // Only triangles that survived culling and clipping are shaded
+        Color fill_color = shade_triangle(mesh->vertices[i0], mesh->vertices[i1], mesh->vertices[i2]);
+        for (int c = 0; c < count; c++) {
+            tris[c].fill_color = fill_color;
+        }
+
+        if (target->tiles) {
+            tile_renderer_end_triangle(target->tiles, count);
+            continue;
+        }
+
+        double raster_start = RENDER_STATS_CLOCK();
+        for (int c = 0; c < count; c++) {
+            if (target->clear) {
+                clear_tiles_resolve(target->clear, target->buffer, target->depth_buffer,
+                                    tris[c].min_x, tris[c].min_y, tris[c].max_x, tris[c].max_y);
+            }
+            pixels += rasterize_triangle(&tris[c], 0, 0, target->width - 1, target->height - 1,
+                                         target->buffer, target->depth_buffer, target->hiz, stats, target->overdraw);
+        }
+        raster_seconds += RENDER_STATS_CLOCK() - raster_start;
+    }
+
+    // Rasterizing is interleaved with setup when drawing serially, so it is timed per triangle
+    // and taken out of the transform time
+    RENDER_STATS_ADD(stats, stage_seconds[RENDER_STAGE_RASTER], raster_seconds);
+    RENDER_STATS_TIME(stats, RENDER_STAGE_TRANSFORM, start + raster_seconds);
+
+    free(local.vertices);
+    free(local.clip.x);
+    trace_end(zone);
+    return pixels;
+}
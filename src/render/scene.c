@@ -0,0 +1,275 @@
+#include "render/scene.h"
+#include "render/triangle.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define GRID_SIZE 12
+#define GRID_SPACING 1.25f
+#define GRID_DEPTH 14.0f
+
+#define LAYER_COUNT 7
+#define LAYER_SIZE 6
+#define LAYER_SPACING 1.25f
+#define LAYER_DEPTH 10.0f
+#define LAYER_GAP 2.0f
+
+#define MESH_SCENE_SIZE 2.0f
+#define MESH_SCENE_DISTANCE 3.5f
+
+static Mesh* scene_add_mesh(Scene* scene, Mesh* mesh) {
+    if (!mesh || scene->meshCount >= SCENE_MAX_MESHES) {
+        destroy_mesh(mesh);
+        return NULL;
+    }
+
+    scene->meshes[scene->meshCount++] = mesh;
+    return mesh;
+}
+
+static void scene_add_object(Scene* scene, Mesh* mesh, Mat4 placement, float spin_speed) {
+    if (scene->objectCount >= SCENE_MAX_OBJECTS) {
+        return;
+    }
+
+    SceneObject* object = &scene->objects[scene->objectCount++];
+    object->mesh = mesh;
+    object->placement = placement;
+    object->spin_speed = spin_speed;
+    object->model_matrix = placement;
+}
+
+static int build_default_scene(Scene* scene) {
+    Mesh* cube    = scene_add_mesh(scene, create_cube_mesh());
+    Mesh* pyramid = scene_add_mesh(scene, create_pyramid_mesh());
+    if (!cube || !pyramid) {
+        return 0;
+    }
+
+    scene_add_object(scene, cube,    mat4_translation(-1.5f,  0.0f, 0.0f), 1.0f);
+    scene_add_object(scene, pyramid, mat4_translation( 1.5f, -0.5f, 0.0f), 1.0f);
+    scene->center = (Vec3){0.0f, 0.0f, 0.0f};
+    scene->view_distance = 5.0f;
+    return 1;
+}
+
+// Walls of oversized cubes stacked in depth. The walls are added front to back: the wall nearest
+// the camera first and the farthest last, so each wall drawn is mostly hidden by those before it.
+static int build_layers_scene(Scene* scene) {
+    Mesh* cube = scene_add_mesh(scene, create_cube_mesh());
+    if (!cube) {
+        return 0;
+    }
+
+    float offset = (LAYER_SIZE - 1) * LAYER_SPACING * 0.5f;
+    for (int layer = 0; layer < LAYER_COUNT; layer++) {
+        for (int row = 0; row < LAYER_SIZE; row++) {
+            for (int col = 0; col < LAYER_SIZE; col++) {
+                float x = col * LAYER_SPACING - offset;
+                float y = row * LAYER_SPACING - offset;
+                float z = LAYER_DEPTH + layer * LAYER_GAP;
+                float spin = 0.3f + 0.1f * ((layer + row * LAYER_SIZE + col) % 7);
+                Mat4 placement = mat4_multiply(mat4_translation(x, y, z), mat4_scale(1.6f, 1.6f, 1.6f));
+                scene_add_object(scene, cube, placement, spin);
+            }
+        }
+    }
+    scene->center = (Vec3){0.0f, 0.0f, LAYER_DEPTH};
+    scene->view_distance = 8.0f;
+    return 1;
+}
+
+static int build_grid_scene(Scene* scene) {
+    Mesh* cube    = scene_add_mesh(scene, create_cube_mesh());
+    Mesh* pyramid = scene_add_mesh(scene, create_pyramid_mesh());
+    if (!cube || !pyramid) {
+        return 0;
+    }
+
+    float offset = (GRID_SIZE - 1) * GRID_SPACING * 0.5f;
+    for (int row = 0; row < GRID_SIZE; row++) {
+        for (int col = 0; col < GRID_SIZE; col++) {
+            Mesh* mesh = ((row + col) % 2 == 0) ? cube : pyramid;
+            float x = col * GRID_SPACING - offset;
+            float y = row * GRID_SPACING - offset;
+            float z = GRID_DEPTH + (float)((row * 7 + col * 3) % 5);
+            float spin = 0.5f + 0.1f * ((row * GRID_SIZE + col) % 10);
+            scene_add_object(scene, mesh, mat4_translation(x, y, z), spin);
+        }
+    }
+    scene->center = (Vec3){0.0f, 0.0f, GRID_DEPTH + 2.0f};
+    scene->view_distance = GRID_DEPTH + 7.0f;
+    return 1;
+}
+
+Scene* create_scene(SceneType type) {
+    Scene* scene = calloc(1, sizeof(Scene));
+    if (!scene) {
+        return NULL;
+    }
+
+    int ok = 0;
+    switch (type) {
+        case SCENE_DEFAULT: ok = build_default_scene(scene); break;
+        case SCENE_GRID:    ok = build_grid_scene(scene);    break;
+        case SCENE_LAYERS:  ok = build_layers_scene(scene);  break;
+    }
+
+    if (!ok) {
+        destroy_scene(scene);
+        return NULL;
+    }
+
+    return scene;
+}
+
+Scene* create_mesh_scene(Mesh* mesh) {
+    MeshInstance instance = {mesh, mat4_identity()};
+    return create_mesh_instances_scene(&mesh, 1, &instance, 1);
+}
+
+Scene* create_mesh_instances_scene(Mesh** meshes, size_t mesh_count, const MeshInstance* instances,
+                                   size_t instance_count) {
+    Scene* scene = calloc(1, sizeof(Scene));
+    bool ok = scene && mesh_count <= SCENE_MAX_MESHES && instance_count <= SCENE_MAX_OBJECTS;
+    for (size_t i = 0; i < mesh_count; i++) {
+        if (!ok || !scene_add_mesh(scene, meshes[i])) {
+            destroy_mesh(meshes[i]);
+            ok = false;
+        }
+    }
+
+    // Bound every vertex of every instance where the instance puts it
+    Vec3 lo = {INFINITY, INFINITY, INFINITY};
+    Vec3 hi = {-INFINITY, -INFINITY, -INFINITY};
+    for (size_t i = 0; ok && i < instance_count; i++) {
+        const Mesh* mesh = instances[i].mesh;
+        for (size_t v = 0; v < mesh->vertexCount; v++) {
+            Vec4 p = mat4_mul_vec4(instances[i].transform, mesh->vertices[v].position);
+            lo = (Vec3){fminf(lo.x, p.x), fminf(lo.y, p.y), fminf(lo.z, p.z)};
+            hi = (Vec3){fmaxf(hi.x, p.x), fmaxf(hi.y, p.y), fmaxf(hi.z, p.z)};
+        }
+    }
+    if (!ok || !(lo.x <= hi.x)) {
+        destroy_scene(scene);
+        return NULL;
+    }
+
+    // Center the group on the origin and scale its largest side to a fixed size
+    float extent = fmaxf(hi.x - lo.x, fmaxf(hi.y - lo.y, hi.z - lo.z));
+    float scale = extent > 0.0f ? MESH_SCENE_SIZE / extent : 1.0f;
+    Mat4 placement = mat4_multiply(mat4_scale(scale, scale, scale),
+                                   mat4_translation(-0.5f * (lo.x + hi.x), -0.5f * (lo.y + hi.y), -0.5f * (lo.z + hi.z)));
+    for (size_t i = 0; i < instance_count; i++) {
+        scene_add_object(scene, instances[i].mesh, mat4_multiply(placement, instances[i].transform), 0.0f);
+    }
+    scene->center = (Vec3){0.0f, 0.0f, 0.0f};
+    scene->view_distance = MESH_SCENE_DISTANCE;
+    return scene;
+}
+
+void destroy_scene(Scene* scene) {
+    if (!scene) {
+        return;
+    }
+
+    for (size_t i = 0; i < scene->meshCount; i++) {
+        destroy_mesh(scene->meshes[i]);
+    }
+    free(scene);
+}
+
+int scene_type_from_string(const char* name, SceneType* out_type) {
+    if (strcmp(name, "default") == 0) {
+        *out_type = SCENE_DEFAULT;
+        return 1;
+    }
+    if (strcmp(name, "grid") == 0) {
+        *out_type = SCENE_GRID;
+        return 1;
+    }
+    if (strcmp(name, "layers") == 0) {
+        *out_type = SCENE_LAYERS;
+        return 1;
+    }
+    return 0;
+}
+
+const char* scene_type_name(SceneType type) {
+    switch (type) {
+        case SCENE_DEFAULT: return "default";
+        case SCENE_GRID:    return "grid";
+        case SCENE_LAYERS:  return "layers";
+    }
+    return "unknown";
+}
+
+void scene_camera_path(const Scene* scene, Camera* camera, float t) {
+    float angle = 2.0f * (float)M_PI * t;
+    float sway = 0.3f * scene->view_distance;
+    float dolly = 0.4f * scene->view_distance;
+
+    camera->position = (Vec3){
+        scene->center.x + sway * sinf(angle),
+        scene->center.y + 0.5f * sway * sinf(2.0f * angle),
+        scene->center.z - scene->view_distance + dolly * 0.5f * (1.0f - cosf(angle))
+    };
+    camera->target = vec3_add(camera->position, (Vec3){0.0f, 0.0f, 1.0f});
+    camera->yaw = 0.0f;
+    camera->pitch = 0.0f;
+    camera->view_matrix = camera_get_view_matrix(camera);
+}
+
+void scene_update(Scene* scene, float time) {
+    for (size_t i = 0; i < scene->objectCount; i++) {
+        SceneObject* object = &scene->objects[i];
+        object->model_matrix = mat4_multiply(object->placement, mat4_rotation_y(time * object->spin_speed));
+    }
+}
+
+void draw_scene(const Scene* scene, const Camera* camera, RenderTarget* target, SceneStats* stats) {
+    size_t triangles = 0;
+    size_t pixels = 0;
+
+    // Fill pass: draw triangles
+    for (size_t i = 0; i < scene->objectCount; i++) {
+        const SceneObject* object = &scene->objects[i];
+        Mat4 mvp = mat4_multiply(camera->projection_matrix, mat4_multiply(camera->view_matrix, object->model_matrix));
+        pixels += draw_mesh(object->mesh, &mvp, target);
+        triangles += object->mesh->indexCount / 3;
+    }
+
+    if (target->tiles) {
+        pixels += tile_renderer_flush(target->tiles, target->buffer, target->depth_buffer, target->hiz, target->clear,
+                                      target->stats, target->overdraw);
+    }
+
+    // The wireframe is drawn without a depth test, so only the color of untouched tiles has to be filled
+    if (target->clear) {
+        double clear_start = RENDER_STATS_CLOCK();
+        clear_tiles_resolve_color(target->clear, target->buffer);
+        RENDER_STATS_TIME(target->stats, RENDER_STAGE_CLEAR, clear_start);
+    }
+
+    // Wireframe pass: draw only boundary edges
+    double wireframe_start = RENDER_STATS_CLOCK();
+    size_t wireframe_pixels = 0;
+    for (size_t i = 0; i < scene->objectCount; i++) {
+        const SceneObject* object = &scene->objects[i];
+        Mat4 mvp = mat4_multiply(camera->projection_matrix, mat4_multiply(camera->view_matrix, object->model_matrix));
+        wireframe_pixels += draw_wireframe(object->mesh, mvp, target->buffer, target->depth_buffer, target->width, target->height);
+    }
+    RENDER_STATS_TIME(target->stats, RENDER_STAGE_WIREFRAME, wireframe_start);
+    RENDER_STATS_ADD(target->stats, pixels_written, wireframe_pixels);
+    RENDER_STATS_ADD(target->stats, frames, 1);
+
+    if (stats) {
+        stats->triangles = triangles;
+        stats->pixels = pixels;
+    }
+}
@@ -0,0 +1,311 @@
+#include "render/tile_renderer.h"
+#include "core/trace.h"
+#include "render/raster.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A render tile must cover whole hierarchical depth tiles so that no two threads update the same one
+_Static_assert(RENDER_TILE_SIZE % HIZ_TILE_SIZE == 0, "render tiles must hold whole hierarchical depth tiles");
+_Static_assert(RENDER_TILE_SIZE % CLEAR_TILE_SIZE == 0, "render tiles must hold whole clear tiles");
+
+// Indices of the triangles overlapping one tile, in submission order
+typedef struct {
+    uint32_t* items;
+    size_t count;
+    size_t capacity;
+} TileBin;
+
+struct TileRenderer {
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    int tile_count;
+    TileBin* bins;
+
+    RasterTriangle* triangles;
+    size_t triangle_count;
+    size_t triangle_capacity;
+    size_t dropped;         // Triangles left out of some or all of their tiles for lack of memory this frame
+
+    // Worker pool: the caller of tile_renderer_flush works alongside thread_count - 1 workers
+    int thread_count;
+    int worker_count;
+    pthread_t* workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned generation;
+    int workers_busy;
+    bool shutting_down;
+
+    // State of the flush in progress
+    PixelBuffer* buffer;
+    void* depth_buffer;
+    HiZBuffer* hiz;
+    ClearTiles* clear;
+    RenderStats* stats;
+    OverdrawBuffer* overdraw;
+    atomic_int next_tile;
+    atomic_size_t pixels_written;
+};
+
+static bool bin_push(TileBin* bin, uint32_t triangle) {
+    if (bin->count == bin->capacity) {
+        size_t capacity = bin->capacity ? bin->capacity * 2 : 64;
+        uint32_t* items = realloc(bin->items, capacity * sizeof(*items));
+        if (!items) {
+            return false;
+        }
+        bin->items = items;
+        bin->capacity = capacity;
+    }
+
+    bin->items[bin->count++] = triangle;
+    return true;
+}
+
+static void rasterize_tiles(TileRenderer* renderer) {
+    TraceZone zone = trace_begin("rasterize_tiles");
+    size_t pixels = 0;
+
+    // Each thread counts into its own stats and adds them to the caller's once it runs out of tiles
+#if RENDER_STATS_ENABLED
+    RenderStats local_stats = {0};
+    RenderStats* stats = renderer->stats ? &local_stats : NULL;
+#else
+    RenderStats* stats = NULL;
+#endif
+
+    while (true) {
+        int tile = atomic_fetch_add(&renderer->next_tile, 1);
+        if (tile >= renderer->tile_count) {
+            break;
+        }
+
+        const TileBin* bin = &renderer->bins[tile];
+        int x0 = (tile % renderer->tiles_x) * RENDER_TILE_SIZE;
+        int y0 = (tile / renderer->tiles_x) * RENDER_TILE_SIZE;
+        int x1 = x0 + RENDER_TILE_SIZE - 1;
+        int y1 = y0 + RENDER_TILE_SIZE - 1;
+
+        for (size_t i = 0; i < bin->count; i++) {
+            const RasterTriangle* tri = &renderer->triangles[bin->items[i]];
+            if (renderer->clear) {
+                clear_tiles_resolve(renderer->clear, renderer->buffer, renderer->depth_buffer,
+                                    tri->min_x > x0 ? tri->min_x : x0, tri->min_y > y0 ? tri->min_y : y0,
+                                    tri->max_x < x1 ? tri->max_x : x1, tri->max_y < y1 ? tri->max_y : y1);
+            }
+            pixels += rasterize_triangle(tri, x0, y0, x1, y1, renderer->buffer,
+                                         renderer->depth_buffer, renderer->hiz, stats, renderer->overdraw);
+        }
+    }
+
+    atomic_fetch_add(&renderer->pixels_written, pixels);
+
+#if RENDER_STATS_ENABLED
+    if (stats) {
+        pthread_mutex_lock(&renderer->lock);
+        render_stats_merge(renderer->stats, stats);
+        pthread_mutex_unlock(&renderer->lock);
+    }
+#endif
+    trace_end(zone);
+}
+
+static void* worker_main(void* arg) {
+    TileRenderer* renderer = arg;
+    unsigned seen_generation = 0;
+    trace_set_thread_name("tile worker");
+
+    while (true) {
+        pthread_mutex_lock(&renderer->lock);
+        while (!renderer->shutting_down && renderer->generation == seen_generation) {
+            pthread_cond_wait(&renderer->work_ready, &renderer->lock);
+        }
+        if (renderer->shutting_down) {
+            pthread_mutex_unlock(&renderer->lock);
+            return NULL;
+        }
+        seen_generation = renderer->generation;
+        pthread_mutex_unlock(&renderer->lock);
+
+        rasterize_tiles(renderer);
+
+        pthread_mutex_lock(&renderer->lock);
+        if (--renderer->workers_busy == 0) {
+            pthread_cond_signal(&renderer->work_done);
+        }
+        pthread_mutex_unlock(&renderer->lock);
+    }
+}
+
+TileRenderer* create_tile_renderer(int width, int height, int thread_count) {
+    TileRenderer* renderer = calloc(1, sizeof(TileRenderer));
+    if (!renderer) {
+        return NULL;
+    }
+
+    renderer->width = width;
+    renderer->height = height;
+    renderer->tiles_x = (width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    renderer->tiles_y = (height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    renderer->tile_count = renderer->tiles_x * renderer->tiles_y;
+    renderer->bins = calloc(renderer->tile_count, sizeof(TileBin));
+    renderer->thread_count = thread_count > 0 ? thread_count : 1;
+    renderer->workers = calloc(renderer->thread_count, sizeof(pthread_t));
+    if (!renderer->bins || !renderer->workers) {
+        free(renderer->bins);
+        free(renderer->workers);
+        free(renderer);
+        return NULL;
+    }
+
+    pthread_mutex_init(&renderer->lock, NULL);
+    pthread_cond_init(&renderer->work_ready, NULL);
+    pthread_cond_init(&renderer->work_done, NULL);
+
+    for (int i = 0; i < renderer->thread_count - 1; i++) {
+        if (pthread_create(&renderer->workers[i], NULL, worker_main, renderer) != 0) {
+            break;
+        }
+        renderer->worker_count++;
+    }
+
+    return renderer;
+}
+
+void destroy_tile_renderer(TileRenderer* renderer) {
+    if (!renderer) {
+        return;
+    }
+
+    pthread_mutex_lock(&renderer->lock);
+    renderer->shutting_down = true;
+    pthread_cond_broadcast(&renderer->work_ready);
+    pthread_mutex_unlock(&renderer->lock);
+
+    for (int i = 0; i < renderer->worker_count; i++) {
+        pthread_join(renderer->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&renderer->work_done);
+    pthread_cond_destroy(&renderer->work_ready);
+    pthread_mutex_destroy(&renderer->lock);
+
+    for (int i = 0; i < renderer->tile_count; i++) {
+        free(renderer->bins[i].items);
+    }
+    free(renderer->bins);
+    free(renderer->triangles);
+    free(renderer->workers);
+    free(renderer);
+}
+
+// Makes room for the pieces one submitted triangle can be clipped into
+static bool reserve_triangles(TileRenderer* renderer) {
+    if (renderer->triangle_count + RASTER_MAX_CLIPPED_TRIANGLES <= renderer->triangle_capacity) {
+        return true;
+    }
+
+    size_t capacity = renderer->triangle_capacity ? renderer->triangle_capacity * 2 : 1024;
+    RasterTriangle* triangles = realloc(renderer->triangles, capacity * sizeof(*triangles));
+    if (!triangles) {
+        return false;
+    }
+    renderer->triangles = triangles;
+    renderer->triangle_capacity = capacity;
+    return true;
+}
+
+// Bins the count triangles that were just set up at the end of the triangle array
+static void bin_triangles(TileRenderer* renderer, int count) {
+    for (int i = 0; i < count; i++) {
+        const RasterTriangle* tri = &renderer->triangles[renderer->triangle_count];
+        uint32_t index = (uint32_t)renderer->triangle_count++;
+        int tx0 = tri->min_x / RENDER_TILE_SIZE;
+        int tx1 = tri->max_x / RENDER_TILE_SIZE;
+        int ty0 = tri->min_y / RENDER_TILE_SIZE;
+        int ty1 = tri->max_y / RENDER_TILE_SIZE;
+
+        bool binned = true;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                binned &= bin_push(&renderer->bins[ty * renderer->tiles_x + tx], index);
+            }
+        }
+        renderer->dropped += !binned;
+    }
+}
+
+RasterTriangle* tile_renderer_begin_triangle(TileRenderer* renderer) {
+    if (!reserve_triangles(renderer)) {
+        renderer->dropped++;
+        return NULL;
+    }
+    return &renderer->triangles[renderer->triangle_count];
+}
+
+void tile_renderer_end_triangle(TileRenderer* renderer, int count) {
+    bin_triangles(renderer, count);
+}
+
+void tile_renderer_submit_triangle(TileRenderer* renderer, Vertex v0, Vertex v1, Vertex v2, Mat4 mvp, CullMode cull_mode) {
+    RasterTriangle* tris = tile_renderer_begin_triangle(renderer);
+    if (!tris) {
+        return;
+    }
+
+    tile_renderer_end_triangle(renderer, setup_triangle(tris, v0, v1, v2, mvp, cull_mode, renderer->width, renderer->height));
+}
+
+size_t tile_renderer_flush(TileRenderer* renderer, PixelBuffer* buffer, void* depth_buffer, HiZBuffer* hiz,
+                           ClearTiles* clear, RenderStats* stats, OverdrawBuffer* overdraw) {
+    double start = RENDER_STATS_CLOCK();
+    TraceZone zone = trace_begin("tile_renderer_flush");
+    renderer->buffer = buffer;
+    renderer->depth_buffer = depth_buffer;
+    renderer->hiz = hiz;
+    renderer->clear = clear;
+    renderer->stats = stats;
+    renderer->overdraw = overdraw;
+    atomic_store(&renderer->next_tile, 0);
+    atomic_store(&renderer->pixels_written, 0);
+
+    if (renderer->worker_count > 0) {
+        pthread_mutex_lock(&renderer->lock);
+        renderer->generation++;
+        renderer->workers_busy = renderer->worker_count;
+        pthread_cond_broadcast(&renderer->work_ready);
+        pthread_mutex_unlock(&renderer->lock);
+    }
+
+    rasterize_tiles(renderer);
+
+    if (renderer->worker_count > 0) {
+        pthread_mutex_lock(&renderer->lock);
+        while (renderer->workers_busy > 0) {
+            pthread_cond_wait(&renderer->work_done, &renderer->lock);
+        }
+        pthread_mutex_unlock(&renderer->lock);
+    }
+
+    for (int i = 0; i < renderer->tile_count; i++) {
+        renderer->bins[i].count = 0;
+    }
+    renderer->triangle_count = 0;
+
+    // The frame was still drawn, but it is missing whatever these triangles covered
+    if (renderer->dropped > 0) {
+        fprintf(stderr, "Tile renderer out of memory: %zu triangles were not drawn completely\n", renderer->dropped);
+        renderer->dropped = 0;
+    }
+
+    RENDER_STATS_TIME(stats, RENDER_STAGE_RASTER, start);
+    trace_end(zone);
+    return atomic_load(&renderer->pixels_written);
+}
@@ -1,5 +1,88 @@
 #include "render/vertex.h"
+#include "render/raster.h"
 
 Vec4 vertex_to_vec4(Vertex v) {
     return v.position;
-}
\ No newline at end of file
+}
+
+// Each output is summed in the order mat4_mul_vec4 uses, with w = 1 making the last term the
+// translation itself, so that every path rounds the same way
+static void transform_range_scalar(const Mat4* mvp, const VertexArrays* vertices, size_t start, size_t end,
+                                   ClipArrays* out) {
+    const float* m = mvp->m;
+    for (size_t i = start; i < end; i++) {
+        float x = vertices->x[i];
+        float y = vertices->y[i];
+        float z = vertices->z[i];
+        out->x[i] = m[0] * x + m[4] * y + m[8] * z + m[12];
+        out->y[i] = m[1] * x + m[5] * y + m[9] * z + m[13];
+        out->z[i] = m[2] * x + m[6] * y + m[10] * z + m[14];
+        out->w[i] = m[3] * x + m[7] * y + m[11] * z + m[15];
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VERTEX_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+
+// Without FMA, which neither target enables, the multiplies and adds round one at a time like the scalar path
+__attribute__((target("sse2")))
+static size_t transform_sse2(const Mat4* mvp, const VertexArrays* vertices, size_t count, ClipArrays* out) {
+    const float* m = mvp->m;
+    float* outputs[4] = {out->x, out->y, out->z, out->w};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(vertices->x + i);
+        __m128 y = _mm_loadu_ps(vertices->y + i);
+        __m128 z = _mm_loadu_ps(vertices->z + i);
+        for (int row = 0; row < 4; row++) {
+            __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[row]), x), _mm_mul_ps(_mm_set1_ps(m[4 + row]), y));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[8 + row]), z));
+            _mm_storeu_ps(outputs[row] + i, _mm_add_ps(sum, _mm_set1_ps(m[12 + row])));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t transform_avx2(const Mat4* mvp, const VertexArrays* vertices, size_t count, ClipArrays* out) {
+    const float* m = mvp->m;
+    __m256 c[16];
+    for (int k = 0; k < 16; k++) {
+        c[k] = _mm256_set1_ps(m[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(vertices->x + i);
+        __m256 y = _mm256_loadu_ps(vertices->y + i);
+        __m256 z = _mm256_loadu_ps(vertices->z + i);
+        __m256 cx = _mm256_add_ps(_mm256_mul_ps(c[0], x), _mm256_mul_ps(c[4], y));
+        __m256 cy = _mm256_add_ps(_mm256_mul_ps(c[1], x), _mm256_mul_ps(c[5], y));
+        __m256 cz = _mm256_add_ps(_mm256_mul_ps(c[2], x), _mm256_mul_ps(c[6], y));
+        __m256 cw = _mm256_add_ps(_mm256_mul_ps(c[3], x), _mm256_mul_ps(c[7], y));
+        cx = _mm256_add_ps(_mm256_add_ps(cx, _mm256_mul_ps(c[8], z)), c[12]);
+        cy = _mm256_add_ps(_mm256_add_ps(cy, _mm256_mul_ps(c[9], z)), c[13]);
+        cz = _mm256_add_ps(_mm256_add_ps(cz, _mm256_mul_ps(c[10], z)), c[14]);
+        cw = _mm256_add_ps(_mm256_add_ps(cw, _mm256_mul_ps(c[11], z)), c[15]);
+        _mm256_storeu_ps(out->x + i, cx);
+        _mm256_storeu_ps(out->y + i, cy);
+        _mm256_storeu_ps(out->z + i, cz);
+        _mm256_storeu_ps(out->w + i, cw);
+    }
+    return i;
+}
+#endif
+
+void transform_vertex_arrays(const Mat4* mvp, const VertexArrays* vertices, size_t count, ClipArrays* out) {
+    size_t done = 0;
+#ifdef VERTEX_HAVE_X86_KERNELS
+    switch (raster_get_path()) {
+        case RASTER_PATH_AVX2: done = transform_avx2(mvp, vertices, count, out); break;
+        case RASTER_PATH_SSE2: done = transform_sse2(mvp, vertices, count, out); break;
+        default: break;
+    }
+#endif
+    // The vertices left over after the last full batch
+    transform_range_scalar(mvp, vertices, done, count, out);
+}
@@ -1,11 +1,27 @@
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "harness/unity.h"
 #include "../include/core/pixel_buffer.h"
 #include "../include/core/camera.h"
+#include "../include/core/frame_sink.h"
+#include "../include/core/json.h"
+#include "../include/core/qoi.h"
+#include "../include/core/trace.h"
 #include "../include/math/vec3.h"
 #include "../include/math/mat4.h"
+#include "../include/mesh/gltf.h"
+#include "../include/mesh/mesh.h"
+#include "../include/mesh/mesh_cache.h"
+#include "../include/mesh/mesh_optimize.h"
+#include "../include/render/clip.h"
 #include "../include/render/depth_buffer.h"
+#include "../include/render/scene.h"
+#include "../include/render/triangle.h"
+#include "../include/render/raster.h"
+#include "../include/render/render_stats.h"
+#include "../include/render/tile_renderer.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -56,6 +72,34 @@ void test_set_pixel(void) {
     TEST_ASSERT_EQUAL_UINT8(0, buffer->pixels[index].b);
 }
 
+void test_fill_span_matches_set_pixel(void) {
+    PixelLayout layouts[] = { PIXEL_LAYOUT_LINEAR, PIXEL_LAYOUT_TILED };
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        PixelBuffer* spans = create_pixel_buffer_with_layout(21, 5, layouts[l]);
+        PixelBuffer* pixels = create_pixel_buffer_with_layout(21, 5, layouts[l]);
+        Color red = {255, 0, 0, 255};
+        Color blue = {0, 0, 255, 255};
+
+        // Spans crossing tile boundaries, ending at the right edge, and a single pixel
+        fill_span(spans, 3, 17, 1, red);
+        fill_span(spans, 6, 20, 4, blue);
+        fill_span(spans, 0, 0, 2, red);
+        set_pixel_unchecked(spans, 9, 3, blue);
+        for (int x = 3; x <= 17; x++) set_pixel(pixels, x, 1, red);
+        for (int x = 6; x <= 20; x++) set_pixel(pixels, x, 4, blue);
+        set_pixel(pixels, 0, 2, red);
+        set_pixel(pixels, 9, 3, blue);
+
+        TEST_ASSERT_EQUAL_MEMORY(pixels->pixels, spans->pixels, sizeof(Color) * spans->storage_width * spans->storage_height);
+        if (layouts[l] == PIXEL_LAYOUT_LINEAR) {
+            TEST_ASSERT_EQUAL_PTR(&spans->pixels[4 * 21], pixel_row(spans, 4));
+        }
+
+        destroy_pixel_buffer(pixels);
+        destroy_pixel_buffer(spans);
+    }
+}
+
 void test_get_pixel(void) {
     Color blue = {0, 0, 255, 255};
     set_pixel(buffer, 2, 3, blue);
@@ -208,11 +252,37 @@ void test_mat4_perspective(void) {
 
     TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.0f, matrix.m[0]);
     TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.0f, matrix.m[5]);
-    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.001001f, matrix.m[10]);
-    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.1001001f, matrix.m[14]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.002002f, matrix.m[10]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, -0.2002002f, matrix.m[14]);
     TEST_ASSERT_EQUAL_FLOAT(1.0f, matrix.m[11]);
 }
 
+// Depth z / w of a point straight ahead of the camera at view distance z
+static float projected_depth(Mat4 projection, float z) {
+    Vec4 clip = mat4_mul_vec4(projection, (Vec4){0.0f, 0.0f, z, 1.0f});
+    return clip.z / clip.w;
+}
+
+void test_mat4_perspective_depth_variants(void) {
+    Mat4 standard = mat4_perspective(90.0f, 1.0f, 0.1f, 100.0f);
+    Mat4 zero_to_one = mat4_perspective_zero_to_one(90.0f, 1.0f, 0.1f, 100.0f);
+    Mat4 reversed = mat4_perspective_reversed(90.0f, 1.0f, 0.1f, 100.0f);
+
+    // All three put nearer surfaces on the same side: smaller depth, or larger when reversed
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, -1.0f, projected_depth(standard, 0.1f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, projected_depth(standard, 100.0f));
+    TEST_ASSERT_TRUE(projected_depth(standard, 10.0f) < projected_depth(standard, 20.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (projected_depth(standard, 7.0f) + 1.0f) * 0.5f, projected_depth(zero_to_one, 7.0f));
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, projected_depth(zero_to_one, 0.1f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, projected_depth(zero_to_one, 100.0f));
+    TEST_ASSERT_TRUE(projected_depth(zero_to_one, 10.0f) < projected_depth(zero_to_one, 20.0f));
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, projected_depth(reversed, 0.1f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, projected_depth(reversed, 100.0f));
+    TEST_ASSERT_TRUE(projected_depth(reversed, 10.0f) > projected_depth(reversed, 20.0f));
+}
+
 void test_create_depth_buffer(void) {
     int width = 5;
     int height = 5;
@@ -381,11 +451,1909 @@ void test_mat4_rotation_y(void) {
     TEST_ASSERT_FLOAT_WITHIN(0.0001f, -1.0f, rot.m[8]);
 }
 
+void test_clip_triangle_splits_at_near_plane(void) {
+    // One vertex behind the eye: what is left lies in front of it and inside the guard band
+    ClipPolygon polygon;
+    int count = clip_triangle((Vec4){-0.5f, -0.5f, 0.5f, 1.0f},
+                              (Vec4){ 0.5f, -0.5f, 0.5f, 1.0f},
+                              (Vec4){ 0.0f,  0.5f, -0.5f, -1.0f}, &polygon);
+
+    TEST_ASSERT_TRUE(count >= 4);
+    for (int i = 0; i < count; i++) {
+        Vec4 v = polygon.vertices[i];
+        TEST_ASSERT_TRUE(v.w >= CLIP_W_EPSILON * 0.999f);
+        TEST_ASSERT_TRUE(fabsf(v.x) <= CLIP_GUARD_BAND * v.w * 1.001f);
+        TEST_ASSERT_TRUE(fabsf(v.y) <= CLIP_GUARD_BAND * v.w * 1.001f);
+    }
+
+    // The edge between the two visible vertices survives, the edges made by the planes do not
+    TEST_ASSERT_EQUAL_FLOAT(-0.5f, polygon.vertices[0].x);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, polygon.vertices[1].x);
+    TEST_ASSERT_TRUE(polygon.original_edge[0]);
+    int original = 0;
+    for (int i = 0; i < count; i++) {
+        original += polygon.original_edge[i];
+    }
+    TEST_ASSERT_EQUAL_INT(3, original);
+}
+
+void test_clip_triangle_rejects_and_passes_through(void) {
+    ClipPolygon polygon;
+
+    // Entirely to the right of the view frustum
+    TEST_ASSERT_EQUAL_INT(0, clip_triangle((Vec4){2.0f, 0.0f, 0.5f, 1.0f},
+                                           (Vec4){3.0f, 0.0f, 0.5f, 1.0f},
+                                           (Vec4){2.5f, 1.0f, 0.5f, 1.0f}, &polygon));
+
+    // Entirely behind the eye
+    TEST_ASSERT_EQUAL_INT(0, clip_triangle((Vec4){0.0f, 0.0f, 0.5f, -1.0f},
+                                           (Vec4){1.0f, 0.0f, 0.5f, -1.0f},
+                                           (Vec4){0.0f, 1.0f, 0.5f, -2.0f}, &polygon));
+
+    // Partly off screen but inside the guard band: left unchanged
+    Vec4 c0 = {-3.0f, 0.0f, 0.5f, 1.0f};
+    TEST_ASSERT_EQUAL_INT(3, clip_triangle(c0, (Vec4){0.5f, 0.0f, 0.5f, 1.0f}, (Vec4){0.0f, 0.5f, 0.5f, 1.0f}, &polygon));
+    TEST_ASSERT_EQUAL_FLOAT(c0.x, polygon.vertices[0].x);
+
+    // Far outside the guard band: cut back to it
+    int count = clip_triangle((Vec4){-1000.0f, 0.0f, 0.5f, 1.0f}, (Vec4){0.5f, 0.0f, 0.5f, 1.0f},
+                              (Vec4){0.0f, 0.5f, 0.5f, 1.0f}, &polygon);
+    TEST_ASSERT_TRUE(count >= 3);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(polygon.vertices[i].x >= -CLIP_GUARD_BAND * polygon.vertices[i].w - 1e-3f);
+    }
+}
+
+void test_clip_line_cuts_at_near_plane_and_guard_band(void) {
+    // Inside the guard band: left unchanged
+    Vec4 a = {-3.0f, 0.5f, 0.5f, 1.0f};
+    Vec4 b = {0.5f, 0.0f, 0.5f, 1.0f};
+    TEST_ASSERT_TRUE(clip_line(&a, &b));
+    TEST_ASSERT_EQUAL_FLOAT(-3.0f, a.x);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, b.x);
+
+    // Both ends behind the eye, or both off one side of the frustum
+    a = (Vec4){0.0f, 0.0f, 0.5f, -1.0f};
+    b = (Vec4){1.0f, 0.0f, 0.5f, -2.0f};
+    TEST_ASSERT_FALSE(clip_line(&a, &b));
+    a = (Vec4){2.0f, 0.0f, 0.5f, 1.0f};
+    b = (Vec4){3.0f, 1.0f, 0.5f, 1.0f};
+    TEST_ASSERT_FALSE(clip_line(&a, &b));
+
+    // One end behind the eye and one on the eye plane: what is left can be divided by w
+    Vec4 ends[2][2] = { { {0.2f, 0.1f, 0.5f, 1.0f}, {0.0f, 0.5f, -0.5f, -1.0f} },
+                        { {0.2f, 0.1f, 0.5f, 1.0f}, {0.3f, 0.5f, 0.0f, 0.0f} } };
+    for (int i = 0; i < 2; i++) {
+        a = ends[i][0];
+        b = ends[i][1];
+        TEST_ASSERT_TRUE(clip_line(&a, &b));
+        TEST_ASSERT_EQUAL_FLOAT(0.2f, a.x);
+        TEST_ASSERT_TRUE(b.w >= CLIP_W_EPSILON * 0.999f);
+        TEST_ASSERT_TRUE(fabsf(b.x) <= CLIP_GUARD_BAND * b.w * 1.001f);
+        TEST_ASSERT_TRUE(fabsf(b.y) <= CLIP_GUARD_BAND * b.w * 1.001f);
+    }
+}
+
+void test_draw_wireframe_clips_edges_behind_the_eye(void) {
+    int size = 64;
+    PixelBuffer* buffer = create_pixel_buffer(size, size);
+    TEST_ASSERT_NOT_NULL(buffer);
+
+    // A projection with w = z puts the third vertex on the eye plane, where dividing by w
+    // would send it to infinity
+    Mat4 mvp = mat4_identity();
+    mvp.m[11] = 1.0f;
+    mvp.m[15] = 0.0f;
+    Vertex vertices[3] = {0};
+    vertices[0].position = (Vec4){-0.5f, -0.5f, 1.0f, 1.0f};
+    vertices[1].position = (Vec4){ 0.5f, -0.5f, 1.0f, 1.0f};
+    vertices[2].position = (Vec4){ 0.0f,  0.5f, 0.0f, 1.0f};
+    int indices[3] = {0, 1, 2};
+    Mesh mesh = { .vertices = vertices, .indices = indices, .vertexCount = 3, .indexCount = 3 };
+
+    size_t pixels = draw_wireframe(&mesh, mvp, buffer, NULL, size, size);
+
+    // The bottom edge is fully visible, and the other two are cut where they leave the guard band
+    TEST_ASSERT_TRUE(pixels >= (size_t)size / 2);
+    TEST_ASSERT_TRUE(pixels <= 3 * (size_t)(CLIP_GUARD_BAND + 1.0f) * size);
+    destroy_pixel_buffer(buffer);
+}
+
+void test_setup_culls_by_screen_winding(void) {
+    int width = 64;
+    int height = 64;
+    ProjectedVertex a, b, c;
+    project_vertex(&a, (Vec4){-0.5f, -0.5f, 0.5f, 1.0f}, width, height);
+    project_vertex(&b, (Vec4){ 0.5f, -0.5f, 0.5f, 1.0f}, width, height);
+    project_vertex(&c, (Vec4){ 0.0f,  0.5f, 0.5f, 1.0f}, width, height);
+
+    // Counter-clockwise in NDC faces the viewer
+    RasterTriangle tris[RASTER_MAX_CLIPPED_TRIANGLES];
+    TEST_ASSERT_EQUAL_INT(1, setup_projected_triangle(tris, &a, &b, &c, CULL_BACK, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+    TEST_ASSERT_EQUAL_INT(0, setup_projected_triangle(tris, &a, &c, &b, CULL_BACK, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+    TEST_ASSERT_EQUAL_INT(0, setup_projected_triangle(tris, &a, &b, &c, CULL_FRONT, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+    TEST_ASSERT_EQUAL_INT(1, setup_projected_triangle(tris, &a, &c, &b, CULL_FRONT, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+    TEST_ASSERT_EQUAL_INT(1, setup_projected_triangle(tris, &a, &b, &c, CULL_NONE, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+    TEST_ASSERT_EQUAL_INT(1, setup_projected_triangle(tris, &a, &c, &b, CULL_NONE, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+
+    // Degenerate: all three vertices on one line
+    ProjectedVertex d;
+    project_vertex(&d, (Vec4){ 1.5f, -0.5f, 0.5f, 1.0f}, width, height);
+    TEST_ASSERT_EQUAL_INT(0, setup_projected_triangle(tris, &a, &b, &d, CULL_NONE, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+
+    // A sliver lying between two rows of pixel centers covers no sample
+    ProjectedVertex s0, s1, s2;
+    float y = 1.0f - (10.1f / (height / 2));
+    project_vertex(&s0, (Vec4){-0.5f, y, 0.5f, 1.0f}, width, height);
+    project_vertex(&s1, (Vec4){ 0.5f, y, 0.5f, 1.0f}, width, height);
+    project_vertex(&s2, (Vec4){ 0.0f, y - 0.2f / (height / 2), 0.5f, 1.0f}, width, height);
+    TEST_ASSERT_EQUAL_INT(0, setup_projected_triangle(tris, &s0, &s1, &s2, CULL_NONE, DEPTH_FORMAT_FLOAT32, width, height, NULL));
+}
+
+#define FILL_SIZE 64
+#define FILL_CELLS 6
+
+// Splits a grid of screen points into two triangles per cell, rasterizes each triangle into
+// fresh buffers and counts how many triangles wrote every pixel
+static void rasterize_tessellated_quad(const float xs[FILL_CELLS + 1][FILL_CELLS + 1],
+                                       const float ys[FILL_CELLS + 1][FILL_CELLS + 1],
+                                       int counts[FILL_SIZE * FILL_SIZE]) {
+    PixelBuffer* buffer = create_pixel_buffer(FILL_SIZE, FILL_SIZE);
+    float* depth = create_depth_buffer(FILL_SIZE, FILL_SIZE);
+    ProjectedVertex grid[FILL_CELLS + 1][FILL_CELLS + 1];
+    float half = FILL_SIZE / 2;
+
+    for (int j = 0; j <= FILL_CELLS; j++) {
+        for (int i = 0; i <= FILL_CELLS; i++) {
+            Vec4 clip = { xs[j][i] / half - 1.0f, 1.0f - ys[j][i] / half, 0.5f, 1.0f };
+            project_vertex(&grid[j][i], clip, FILL_SIZE, FILL_SIZE);
+        }
+    }
+
+    memset(counts, 0, sizeof(int) * FILL_SIZE * FILL_SIZE);
+    for (int j = 0; j < FILL_CELLS; j++) {
+        for (int i = 0; i < FILL_CELLS; i++) {
+            // Alternate the diagonal so both orientations of shared edges are exercised
+            const ProjectedVertex* a = &grid[j][i];
+            const ProjectedVertex* b = &grid[j][i + 1];
+            const ProjectedVertex* c = &grid[j + 1][i + 1];
+            const ProjectedVertex* d = &grid[j + 1][i];
+            const ProjectedVertex* halves[2][3] = { { a, b, c }, { a, c, d } };
+            if ((i + j) % 2) {
+                const ProjectedVertex* other[2][3] = { { a, b, d }, { b, c, d } };
+                memcpy(halves, other, sizeof(halves));
+            }
+
+            for (int h = 0; h < 2; h++) {
+                RasterTriangle tris[RASTER_MAX_CLIPPED_TRIANGLES];
+                int count = setup_projected_triangle(tris, halves[h][0], halves[h][1], halves[h][2],
+                                                     CULL_NONE, DEPTH_FORMAT_FLOAT32, FILL_SIZE, FILL_SIZE, NULL);
+                clear_depth_buffer(depth, FILL_SIZE, FILL_SIZE);
+                for (int t = 0; t < count; t++) {
+                    rasterize_triangle(&tris[t], 0, 0, FILL_SIZE - 1, FILL_SIZE - 1, buffer, depth, NULL, NULL, NULL);
+                }
+                for (int p = 0; p < FILL_SIZE * FILL_SIZE; p++) {
+                    counts[p] += depth[p] != INFINITY;
+                }
+            }
+        }
+    }
+
+    destroy_depth_buffer(depth);
+    destroy_pixel_buffer(buffer);
+}
+
+void test_fill_rule_regular_quad_touches_each_pixel_once(void) {
+    // Vertices on pixel centers, so every horizontal and vertical edge runs through samples
+    float xs[FILL_CELLS + 1][FILL_CELLS + 1];
+    float ys[FILL_CELLS + 1][FILL_CELLS + 1];
+    for (int j = 0; j <= FILL_CELLS; j++) {
+        for (int i = 0; i <= FILL_CELLS; i++) {
+            xs[j][i] = 4.5f + i * 9.0f;
+            ys[j][i] = 4.5f + j * 9.0f;
+        }
+    }
+
+    int counts[FILL_SIZE * FILL_SIZE];
+    rasterize_tessellated_quad(xs, ys, counts);
+
+    for (int y = 0; y < FILL_SIZE; y++) {
+        for (int x = 0; x < FILL_SIZE; x++) {
+            // Pixels on the outer border belong to the quad only on its top and left sides
+            int expected = (x >= 4 && x < 58 && y >= 4 && y < 58) ? 1 : 0;
+            TEST_ASSERT_EQUAL_INT(expected, counts[y * FILL_SIZE + x]);
+        }
+    }
+}
+
+void test_fill_rule_jittered_quad_touches_each_pixel_once(void) {
+    // Interior vertices moved off the grid so shared edges take arbitrary slopes
+    float xs[FILL_CELLS + 1][FILL_CELLS + 1];
+    float ys[FILL_CELLS + 1][FILL_CELLS + 1];
+    unsigned seed = 12345u;
+    for (int j = 0; j <= FILL_CELLS; j++) {
+        for (int i = 0; i <= FILL_CELLS; i++) {
+            xs[j][i] = 4.0f + i * 9.0f;
+            ys[j][i] = 4.0f + j * 9.0f;
+            if (i > 0 && i < FILL_CELLS && j > 0 && j < FILL_CELLS) {
+                seed = seed * 1103515245u + 12345u;
+                xs[j][i] += ((seed >> 16) % 600) / 100.0f - 3.0f;
+                seed = seed * 1103515245u + 12345u;
+                ys[j][i] += ((seed >> 16) % 600) / 100.0f - 3.0f;
+            }
+        }
+    }
+
+    int counts[FILL_SIZE * FILL_SIZE];
+    rasterize_tessellated_quad(xs, ys, counts);
+
+    // The outline is the square from 4 to 58, whose edges fall between pixel centers
+    for (int y = 0; y < FILL_SIZE; y++) {
+        for (int x = 0; x < FILL_SIZE; x++) {
+            int expected = (x >= 4 && x < 58 && y >= 4 && y < 58) ? 1 : 0;
+            TEST_ASSERT_EQUAL_INT(expected, counts[y * FILL_SIZE + x]);
+        }
+    }
+}
+
+// Rasterizes one triangle given in screen coordinates into fresh buffers and adds one to the
+// count of every pixel it wrote
+static void rasterize_screen_triangle(const float points[3][2], int counts[FILL_SIZE * FILL_SIZE]) {
+    PixelBuffer* buffer = create_pixel_buffer(FILL_SIZE, FILL_SIZE);
+    float* depth = create_depth_buffer(FILL_SIZE, FILL_SIZE);
+    float half = FILL_SIZE / 2;
+
+    ProjectedVertex v[3];
+    for (int i = 0; i < 3; i++) {
+        Vec4 clip = { points[i][0] / half - 1.0f, 1.0f - points[i][1] / half, 0.5f, 1.0f };
+        project_vertex(&v[i], clip, FILL_SIZE, FILL_SIZE);
+    }
+
+    RasterTriangle tris[RASTER_MAX_CLIPPED_TRIANGLES];
+    int count = setup_projected_triangle(tris, &v[0], &v[1], &v[2], CULL_NONE, DEPTH_FORMAT_FLOAT32,
+                                         FILL_SIZE, FILL_SIZE, NULL);
+    for (int t = 0; t < count; t++) {
+        rasterize_triangle(&tris[t], 0, 0, FILL_SIZE - 1, FILL_SIZE - 1, buffer, depth, NULL, NULL, NULL);
+    }
+    for (int p = 0; p < FILL_SIZE * FILL_SIZE; p++) {
+        counts[p] += depth[p] != INFINITY;
+    }
+
+    destroy_depth_buffer(depth);
+    destroy_pixel_buffer(buffer);
+}
+
+void test_fixed_point_shared_edge_covers_each_pixel_once(void) {
+    // The shared diagonal runs through a pixel center on every row
+    const float first[3][2] = { {8.5f, 8.5f}, {40.5f, 8.5f}, {40.5f, 40.5f} };
+    const float second[3][2] = { {8.5f, 8.5f}, {40.5f, 40.5f}, {8.5f, 40.5f} };
+
+    RasterPath original = raster_get_path();
+    RasterPath paths[] = { RASTER_PATH_SCALAR, RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        if (!raster_set_path(paths[p])) {
+            continue;
+        }
+        int counts[FILL_SIZE * FILL_SIZE] = {0};
+        rasterize_screen_triangle(first, counts);
+        rasterize_screen_triangle(second, counts);
+        for (int y = 0; y < FILL_SIZE; y++) {
+            for (int x = 0; x < FILL_SIZE; x++) {
+                int expected = (x >= 8 && x < 40 && y >= 8 && y < 40) ? 1 : 0;
+                TEST_ASSERT_EQUAL_INT(expected, counts[y * FILL_SIZE + x]);
+            }
+        }
+    }
+    raster_set_path(original);
+}
+
+void test_fixed_point_subpixel_offsets_decide_coverage(void) {
+    // A right triangle whose left edge sits 1/256 pixel right of the centers of column 5 and
+    // whose top edge sits 1/256 pixel above the centers of row 6, so only the subpixel bits
+    // keep column 5 out and row 6 in
+    const float sub = 1.0f / 256.0f;
+    const float x0 = 5.5f + sub, y0 = 6.5f - sub, x1 = 30.25f + 3 * sub, y1 = 27.75f - 5 * sub;
+    const float points[3][2] = { {x0, y0}, {x1, y0}, {x0, y1} };
+
+    RasterPath original = raster_get_path();
+    RasterPath paths[] = { RASTER_PATH_SCALAR, RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        if (!raster_set_path(paths[p])) {
+            continue;
+        }
+        int counts[FILL_SIZE * FILL_SIZE] = {0};
+        rasterize_screen_triangle(points, counts);
+        for (int y = 0; y < FILL_SIZE; y++) {
+            for (int x = 0; x < FILL_SIZE; x++) {
+                // Every value lies on the subpixel grid, so these products are exact in double.
+                // The top and left edges own their samples, the hypotenuse does not.
+                double cx = x + 0.5, cy = y + 0.5;
+                bool inside = cx >= x0 && cy >= y0 &&
+                              (cx - x0) * (y1 - y0) + (cy - y0) * (x1 - x0) < (double)(x1 - x0) * (y1 - y0);
+                TEST_ASSERT_EQUAL_INT(inside ? 1 : 0, counts[y * FILL_SIZE + x]);
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(0, counts[20 * FILL_SIZE + 5]);
+        TEST_ASSERT_EQUAL_INT(1, counts[6 * FILL_SIZE + 6]);
+    }
+    raster_set_path(original);
+}
+
+void test_fixed_point_degenerate_triangles_write_nothing(void) {
+    const float collinear[3][2] = { {4.5f, 4.5f}, {20.5f, 12.5f}, {36.5f, 20.5f} };
+    const float point[3][2] = { {10.5f, 10.5f}, {10.5f, 10.5f}, {10.5f, 10.5f} };
+    // Distinct inputs that snap to the same subpixel position
+    const float snapped[3][2] = { {12.5f, 12.5f}, {12.5001f, 12.5f}, {12.5f, 12.5001f} };
+
+    RasterPath original = raster_get_path();
+    RasterPath paths[] = { RASTER_PATH_SCALAR, RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        if (!raster_set_path(paths[p])) {
+            continue;
+        }
+        int counts[FILL_SIZE * FILL_SIZE] = {0};
+        rasterize_screen_triangle(collinear, counts);
+        rasterize_screen_triangle(point, counts);
+        rasterize_screen_triangle(snapped, counts);
+        for (int i = 0; i < FILL_SIZE * FILL_SIZE; i++) {
+            TEST_ASSERT_EQUAL_INT(0, counts[i]);
+        }
+    }
+    raster_set_path(original);
+}
+
+void test_draw_mesh_matches_draw_triangle(void) {
+    int width = 160;
+    int height = 120;
+    Mesh* mesh = create_cube_mesh();
+    TEST_ASSERT_NOT_NULL(mesh);
+
+    Camera view;
+    camera_init(&view, (Vec3){0.0f, 0.0f, -3.0f}, (Vec3){0.0f, 0.0f, 0.0f}, (Vec3){0.0f, 1.0f, 0.0f},
+                45.0f, (float)width / height, 0.1f, 100.0f);
+    Mat4 model = mat4_multiply(mat4_translation(0.3f, -0.2f, 0.0f), mat4_rotation_y(0.6f));
+    Mat4 mvp = mat4_multiply(view.projection_matrix, mat4_multiply(camera_get_view_matrix(&view), model));
+
+    PixelBuffer* triangle_pixels = create_pixel_buffer(width, height);
+    float* triangle_depth = create_depth_buffer(width, height);
+    int triangle_count = 0;
+    for (size_t t = 0; t + 2 < mesh->indexCount; t += 3) {
+        triangle_count += draw_triangle(mesh->vertices[mesh->indices[t]], mesh->vertices[mesh->indices[t + 1]],
+                                        mesh->vertices[mesh->indices[t + 2]], mvp,
+                                        triangle_pixels, triangle_depth, width, height);
+    }
+
+    PixelBuffer* mesh_pixels = create_pixel_buffer(width, height);
+    float* mesh_depth = create_depth_buffer(width, height);
+    VertexStream* stream = create_vertex_stream();
+    TEST_ASSERT_NOT_NULL(stream);
+    RenderTarget target = { .buffer = mesh_pixels, .depth_buffer = mesh_depth, .width = width, .height = height, .stream = stream };
+    size_t mesh_count = draw_mesh(mesh, &mvp, &target);
+
+    TEST_ASSERT_TRUE(triangle_count > 0);
+    TEST_ASSERT_EQUAL_UINT((size_t)triangle_count, mesh_count);
+    TEST_ASSERT_EQUAL_MEMORY(triangle_pixels->pixels, mesh_pixels->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(triangle_depth, mesh_depth, sizeof(float) * width * height);
+    TEST_ASSERT_TRUE(stream->capacity >= mesh->vertexCount);
+
+    destroy_vertex_stream(stream);
+    destroy_depth_buffer(mesh_depth);
+    destroy_pixel_buffer(mesh_pixels);
+    destroy_depth_buffer(triangle_depth);
+    destroy_pixel_buffer(triangle_pixels);
+    destroy_mesh(mesh);
+}
+
+void test_draw_mesh_skips_triangles_with_bad_indices(void) {
+    int width = 160;
+    int height = 120;
+    Mesh* mesh = create_cube_mesh();
+    TEST_ASSERT_NOT_NULL(mesh);
+
+    Camera view;
+    camera_init(&view, (Vec3){0.0f, 0.0f, -3.0f}, (Vec3){0.0f, 0.0f, 0.0f}, (Vec3){0.0f, 1.0f, 0.0f},
+                45.0f, (float)width / height, 0.1f, 100.0f);
+    Mat4 mvp = mat4_multiply(view.projection_matrix, mat4_multiply(camera_get_view_matrix(&view), mat4_rotation_y(0.6f)));
+
+    // The cube without its last two triangles is what must be drawn once they are broken
+    PixelBuffer* pixels[2];
+    float* depth[2];
+    size_t written[2];
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            mesh->indexCount -= 6;
+        } else {
+            mesh->indexCount += 6;
+            mesh->indices[mesh->indexCount - 5] = (int)mesh->vertexCount;
+            mesh->indices[mesh->indexCount - 1] = -1;
+        }
+        pixels[pass] = create_pixel_buffer(width, height);
+        depth[pass] = create_depth_buffer(width, height);
+        RenderTarget target = { .buffer = pixels[pass], .depth_buffer = depth[pass], .width = width, .height = height };
+        written[pass] = draw_mesh(mesh, &mvp, &target);
+    }
+
+    TEST_ASSERT_TRUE(written[0] > 0);
+    TEST_ASSERT_EQUAL_UINT(written[0], written[1]);
+    TEST_ASSERT_EQUAL_MEMORY(pixels[0]->pixels, pixels[1]->pixels, sizeof(Color) * width * height);
+    for (int pass = 0; pass < 2; pass++) {
+        destroy_depth_buffer(depth[pass]);
+        destroy_pixel_buffer(pixels[pass]);
+    }
+    destroy_mesh(mesh);
+}
+
+void test_tile_renderer_matches_serial(void) {
+    int width = 200;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_GRID);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    PixelBuffer* serial_pixels = create_pixel_buffer(width, height);
+    float* serial_depth = create_depth_buffer(width, height);
+    RenderTarget serial = { .buffer = serial_pixels, .depth_buffer = serial_depth, .width = width, .height = height };
+    SceneStats serial_stats;
+    draw_scene(scene, &view, &serial, &serial_stats);
+
+    PixelBuffer* tiled_pixels = create_pixel_buffer(width, height);
+    float* tiled_depth = create_depth_buffer(width, height);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    TEST_ASSERT_NOT_NULL(tiles);
+    RenderTarget tiled = { .buffer = tiled_pixels, .depth_buffer = tiled_depth, .width = width, .height = height, .tiles = tiles };
+    SceneStats tiled_stats;
+    draw_scene(scene, &view, &tiled, &tiled_stats);
+
+    TEST_ASSERT_TRUE(serial_stats.pixels > 0);
+    TEST_ASSERT_EQUAL_UINT(serial_stats.pixels, tiled_stats.pixels);
+    TEST_ASSERT_EQUAL_MEMORY(serial_pixels->pixels, tiled_pixels->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(serial_depth, tiled_depth, sizeof(float) * width * height);
+
+    destroy_tile_renderer(tiles);
+    destroy_depth_buffer(tiled_depth);
+    destroy_pixel_buffer(tiled_pixels);
+    destroy_depth_buffer(serial_depth);
+    destroy_pixel_buffer(serial_pixels);
+    destroy_scene(scene);
+}
+
+void test_raster_paths_match_scalar(void) {
+    // An odd width leaves a partial block at the right edge of every row
+    int width = 203;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_GRID);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    RasterPath original = raster_get_path();
+    TEST_ASSERT_TRUE(raster_set_path(RASTER_PATH_SCALAR));
+
+    PixelBuffer* scalar_pixels = create_pixel_buffer(width, height);
+    float* scalar_depth = create_depth_buffer(width, height);
+    RenderTarget scalar = { .buffer = scalar_pixels, .depth_buffer = scalar_depth, .width = width, .height = height };
+    SceneStats scalar_stats;
+    draw_scene(scene, &view, &scalar, &scalar_stats);
+    TEST_ASSERT_TRUE(scalar_stats.pixels > 0);
+
+    PixelBuffer* simd_pixels = create_pixel_buffer(width, height);
+    float* simd_depth = create_depth_buffer(width, height);
+    RenderTarget simd = { .buffer = simd_pixels, .depth_buffer = simd_depth, .width = width, .height = height };
+
+    RasterPath paths[] = { RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        if (!raster_set_path(paths[i])) {
+            continue;
+        }
+
+        clear_buffer(simd_pixels, (Color){0, 0, 0, 0});
+        clear_depth_buffer(simd_depth, width, height);
+        SceneStats simd_stats;
+        draw_scene(scene, &view, &simd, &simd_stats);
+
+        TEST_ASSERT_EQUAL_UINT(scalar_stats.pixels, simd_stats.pixels);
+        TEST_ASSERT_EQUAL_MEMORY(scalar_pixels->pixels, simd_pixels->pixels, sizeof(Color) * width * height);
+        TEST_ASSERT_EQUAL_MEMORY(scalar_depth, simd_depth, sizeof(float) * width * height);
+    }
+
+    raster_set_path(original);
+    destroy_depth_buffer(simd_depth);
+    destroy_pixel_buffer(simd_pixels);
+    destroy_depth_buffer(scalar_depth);
+    destroy_pixel_buffer(scalar_pixels);
+    destroy_scene(scene);
+}
+
+void test_hiz_matches_plain_depth_test(void) {
+    int width = 203;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_LAYERS);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    PixelBuffer* plain_pixels = create_pixel_buffer(width, height);
+    float* plain_depth = create_depth_buffer(width, height);
+    RenderTarget plain = { .buffer = plain_pixels, .depth_buffer = plain_depth, .width = width, .height = height };
+    SceneStats plain_stats;
+    draw_scene(scene, &view, &plain, &plain_stats);
+
+    PixelBuffer* hiz_pixels = create_pixel_buffer(width, height);
+    float* hiz_depth = create_depth_buffer(width, height);
+    HiZBuffer* hiz = create_hiz_buffer(width, height);
+    TEST_ASSERT_NOT_NULL(hiz);
+    RenderTarget culled = { .buffer = hiz_pixels, .depth_buffer = hiz_depth, .width = width, .height = height, .hiz = hiz };
+    SceneStats hiz_stats;
+    draw_scene(scene, &view, &culled, &hiz_stats);
+
+    TEST_ASSERT_TRUE(plain_stats.pixels > 0);
+    TEST_ASSERT_EQUAL_UINT(plain_stats.pixels, hiz_stats.pixels);
+    TEST_ASSERT_EQUAL_MEMORY(plain_pixels->pixels, hiz_pixels->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(plain_depth, hiz_depth, sizeof(float) * width * height);
+
+    // Every block summary must be at least as far as the depths it covers
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float block_max = hiz->block_max[(y / HIZ_BLOCK_SIZE) * hiz->blocks_x + x / HIZ_BLOCK_SIZE];
+            TEST_ASSERT_TRUE(hiz_depth[y * width + x] <= block_max);
+        }
+    }
+
+    destroy_hiz_buffer(hiz);
+    destroy_depth_buffer(hiz_depth);
+    destroy_pixel_buffer(hiz_pixels);
+    destroy_depth_buffer(plain_depth);
+    destroy_pixel_buffer(plain_pixels);
+    destroy_scene(scene);
+}
+
+void test_clear_tiles_match_eager_clear(void) {
+    int width = 203;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_DEFAULT);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    PixelBuffer* eager_pixels = create_pixel_buffer(width, height);
+    float* eager_depth = create_depth_buffer(width, height);
+    RenderTarget eager = { .buffer = eager_pixels, .depth_buffer = eager_depth, .width = width, .height = height };
+    SceneStats eager_stats;
+    draw_scene(scene, &view, &eager, &eager_stats);
+
+    // Start from stale contents that would show through anywhere the lazy clear missed
+    PixelBuffer* lazy_pixels = create_pixel_buffer(width, height);
+    float* lazy_depth = create_depth_buffer(width, height);
+    memset(lazy_pixels->pixels, 0x5a, sizeof(Color) * width * height);
+    memset(lazy_depth, 0, sizeof(float) * width * height);
+    ClearTiles* clear = create_clear_tiles(width, height, DEPTH_FORMAT_FLOAT32);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    TEST_ASSERT_NOT_NULL(clear);
+    TEST_ASSERT_NOT_NULL(tiles);
+
+    RenderTarget serial = { .buffer = lazy_pixels, .depth_buffer = lazy_depth, .width = width, .height = height, .clear = clear };
+    RenderTarget tiled = serial;
+    tiled.tiles = tiles;
+    RenderTarget* targets[] = { &serial, &tiled };
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        clear_tiles_begin(clear, (Color){0, 0, 0, 0});
+        SceneStats lazy_stats;
+        draw_scene(scene, &view, targets[i], &lazy_stats);
+
+        TEST_ASSERT_EQUAL_UINT(eager_stats.pixels, lazy_stats.pixels);
+        TEST_ASSERT_EQUAL_MEMORY(eager_pixels->pixels, lazy_pixels->pixels, sizeof(Color) * width * height);
+
+        // Depth matches wherever a tile was drawn into; untouched tiles were never written
+        int untouched = 0;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                unsigned char flags = clear->pending[(y / CLEAR_TILE_SIZE) * clear->tiles_x + x / CLEAR_TILE_SIZE];
+                TEST_ASSERT_FALSE(flags & CLEAR_COLOR_PENDING);
+                if (flags & CLEAR_DEPTH_PENDING) {
+                    untouched++;
+                } else {
+                    TEST_ASSERT_EQUAL_FLOAT(eager_depth[y * width + x], lazy_depth[y * width + x]);
+                }
+            }
+        }
+        TEST_ASSERT_TRUE(untouched > 0);
+    }
+
+    destroy_tile_renderer(tiles);
+    destroy_clear_tiles(clear);
+    destroy_depth_buffer(lazy_depth);
+    destroy_pixel_buffer(lazy_pixels);
+    destroy_depth_buffer(eager_depth);
+    destroy_pixel_buffer(eager_pixels);
+    destroy_scene(scene);
+}
+
+void test_tiled_layout_matches_linear(void) {
+    // Neither dimension is a whole number of tiles, so the last tile row and column are padded
+    int width = 203;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_LAYERS);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    PixelBuffer* linear_pixels = create_pixel_buffer(width, height);
+    float* linear_depth = create_depth_buffer(width, height);
+    RenderTarget linear = { .buffer = linear_pixels, .depth_buffer = linear_depth, .width = width, .height = height };
+    SceneStats linear_stats;
+    draw_scene(scene, &view, &linear, &linear_stats);
+
+    PixelBuffer* tiled_pixels = create_pixel_buffer_with_layout(width, height, PIXEL_LAYOUT_TILED);
+    TEST_ASSERT_EQUAL_INT(208, tiled_pixels->storage_width);
+    TEST_ASSERT_EQUAL_INT(152, tiled_pixels->storage_height);
+    float* tiled_depth = create_depth_buffer(tiled_pixels->storage_width, tiled_pixels->storage_height);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    HiZBuffer* hiz = create_hiz_buffer(width, height);
+    ClearTiles* clear = create_clear_tiles(width, height, DEPTH_FORMAT_FLOAT32);
+    TEST_ASSERT_NOT_NULL(tiles);
+    TEST_ASSERT_NOT_NULL(hiz);
+    TEST_ASSERT_NOT_NULL(clear);
+
+    RenderTarget serial = { .buffer = tiled_pixels, .depth_buffer = tiled_depth, .width = width, .height = height };
+    RenderTarget tiled = { .buffer = tiled_pixels, .depth_buffer = tiled_depth, .width = width, .height = height,
+                           .tiles = tiles, .hiz = hiz, .clear = clear };
+    RenderTarget* targets[] = { &serial, &tiled };
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        clear_buffer(tiled_pixels, (Color){0, 0, 0, 0});
+        clear_depth_buffer(tiled_depth, tiled_pixels->storage_width, tiled_pixels->storage_height);
+        clear_hiz_buffer(hiz);
+        clear_tiles_begin(clear, (Color){0, 0, 0, 0});
+        SceneStats tiled_stats;
+        draw_scene(scene, &view, targets[i], &tiled_stats);
+
+        TEST_ASSERT_EQUAL_UINT(linear_stats.pixels, tiled_stats.pixels);
+        TEST_ASSERT_EQUAL_MEMORY(linear_pixels->pixels, resolve_pixel_buffer(tiled_pixels), sizeof(Color) * width * height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                TEST_ASSERT_EQUAL_FLOAT(linear_depth[y * width + x], tiled_depth[pixel_index(tiled_pixels, x, y)]);
+                Color color = get_pixel(tiled_pixels, x, y);
+                TEST_ASSERT_EQUAL_MEMORY(&linear_pixels->pixels[y * width + x], &color, sizeof(Color));
+            }
+        }
+    }
+
+    destroy_clear_tiles(clear);
+    destroy_hiz_buffer(hiz);
+    destroy_tile_renderer(tiles);
+    destroy_depth_buffer(tiled_depth);
+    destroy_pixel_buffer(tiled_pixels);
+    destroy_depth_buffer(linear_depth);
+    destroy_pixel_buffer(linear_pixels);
+    destroy_scene(scene);
+}
+
+void test_depth_formats_agree_across_paths(void) {
+    int width = 203;
+    int height = 150;
+    Scene* scene = create_scene(SCENE_LAYERS);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.7f);
+
+    DepthFormat formats[] = { DEPTH_FORMAT_FLOAT32_REVERSED, DEPTH_FORMAT_UNORM24, DEPTH_FORMAT_UNORM16,
+                              DEPTH_FORMAT_FLOAT32 };
+    size_t format_count = sizeof(formats) / sizeof(formats[0]);
+    PixelBuffer* images[4];
+    void* depths[4];
+    RasterPath original = raster_get_path();
+
+    for (size_t f = 0; f < format_count; f++) {
+        DepthFormat format = formats[f];
+        Camera camera = view;
+        if (format == DEPTH_FORMAT_FLOAT32_REVERSED) {
+            camera.projection_matrix = mat4_perspective_reversed(45.0f, (float)width / height, 0.1f, 100.0f);
+        } else if (format != DEPTH_FORMAT_FLOAT32) {
+            camera.projection_matrix = mat4_perspective_zero_to_one(45.0f, (float)width / height, 0.1f, 100.0f);
+        }
+        size_t depth_bytes = depth_format_size(format) * width * height;
+
+        // Reference: scalar kernel, drawn serially
+        TEST_ASSERT_TRUE(raster_set_path(RASTER_PATH_SCALAR));
+        images[f] = create_pixel_buffer(width, height);
+        depths[f] = create_depth_buffer_with_format(width, height, format);
+        RenderTarget reference = { .buffer = images[f], .depth_buffer = depths[f], .width = width, .height = height,
+                                   .depth_format = format };
+        SceneStats reference_stats;
+        draw_scene(scene, &camera, &reference, &reference_stats);
+        TEST_ASSERT_TRUE(reference_stats.pixels > 0);
+
+        // Every SIMD kernel, binned on three threads with hierarchical rejection and a lazy clear
+        PixelBuffer* pixels = create_pixel_buffer(width, height);
+        void* depth = create_depth_buffer_with_format(width, height, format);
+        TileRenderer* tiles = create_tile_renderer(width, height, 3);
+        HiZBuffer* hiz = create_hiz_buffer(width, height);
+        ClearTiles* clear = create_clear_tiles(width, height, format);
+        RenderTarget target = { .buffer = pixels, .depth_buffer = depth, .width = width, .height = height,
+                                .tiles = tiles, .hiz = hiz, .clear = clear, .depth_format = format };
+        RasterPath paths[] = { RASTER_PATH_SCALAR, RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+        for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+            if (!raster_set_path(paths[p])) {
+                continue;
+            }
+            clear_hiz_buffer(hiz);
+            clear_tiles_begin(clear, (Color){0, 0, 0, 0});
+            SceneStats stats;
+            draw_scene(scene, &camera, &target, &stats);
+
+            TEST_ASSERT_EQUAL_UINT(reference_stats.pixels, stats.pixels);
+            TEST_ASSERT_EQUAL_MEMORY(images[f]->pixels, pixels->pixels, sizeof(Color) * width * height);
+            TEST_ASSERT_EQUAL_MEMORY(depths[f], depth, depth_bytes);
+        }
+
+        destroy_clear_tiles(clear);
+        destroy_hiz_buffer(hiz);
+        destroy_tile_renderer(tiles);
+        destroy_depth_buffer(depth);
+        destroy_pixel_buffer(pixels);
+    }
+    raster_set_path(original);
+
+    // Float, reversed float and 24 bits resolve the same surfaces; 16 bits may tie between close
+    // layers, so there depths only have to agree wherever the same surface won
+    TEST_ASSERT_EQUAL_MEMORY(images[0]->pixels, images[1]->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(images[0]->pixels, images[3]->pixels, sizeof(Color) * width * height);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        float reversed = read_depth(depths[0], formats[0], i);
+        if (reversed < 1.0f) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, reversed, read_depth(depths[1], formats[1], i));
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, reversed, read_depth(depths[3], formats[3], i));
+        }
+        if (reversed < 1.0f && memcmp(&images[0]->pixels[i], &images[2]->pixels[i], sizeof(Color)) == 0) {
+            TEST_ASSERT_FLOAT_WITHIN(1.0f / DEPTH_UNORM16_MAX, reversed, read_depth(depths[2], formats[2], i));
+        }
+    }
+
+    for (size_t f = 0; f < format_count; f++) {
+        destroy_depth_buffer(depths[f]);
+        destroy_pixel_buffer(images[f]);
+    }
+    destroy_scene(scene);
+}
+
+void test_render_stats_account_for_every_triangle(void) {
+    int width = 160;
+    int height = 120;
+    Scene* scene = create_scene(SCENE_GRID);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera camera;
+    camera_init(&camera,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.4f);
+
+    PixelBuffer* buffer = create_pixel_buffer(width, height);
+    float* depth = create_depth_buffer(width, height);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    RenderStats serial = {0};
+    RenderStats tiled = {0};
+    RenderTarget target = { .buffer = buffer, .depth_buffer = depth, .width = width, .height = height, .stats = &serial };
+
+    SceneStats scene_stats;
+    draw_scene(scene, &camera, &target, &scene_stats);
+
+    clear_buffer(buffer, (Color){0, 0, 0, 255});
+    clear_depth_buffer(depth, width, height);
+    target.tiles = tiles;
+    target.stats = &tiled;
+    draw_scene(scene, &camera, &target, NULL);
+
+    if (RENDER_STATS_ENABLED) {
+        // Nothing in the grid needs clipping, so every submitted triangle is either culled or rasterized
+        TEST_ASSERT_EQUAL_UINT(scene_stats.triangles, serial.triangles_submitted);
+        TEST_ASSERT_EQUAL_UINT(0, serial.triangles_clipped);
+        TEST_ASSERT_EQUAL_UINT(serial.triangles_submitted,
+                               serial.triangles_culled_frustum + serial.triangles_culled_backface +
+                               serial.triangles_culled_zero_area + serial.triangles_rasterized);
+        TEST_ASSERT_TRUE(serial.triangles_culled_backface > 0);
+        TEST_ASSERT_EQUAL_UINT(scene_stats.pixels, serial.pixels_depth_passed);
+        TEST_ASSERT_TRUE(serial.pixels_tested >= serial.pixels_depth_passed);
+        TEST_ASSERT_TRUE(serial.pixels_written >= serial.pixels_depth_passed);
+        TEST_ASSERT_EQUAL_UINT(1, serial.frames);
+
+        // The tile workers count the same work into their own stats and merge them
+        TEST_ASSERT_EQUAL_UINT(serial.triangles_rasterized, tiled.triangles_rasterized);
+        TEST_ASSERT_EQUAL_UINT(serial.pixels_tested, tiled.pixels_tested);
+        TEST_ASSERT_EQUAL_UINT(serial.pixels_depth_passed, tiled.pixels_depth_passed);
+        TEST_ASSERT_EQUAL_UINT(serial.pixels_written, tiled.pixels_written);
+
+        RenderStats merged = serial;
+        render_stats_merge(&merged, &tiled);
+        TEST_ASSERT_EQUAL_UINT(2, merged.frames);
+        TEST_ASSERT_EQUAL_UINT(2 * serial.triangles_submitted, merged.triangles_submitted);
+    } else {
+        // Compiled out, the stats are never touched
+        RenderStats zero = {0};
+        TEST_ASSERT_EQUAL_MEMORY(&zero, &serial, sizeof(RenderStats));
+        TEST_ASSERT_EQUAL_MEMORY(&zero, &tiled, sizeof(RenderStats));
+    }
+
+    destroy_tile_renderer(tiles);
+    destroy_depth_buffer(depth);
+    destroy_pixel_buffer(buffer);
+    destroy_scene(scene);
+}
+
+void test_overdraw_counts_match_rendered_pixels(void) {
+    int width = 150;
+    int height = 110;
+    Scene* scene = create_scene(SCENE_LAYERS);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera camera;
+    camera_init(&camera,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    camera.projection_matrix = mat4_perspective_reversed(45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.3f);
+
+    // Reference frame drawn without counting
+    PixelBuffer* expected = create_pixel_buffer(width, height);
+    void* expected_depth = create_depth_buffer_with_format(width, height, DEPTH_FORMAT_FLOAT32_REVERSED);
+    RenderTarget plain = { .buffer = expected, .depth_buffer = expected_depth, .width = width, .height = height,
+                           .depth_format = DEPTH_FORMAT_FLOAT32_REVERSED };
+    SceneStats expected_stats;
+    draw_scene(scene, &camera, &plain, &expected_stats);
+
+    // Counting must not change the image, and binned drawing on threads must count the same
+    PixelBuffer* serial_pixels = create_pixel_buffer(width, height);
+    void* serial_depth = create_depth_buffer_with_format(width, height, DEPTH_FORMAT_FLOAT32_REVERSED);
+    OverdrawBuffer* serial = create_overdraw_buffer(width, height);
+    RenderTarget serial_target = { .buffer = serial_pixels, .depth_buffer = serial_depth, .width = width, .height = height,
+                                   .depth_format = DEPTH_FORMAT_FLOAT32_REVERSED, .overdraw = serial };
+    draw_scene(scene, &camera, &serial_target, NULL);
+    TEST_ASSERT_EQUAL_MEMORY(expected->pixels, serial_pixels->pixels, sizeof(Color) * width * height);
+
+    PixelBuffer* tiled_pixels = create_pixel_buffer(width, height);
+    void* tiled_depth = create_depth_buffer_with_format(width, height, DEPTH_FORMAT_FLOAT32_REVERSED);
+    OverdrawBuffer* tiled = create_overdraw_buffer(width, height);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    RenderTarget tiled_target = { .buffer = tiled_pixels, .depth_buffer = tiled_depth, .width = width, .height = height,
+                                  .tiles = tiles, .depth_format = DEPTH_FORMAT_FLOAT32_REVERSED, .overdraw = tiled };
+    draw_scene(scene, &camera, &tiled_target, NULL);
+    TEST_ASSERT_EQUAL_MEMORY(expected->pixels, tiled_pixels->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(serial->tested, tiled->tested, sizeof(uint32_t) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(serial->written, tiled->written, sizeof(uint32_t) * width * height);
+
+    uint64_t written_total;
+    uint64_t tested_total;
+    uint32_t written_max = overdraw_max(serial, OVERDRAW_WRITTEN, serial_pixels, &written_total);
+    overdraw_max(serial, OVERDRAW_TESTED, serial_pixels, &tested_total);
+    TEST_ASSERT_EQUAL_UINT64(expected_stats.pixels, written_total);
+    TEST_ASSERT_TRUE(written_max > 1);
+    for (int i = 0; i < width * height; i++) {
+        TEST_ASSERT_TRUE(serial->tested[i] >= serial->written[i]);
+    }
+    TEST_ASSERT_TRUE(tested_total > written_total);
+
+    // The heatmap is black where nothing was drawn, and red at full scale
+    draw_overdraw_heatmap(serial, OVERDRAW_WRITTEN, serial_pixels, 0);
+    for (int i = 0; i < width * height; i++) {
+        Color color = serial_pixels->pixels[i];
+        if (serial->written[i] == 0) {
+            TEST_ASSERT_TRUE(color.r == 0 && color.g == 0 && color.b == 0);
+        } else if (serial->written[i] == written_max) {
+            TEST_ASSERT_TRUE(color.r == 255 && color.g == 0 && color.b == 0);
+        }
+    }
+
+    clear_overdraw_buffer(serial);
+    TEST_ASSERT_EQUAL_UINT32(0, overdraw_max(serial, OVERDRAW_TESTED, serial_pixels, NULL));
+
+    destroy_tile_renderer(tiles);
+    destroy_overdraw_buffer(tiled);
+    destroy_overdraw_buffer(serial);
+    destroy_depth_buffer(tiled_depth);
+    destroy_depth_buffer(serial_depth);
+    destroy_depth_buffer(expected_depth);
+    destroy_pixel_buffer(tiled_pixels);
+    destroy_pixel_buffer(serial_pixels);
+    destroy_pixel_buffer(expected);
+    destroy_scene(scene);
+}
+
+static size_t count_occurrences(const char* text, const char* needle) {
+    size_t count = 0;
+    for (const char* at = strstr(text, needle); at; at = strstr(at + 1, needle)) {
+        count++;
+    }
+    return count;
+}
+
+void test_trace_records_zones_per_thread(void) {
+    const char* path = "test_trace.json";
+    int width = 160;
+    int height = 120;
+    Scene* scene = create_scene(SCENE_GRID);
+    PixelBuffer* buffer = create_pixel_buffer(width, height);
+    float* depth = create_depth_buffer(width, height);
+    TileRenderer* tiles = create_tile_renderer(width, height, 3);
+    RenderTarget target = { .buffer = buffer, .depth_buffer = depth, .width = width, .height = height, .tiles = tiles };
+
+    Camera camera;
+    camera_init(&camera,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.0f);
+
+    // Zones outside an open trace are dropped
+    trace_end(trace_begin("before"));
+    TEST_ASSERT_FALSE(trace_close());
+
+    trace_set_thread_name("test main");
+    TEST_ASSERT_TRUE(trace_open(path));
+    TEST_ASSERT_FALSE(trace_open(path));
+    TEST_ASSERT_TRUE(trace_enabled());
+    TraceZone frame = trace_begin("frame");
+    clear_buffer(buffer, (Color){0, 0, 0, 255});
+    clear_depth_buffer(depth, width, height);
+    draw_scene(scene, &camera, &target, NULL);
+    trace_end(frame);
+    TEST_ASSERT_TRUE(trace_close());
+    TEST_ASSERT_FALSE(trace_enabled());
+
+    FILE* file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = calloc(size + 1, 1);
+    TEST_ASSERT_EQUAL_size_t(size, fread(text, 1, size, file));
+    fclose(file);
+    remove(path);
+
+    // Every thread that drew gets its own named lane
+    TEST_ASSERT_EQUAL_size_t(3, count_occurrences(text, "\"thread_name\""));
+    TEST_ASSERT_EQUAL_size_t(1, count_occurrences(text, "\"test main\""));
+    TEST_ASSERT_EQUAL_size_t(2, count_occurrences(text, "\"tile worker\""));
+    TEST_ASSERT_EQUAL_size_t(3, count_occurrences(text, "\"rasterize_tiles\""));
+    TEST_ASSERT_EQUAL_size_t(scene->objectCount, count_occurrences(text, "\"draw_mesh\""));
+    TEST_ASSERT_EQUAL_size_t(scene->objectCount, count_occurrences(text, "\"draw_wireframe\""));
+    TEST_ASSERT_EQUAL_size_t(1, count_occurrences(text, "\"clear_buffer\""));
+    TEST_ASSERT_EQUAL_size_t(1, count_occurrences(text, "\"clear_depth_buffer\""));
+    TEST_ASSERT_EQUAL_size_t(1, count_occurrences(text, "\"frame\""));
+    TEST_ASSERT_EQUAL_size_t(0, count_occurrences(text, "\"before\""));
+
+    free(text);
+    destroy_tile_renderer(tiles);
+    destroy_depth_buffer(depth);
+    destroy_pixel_buffer(buffer);
+    destroy_scene(scene);
+}
+
+// Reads a whole file into memory; the caller frees the result
+static unsigned char* read_test_file(const char* path, size_t* out_size) {
+    FILE* file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = malloc(size + 1);
+    TEST_ASSERT_EQUAL_size_t(size, fread(data, 1, size, file));
+    fclose(file);
+    *out_size = (size_t)size;
+    return data;
+}
+
+void test_qoi_round_trip_and_binary_ppm(void) {
+    int width = 37;
+    int height = 21;
+    PixelBuffer* buffer = create_pixel_buffer_with_layout(width, height, PIXEL_LAYOUT_TILED);
+
+    // Gradients, runs, repeated colors and alpha changes exercise every QOI chunk type
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            Color color;
+            if (y < 5) {
+                color = (Color){ (uint8_t)(x * 7), (uint8_t)(y * 3), (uint8_t)(x + y), 255 };
+            } else if (y < 10) {
+                color = (Color){ 40, 80, 120, 255 };
+            } else if (y < 15) {
+                color = (x % 3 == 0) ? (Color){ 200, 10, 10, 255 } : (Color){ 10, 200, 10, 255 };
+            } else {
+                color = (Color){ (uint8_t)(x * 31 + y * 17), (uint8_t)(x * 5), (uint8_t)(y * 90), (uint8_t)(x * 9) };
+            }
+            set_pixel(buffer, x, y, color);
+        }
+    }
+    const Color* pixels = resolve_pixel_buffer(buffer);
+
+    size_t encoded_size;
+    unsigned char* encoded = qoi_encode(pixels, width, height, &encoded_size);
+    TEST_ASSERT_NOT_NULL(encoded);
+    TEST_ASSERT_LESS_THAN_size_t((size_t)width * height * 4, encoded_size);
+    int decoded_width, decoded_height;
+    Color* decoded = qoi_decode(encoded, encoded_size, &decoded_width, &decoded_height);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_EQUAL_INT(width, decoded_width);
+    TEST_ASSERT_EQUAL_INT(height, decoded_height);
+    TEST_ASSERT_EQUAL_MEMORY(pixels, decoded, (size_t)width * height * sizeof(Color));
+    free(decoded);
+
+    // Truncated data is rejected rather than read past
+    TEST_ASSERT_NULL(qoi_decode(encoded, encoded_size / 2, &decoded_width, &decoded_height));
+
+    // The file matches the in-memory encoding
+    const char* qoi_path = "test_image.qoi";
+    TEST_ASSERT_TRUE(save_to_qoi(buffer, qoi_path));
+    size_t file_size;
+    unsigned char* file = read_test_file(qoi_path, &file_size);
+    remove(qoi_path);
+    TEST_ASSERT_EQUAL_size_t(encoded_size, file_size);
+    TEST_ASSERT_EQUAL_MEMORY(encoded, file, encoded_size);
+    free(file);
+    free(encoded);
+
+    // Binary PPM is the header followed by packed RGB
+    const char* ppm_path = "test_image.ppm";
+    TEST_ASSERT_TRUE(save_to_ppm(buffer, ppm_path));
+    file = read_test_file(ppm_path, &file_size);
+    remove(ppm_path);
+    const char* header = "P6\n37 21\n255\n";
+    size_t header_size = strlen(header);
+    TEST_ASSERT_EQUAL_size_t(header_size + (size_t)width * height * 3, file_size);
+    TEST_ASSERT_EQUAL_MEMORY(header, file, header_size);
+    for (int i = 0; i < width * height; i++) {
+        const unsigned char* rgb = file + header_size + i * 3;
+        TEST_ASSERT_EQUAL_UINT8(pixels[i].r, rgb[0]);
+        TEST_ASSERT_EQUAL_UINT8(pixels[i].g, rgb[1]);
+        TEST_ASSERT_EQUAL_UINT8(pixels[i].b, rgb[2]);
+    }
+    free(file);
+
+    destroy_pixel_buffer(buffer);
+}
+
+void test_frame_sink_streams_y4m_and_rgba(void) {
+    int width = 5;
+    int height = 3;
+    int frames = 4;
+    PixelBuffer* buffer = create_pixel_buffer_with_layout(width, height, PIXEL_LAYOUT_TILED);
+
+    // Each frame is white on the left two columns and black elsewhere; the last row is red
+    const char* y4m_path = "test_stream.y4m";
+    const char* rgba_path = "test_stream.rgba";
+    FrameSink* y4m = create_frame_sink(y4m_path, FRAME_SINK_Y4M, width, height, 30, 2);
+    FrameSink* rgba = create_frame_sink(rgba_path, FRAME_SINK_RGBA, width, height, 30, 2);
+    TEST_ASSERT_NOT_NULL(y4m);
+    TEST_ASSERT_NOT_NULL(rgba);
+    for (int frame = 0; frame < frames; frame++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Color color = y == 2 ? (Color){255, 0, 0, 255} : x < 2 ? (Color){255, 255, 255, 255} : (Color){0, 0, 0, (uint8_t)frame};
+                set_pixel(buffer, x, y, color);
+            }
+        }
+        TEST_ASSERT_TRUE(frame_sink_push(y4m, buffer));
+        TEST_ASSERT_TRUE(frame_sink_push(rgba, buffer));
+    }
+    TEST_ASSERT_TRUE(destroy_frame_sink(y4m));
+    TEST_ASSERT_TRUE(destroy_frame_sink(rgba));
+
+    // Y4M: the header, then per frame the tag, 5x3 luma and two 3x2 chroma planes
+    size_t size;
+    unsigned char* data = read_test_file(y4m_path, &size);
+    remove(y4m_path);
+    const char* header = "YUV4MPEG2 W5 H3 F30:1 Ip A1:1 C420jpeg\n";
+    size_t header_size = strlen(header);
+    size_t frame_size = strlen("FRAME\n") + 15 + 6 * 2;
+    TEST_ASSERT_EQUAL_size_t(header_size + frames * frame_size, size);
+    TEST_ASSERT_EQUAL_MEMORY(header, data, header_size);
+    for (int frame = 0; frame < frames; frame++) {
+        const unsigned char* tag = data + header_size + frame * frame_size;
+        TEST_ASSERT_EQUAL_MEMORY("FRAME\n", tag, 6);
+        const unsigned char* luma = tag + 6;
+        const unsigned char* u = luma + 15;
+        const unsigned char* v = u + 6;
+        TEST_ASSERT_EQUAL_UINT8(235, luma[0]);
+        TEST_ASSERT_EQUAL_UINT8(16, luma[4]);
+        TEST_ASSERT_EQUAL_UINT8(82, luma[10]);
+        // White and black chroma is neutral; the odd last row and column repeat their edge pixels
+        TEST_ASSERT_EQUAL_UINT8(128, u[0]);
+        TEST_ASSERT_EQUAL_UINT8(128, v[2]);
+        TEST_ASSERT_EQUAL_UINT8(90, u[5]);
+        TEST_ASSERT_EQUAL_UINT8(240, v[5]);
+    }
+    free(data);
+
+    // Raw RGBA is every frame's pixels back to back
+    data = read_test_file(rgba_path, &size);
+    remove(rgba_path);
+    TEST_ASSERT_EQUAL_size_t((size_t)frames * width * height * 4, size);
+    const Color* pixels = resolve_pixel_buffer(buffer);
+    TEST_ASSERT_EQUAL_MEMORY(pixels, data + (size_t)(frames - 1) * width * height * 4, (size_t)width * height * 4);
+    TEST_ASSERT_EQUAL_UINT8(1, data[width * height * 4 + 4 * 4 + 3]);
+    free(data);
+
+    destroy_pixel_buffer(buffer);
+}
+
+static void write_test_file(const char* path, const char* text) {
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(text, file);
+    fclose(file);
+}
+
+void test_load_mesh_from_obj(void) {
+    const char* path = "test_mesh.obj";
+    write_test_file(path,
+        "# comment\n"
+        "mtllib test.mtl\n"
+        "o quad\n"
+        "v 0 0 0 1 0 0\n"
+        "v 1.0 0 0 0 1 0\n"
+        "  v 1 1e0 0 0 0 1\n"
+        "v -0.0 +1 0\n"
+        "v 2.5e-1 -1.5E+1 3 0.5 0.5 0.5\n"
+        "vt 0 0\n"
+        "vn 0 0 -1\n"
+        "vn 0 0 1\n"
+        "usemtl m\n"
+        "s off\n"
+        "f 1/1/1 2/1/1 3/1/1 4/1/1\n"
+        "f -5//2 -3//-1 -4//2\r\n"
+        "f 1 2 5");
+
+    Mesh* mesh = load_mesh_from_obj(path);
+    TEST_ASSERT_NOT_NULL(mesh);
+
+    // The quad fans into two triangles sharing four vertices. The second face reuses positions
+    // with another normal, and the third uses them without one, so each pairing is a new vertex.
+    const int expected_indices[] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 7, 8, 9};
+    TEST_ASSERT_EQUAL_size_t(12, mesh->indexCount);
+    TEST_ASSERT_EQUAL_size_t(10, mesh->vertexCount);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_indices, mesh->indices, 12);
+
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, mesh->vertices[2].position.y);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, mesh->vertices[2].position.w);
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, mesh->vertices[0].normal.z);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, mesh->vertices[4].normal.z);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, mesh->vertices[7].normal.z);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, mesh->vertices[9].position.x);
+    TEST_ASSERT_EQUAL_FLOAT(-15.0f, mesh->vertices[9].position.y);
+    TEST_ASSERT_EQUAL_UINT8(255, mesh->vertices[0].color.r);
+    TEST_ASSERT_EQUAL_UINT8(0, mesh->vertices[0].color.g);
+    TEST_ASSERT_EQUAL_UINT8(255, mesh->vertices[3].color.g);
+    TEST_ASSERT_EQUAL_UINT8(128, mesh->vertices[9].color.b);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, mesh->vertices[5].position.x + mesh->vertices[5].position.y);
+    destroy_mesh(mesh);
+
+    // Out-of-range indices and malformed faces are rejected
+    write_test_file(path, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n");
+    TEST_ASSERT_NULL(load_mesh_from_obj(path));
+    write_test_file(path, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 x\n");
+    TEST_ASSERT_NULL(load_mesh_from_obj(path));
+    remove(path);
+    TEST_ASSERT_NULL(load_mesh_from_obj(path));
+}
+
+void test_obj_parallel_load_matches_serial(void) {
+    const char* path = "test_grid.obj";
+    const int size = 320;
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+
+    // A grid of quads written row by row, each row's faces using relative indices into the
+    // rows just written, so parse chunks have to resolve indices into earlier chunks
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            fprintf(file, "v %.5f %.5f %.5f %.3f %.3f 0.5\n", x * 0.01f, y * 0.01f, (x * y % 7) * 0.001f,
+                    (float)x / size, (float)y / size);
+        }
+        fprintf(file, "vn 0 0 -1\n");
+        if (y > 0) {
+            int row = size + 1;
+            for (int x = 0; x < size; x++) {
+                int here = -row + x;
+                fprintf(file, "f %d//-1 %d//-1 %d//-1 %d//-1\n", here - row, here - row + 1, here + 1, here);
+            }
+        }
+    }
+    fclose(file);
+
+    Mesh* serial = load_mesh_from_obj(path);
+    Mesh* parallel = load_mesh_from_obj_parallel(path, 4);
+    remove(path);
+    TEST_ASSERT_NOT_NULL(serial);
+    TEST_ASSERT_NOT_NULL(parallel);
+
+    // Normals split the vertices of every row between the faces above and below it
+    TEST_ASSERT_EQUAL_size_t((size_t)size * size * 6, serial->indexCount);
+    TEST_ASSERT_EQUAL_size_t((size_t)(size + 1) * size * 2, serial->vertexCount);
+    TEST_ASSERT_EQUAL_size_t(serial->vertexCount, parallel->vertexCount);
+    TEST_ASSERT_EQUAL_size_t(serial->indexCount, parallel->indexCount);
+    TEST_ASSERT_EQUAL_MEMORY(serial->vertices, parallel->vertices, serial->vertexCount * sizeof(Vertex));
+    TEST_ASSERT_EQUAL_MEMORY(serial->indices, parallel->indices, serial->indexCount * sizeof(int));
+
+    destroy_mesh(parallel);
+    destroy_mesh(serial);
+}
+
+void test_mesh_cache_round_trip(void) {
+    const char* path = "test_mesh.rmesh";
+    Mesh* cube = create_cube_mesh();
+    TEST_ASSERT_TRUE(save_mesh_cache(cube, path));
+
+    // The arrays point into the mapping, aligned, and hold exactly what was saved
+    Mesh* cached = load_mesh_cache(path);
+    TEST_ASSERT_NOT_NULL(cached);
+    TEST_ASSERT_NOT_NULL(cached->mapping);
+    TEST_ASSERT_EQUAL_size_t(cube->vertexCount, cached->vertexCount);
+    TEST_ASSERT_EQUAL_size_t(cube->indexCount, cached->indexCount);
+    TEST_ASSERT_EQUAL_MEMORY(cube->vertices, cached->vertices, cube->vertexCount * sizeof(Vertex));
+    TEST_ASSERT_EQUAL_MEMORY(cube->indices, cached->indices, cube->indexCount * sizeof(int));
+    TEST_ASSERT_TRUE((unsigned char*)cached->vertices >= cached->mapping->data &&
+                     (unsigned char*)(cached->indices + cached->indexCount) <= cached->mapping->data + cached->mapping->size);
+    TEST_ASSERT_EQUAL_UINT64(0, (uintptr_t)cached->vertices % MESH_CACHE_ALIGNMENT);
+    TEST_ASSERT_EQUAL_UINT64(0, (uintptr_t)cached->indices % MESH_CACHE_ALIGNMENT);
+
+    // Writes stay private to the process
+    cached->indices[0] = 7;
+    destroy_mesh(cached);
+    cached = load_mesh_cache(path);
+    TEST_ASSERT_NOT_NULL(cached);
+    TEST_ASSERT_EQUAL_INT(cube->indices[0], cached->indices[0]);
+    destroy_mesh(cached);
+
+    size_t size;
+    unsigned char* data = read_test_file(path, &size);
+
+    // Truncated files, other versions and out-of-range indices are rejected
+    FILE* file = fopen(path, "wb");
+    fwrite(data, 1, size - 4, file);
+    fclose(file);
+    TEST_ASSERT_NULL(load_mesh_cache(path));
+
+    MeshCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    header.version++;
+    memcpy(data, &header, sizeof(header));
+    file = fopen(path, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    TEST_ASSERT_NULL(load_mesh_cache(path));
+
+    header.version--;
+    memcpy(data, &header, sizeof(header));
+    int out_of_range = (int)cube->vertexCount;
+    memcpy(data + header.index_offset, &out_of_range, sizeof(int));
+    file = fopen(path, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    TEST_ASSERT_NULL(load_mesh_cache(path));
+
+    free(data);
+    remove(path);
+    destroy_mesh(cube);
+}
+
+static void write_test_bytes(const char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+void test_load_mesh_from_stl_welds_corners(void) {
+    const char* path = "test_mesh.stl";
+    Mesh* cube = create_cube_mesh();
+    size_t triangle_count = cube->indexCount / 3;
+
+    // Write the cube as a triangle soup, one record of 50 bytes per triangle
+    size_t size = 84 + triangle_count * 50;
+    unsigned char* data = calloc(size, 1);
+    uint32_t count = (uint32_t)triangle_count;
+    memcpy(data + 80, &count, sizeof(count));
+    for (size_t t = 0; t < triangle_count; t++) {
+        unsigned char* record = data + 84 + t * 50;
+        for (int c = 0; c < 3; c++) {
+            Vec4 p = cube->vertices[cube->indices[t * 3 + c]].position;
+            float corner[3] = {p.x, p.y, p.z};
+            memcpy(record + 12 + c * 12, corner, sizeof(corner));
+        }
+    }
+    write_test_bytes(path, data, size);
+
+    // Corners at the same position share a vertex, so the triangles come back as they were
+    Mesh* mesh = load_mesh_from_stl(path);
+    TEST_ASSERT_NOT_NULL(mesh);
+    TEST_ASSERT_EQUAL_size_t(cube->vertexCount, mesh->vertexCount);
+    TEST_ASSERT_EQUAL_size_t(cube->indexCount, mesh->indexCount);
+    for (size_t i = 0; i < mesh->indexCount; i++) {
+        Vec4 expected = cube->vertices[cube->indices[i]].position;
+        Vec4 actual = mesh->vertices[mesh->indices[i]].position;
+        TEST_ASSERT_EQUAL_FLOAT(expected.x, actual.x);
+        TEST_ASSERT_EQUAL_FLOAT(expected.y, actual.y);
+        TEST_ASSERT_EQUAL_FLOAT(expected.z, actual.z);
+    }
+    destroy_mesh(mesh);
+
+    // A file shorter than its triangle count is rejected
+    write_test_bytes(path, data, size - 10);
+    TEST_ASSERT_NULL(load_mesh_from_stl(path));
+
+    remove(path);
+    free(data);
+    destroy_mesh(cube);
+}
+
+static size_t put_big_endian_float(unsigned char* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out[0] = (unsigned char)(bits >> 24);
+    out[1] = (unsigned char)(bits >> 16);
+    out[2] = (unsigned char)(bits >> 8);
+    out[3] = (unsigned char)bits;
+    return 4;
+}
+
+void test_load_mesh_from_ply(void) {
+    const char* path = "test_mesh.ply";
+    const float positions[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}};
+
+    // Little-endian: colored vertices with an unused property, a quad and a triangle, then
+    // an element the loader skips
+    const char* header =
+        "ply\n"
+        "format binary_little_endian 1.0\n"
+        "comment written by the tests\n"
+        "element vertex 4\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "property uchar red\n"
+        "property uchar green\n"
+        "property uchar blue\n"
+        "property float confidence\n"
+        "element face 2\n"
+        "property list uchar int vertex_indices\n"
+        "element edge 1\n"
+        "property int vertex1\n"
+        "property int vertex2\n"
+        "end_header\n";
+    unsigned char data[512];
+    size_t size = strlen(header);
+    memcpy(data, header, size);
+    for (int v = 0; v < 4; v++) {
+        memcpy(data + size, positions[v], sizeof(positions[v]));
+        size += sizeof(positions[v]);
+        data[size++] = (unsigned char)(v * 10);
+        data[size++] = 20;
+        data[size++] = 30;
+        float confidence = 0.5f;
+        memcpy(data + size, &confidence, sizeof(confidence));
+        size += sizeof(confidence);
+    }
+    const int quad[4] = {0, 1, 2, 3};
+    const int triangle[3] = {0, 2, 3};
+    data[size++] = 4;
+    memcpy(data + size, quad, sizeof(quad));
+    size += sizeof(quad);
+    data[size++] = 3;
+    memcpy(data + size, triangle, sizeof(triangle));
+    size += sizeof(triangle);
+    const int edge[2] = {0, 1};
+    memcpy(data + size, edge, sizeof(edge));
+    size += sizeof(edge);
+    write_test_bytes(path, data, size);
+
+    Mesh* mesh = load_mesh_from_ply(path);
+    TEST_ASSERT_NOT_NULL(mesh);
+    const int expected_indices[] = {0, 1, 2, 0, 2, 3, 0, 2, 3};
+    TEST_ASSERT_EQUAL_size_t(4, mesh->vertexCount);
+    TEST_ASSERT_EQUAL_size_t(9, mesh->indexCount);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_indices, mesh->indices, 9);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, mesh->vertices[2].position.y);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, mesh->vertices[2].position.w);
+    TEST_ASSERT_EQUAL_UINT8(30, mesh->vertices[3].color.r);
+    TEST_ASSERT_EQUAL_UINT8(30, mesh->vertices[3].color.b);
+    TEST_ASSERT_EQUAL_UINT8(255, mesh->vertices[3].color.a);
+    destroy_mesh(mesh);
+
+    // Big-endian, with the vertex index list typed as uint
+    header =
+        "ply\r\n"
+        "format binary_big_endian 1.0\r\n"
+        "element vertex 3\r\n"
+        "property float x\r\n"
+        "property float y\r\n"
+        "property float z\r\n"
+        "element face 1\r\n"
+        "property list uchar uint vertex_index\r\n"
+        "end_header\r\n";
+    size = strlen(header);
+    memcpy(data, header, size);
+    for (int v = 0; v < 3; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            size += put_big_endian_float(data + size, positions[v][axis] * 2.0f);
+        }
+    }
+    const unsigned char face[] = {3, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0};
+    memcpy(data + size, face, sizeof(face));
+    size += sizeof(face);
+    write_test_bytes(path, data, size);
+
+    mesh = load_mesh_from_ply(path);
+    TEST_ASSERT_NOT_NULL(mesh);
+    const int expected_triangle[] = {2, 1, 0};
+    TEST_ASSERT_EQUAL_size_t(3, mesh->vertexCount);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_triangle, mesh->indices, 3);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, mesh->vertices[2].position.x);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, mesh->vertices[2].position.y);
+    destroy_mesh(mesh);
+
+    // Text PLY is not read
+    write_test_file(path, "ply\nformat ascii 1.0\nelement vertex 0\nend_header\n");
+    TEST_ASSERT_NULL(load_mesh_from_ply(path));
+    remove(path);
+}
+
+void test_mesh_loaders_reject_counts_larger_than_the_file(void) {
+    // A binary STL header claiming 700M triangles, followed by a single record
+    const char* path = "test_counts.stl";
+    unsigned char stl[80 + 4 + 50] = {0};
+    const uint32_t triangle_counts[] = {700000000u, 2u};
+    for (size_t i = 0; i < sizeof(triangle_counts) / sizeof(triangle_counts[0]); i++) {
+        for (int b = 0; b < 4; b++) {
+            stl[80 + b] = (unsigned char)(triangle_counts[i] >> (8 * b));
+        }
+        write_test_bytes(path, stl, sizeof(stl));
+        TEST_ASSERT_NULL(load_mesh_from_stl(path));
+    }
+
+    // ASCII STL, whose text would otherwise be read as the triangle count
+    write_test_file(path,
+        "solid triangle\n"
+        "  facet normal 0 0 1\n"
+        "    outer loop\n"
+        "      vertex 0 0 0\n"
+        "      vertex 1 0 0\n"
+        "      vertex 0 1 0\n"
+        "    endloop\n"
+        "  endfacet\n"
+        "endsolid triangle\n");
+    TEST_ASSERT_NULL(load_mesh_from_stl(path));
+    remove(path);
+
+    // A PLY header claiming far more vertices than the bytes after it
+    path = "test_counts.ply";
+    const char* header =
+        "ply\n"
+        "format binary_little_endian 1.0\n"
+        "element vertex 2000000000\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n"
+        "element face 1\n"
+        "property list uchar int vertex_indices\n"
+        "end_header\n";
+    unsigned char ply[256] = {0};
+    size_t size = strlen(header);
+    memcpy(ply, header, size);
+    write_test_bytes(path, ply, size + 3 * 12 + 13);
+    TEST_ASSERT_NULL(load_mesh_from_ply(path));
+    remove(path);
+}
+
+void test_json_parse_and_lookup(void) {
+    const char* text = " {\"name\": \"a\\\"b\", \"list\": [1, -2.5e1, {\"x\": true}, null], \"empty\": {}} ";
+    JsonDocument* json = json_parse(text, strlen(text));
+    TEST_ASSERT_NOT_NULL(json);
+    TEST_ASSERT_EQUAL_INT(JSON_OBJECT, json->tokens[0].type);
+    TEST_ASSERT_EQUAL_size_t(3, json->tokens[0].count);
+
+    // Strings keep their escapes
+    TEST_ASSERT_TRUE(json_string_equals(json, json_object_get(json, 0, "name"), "a\\\"b"));
+
+    int list = json_object_get(json, 0, "list");
+    TEST_ASSERT_EQUAL_size_t(4, json_array_count(json, list));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, (float)json_number(json, json_array_get(json, list, 0), 0.0));
+    TEST_ASSERT_EQUAL_FLOAT(-25.0f, (float)json_number(json, json_array_get(json, list, 1), 0.0));
+    int inner = json_array_get(json, list, 2);
+    TEST_ASSERT_EQUAL_INT(JSON_BOOL, json->tokens[json_object_get(json, inner, "x")].type);
+    TEST_ASSERT_EQUAL_INT(JSON_NULL, json->tokens[json_array_get(json, list, 3)].type);
+    TEST_ASSERT_EQUAL_INT(-1, json_array_get(json, list, 4));
+
+    // Members after a nested value are still found, and missing ones fall back
+    TEST_ASSERT_EQUAL_size_t(0, json->tokens[json_object_get(json, 0, "empty")].count);
+    TEST_ASSERT_EQUAL_INT(-1, json_object_get(json, 0, "missing"));
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, (float)json_number(json, json_object_get(json, 0, "missing"), 7.0));
+    json_destroy(json);
+
+    const char* invalid[] = {"", "[1,]", "{\"a\" 1}", "\"open", "[1] 2", "01x", "tru", "{1: 2}"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        TEST_ASSERT_NULL(json_parse(invalid[i], strlen(invalid[i])));
+    }
+
+    // Nesting is bounded
+    char deep[200];
+    memset(deep, '[', 100);
+    memset(deep + 100, ']', 100);
+    TEST_ASSERT_NULL(json_parse(deep, sizeof(deep)));
+}
+
+static void put_u32_le(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+// Writes a .glb file from its JSON text and binary chunk, padding the JSON to four bytes
+static void write_test_glb(const char* path, const char* json, const void* bin, size_t bin_size) {
+    size_t json_size = (strlen(json) + 3) / 4 * 4;
+    size_t size = 12 + 8 + json_size + 8 + bin_size;
+    unsigned char* data = malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+
+    memcpy(data, "glTF", 4);
+    put_u32_le(data + 4, 2);
+    put_u32_le(data + 8, (uint32_t)size);
+    put_u32_le(data + 12, (uint32_t)json_size);
+    memcpy(data + 16, "JSON", 4);
+    memset(data + 20, ' ', json_size);
+    memcpy(data + 20, json, strlen(json));
+    put_u32_le(data + 20 + json_size, (uint32_t)bin_size);
+    memcpy(data + 24 + json_size, "BIN\0", 4);
+    memcpy(data + 28 + json_size, bin, bin_size);
+    write_test_bytes(path, data, size);
+    free(data);
+}
+
+void test_load_gltf_model(void) {
+    const char* path = "test_mesh.glb";
+
+    // Positions, normalized byte colors, 32-bit indices and 16-bit indices
+    struct {
+        float positions[4][3];
+        unsigned char colors[4][4];
+        uint32_t indices32[6];
+        uint16_t indices16[4];
+    } bin = {
+        {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}},
+        {{255, 0, 0, 255}, {0, 255, 0, 255}, {0, 0, 255, 255}, {255, 255, 255, 128}},
+        {0, 1, 2, 0, 2, 3},
+        {2, 1, 0, 0}
+    };
+    TEST_ASSERT_EQUAL_size_t(96, sizeof(bin));
+
+    // Node 0 translates mesh 0 and is the parent of node 1, which scales mesh 1. Mesh 0 also
+    // has a line primitive, which is skipped, and node 2 is not in the scene.
+    const char* json =
+        "{\"asset\": {\"version\": \"2.0\"}, \"scene\": 0, \"scenes\": [{\"nodes\": [0]}],"
+        " \"nodes\": [{\"mesh\": 0, \"translation\": [10, 0, 0], \"children\": [1]},"
+        "            {\"mesh\": 1, \"scale\": [2, 2, 2]}, {\"mesh\": 1}],"
+        " \"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0, \"COLOR_0\": 1}, \"indices\": 2},"
+        "                                {\"attributes\": {\"POSITION\": 0}, \"mode\": 1}]},"
+        "              {\"primitives\": [{\"attributes\": {\"POSITION\": 0}, \"indices\": 3}]}],"
+        " \"accessors\": [{\"bufferView\": 0, \"componentType\": 5126, \"count\": 4, \"type\": \"VEC3\"},"
+        "                 {\"bufferView\": 1, \"componentType\": 5121, \"normalized\": true, \"count\": 4, \"type\": \"VEC4\"},"
+        "                 {\"bufferView\": 2, \"componentType\": 5125, \"count\": 6, \"type\": \"SCALAR\"},"
+        "                 {\"bufferView\": 2, \"byteOffset\": 24, \"componentType\": 5123, \"count\": 3, \"type\": \"SCALAR\"}],"
+        " \"bufferViews\": [{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": 48},"
+        "                   {\"buffer\": 0, \"byteOffset\": 48, \"byteLength\": 16},"
+        "                   {\"buffer\": 0, \"byteOffset\": 64, \"byteLength\": 32}],"
+        " \"buffers\": [{\"byteLength\": 96}]}";
+    write_test_glb(path, json, &bin, sizeof(bin));
+
+    GltfModel* model = load_gltf_model(path);
+    TEST_ASSERT_NOT_NULL(model);
+    TEST_ASSERT_EQUAL_size_t(2, model->primitiveCount);
+    TEST_ASSERT_EQUAL_size_t(2, model->instanceCount);
+    TEST_ASSERT_EQUAL_size_t(0, model->instances[0].primitive);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, model->instances[0].transform.m[12]);
+    TEST_ASSERT_EQUAL_size_t(1, model->instances[1].primitive);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, model->instances[1].transform.m[0]);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f, model->instances[1].transform.m[12]);
+
+    // The accessors are views of the mapped file
+    const GltfPrimitive* primitive = &model->primitives[0];
+    TEST_ASSERT_TRUE(primitive->positions.data >= model->file->data &&
+                     primitive->positions.data < model->file->data + model->file->size);
+    TEST_ASSERT_EQUAL_size_t(12, primitive->positions.stride);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, gltf_accessor_float(&primitive->positions, 2, 1));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, gltf_accessor_float(&primitive->colors, 1, 1));
+    TEST_ASSERT_EQUAL_UINT32(3, gltf_accessor_uint(&primitive->indices, 5));
+
+    // 32-bit indices are used in place, and keep the file mapped after the model is gone
+    Mesh* quad = gltf_primitive_to_mesh(model, 0);
+    Mesh* triangle = gltf_primitive_to_mesh(model, 1);
+    TEST_ASSERT_NOT_NULL(quad);
+    TEST_ASSERT_NOT_NULL(triangle);
+    TEST_ASSERT_EQUAL_PTR(primitive->indices.data, quad->indices);
+    TEST_ASSERT_NOT_NULL(quad->mapping);
+    TEST_ASSERT_NULL(triangle->mapping);
+    destroy_gltf_model(model);
+
+    const int expected_quad[] = {0, 1, 2, 0, 2, 3};
+    TEST_ASSERT_EQUAL_size_t(4, quad->vertexCount);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_quad, quad->indices, 6);
+    TEST_ASSERT_EQUAL_UINT8(255, quad->vertices[1].color.g);
+    TEST_ASSERT_EQUAL_UINT8(0, quad->vertices[1].color.r);
+    TEST_ASSERT_EQUAL_UINT8(128, quad->vertices[3].color.a);
+    TEST_ASSERT_EQUAL_UINT8(255, triangle->vertices[0].color.r);
+
+    const int expected_triangle[] = {2, 1, 0};
+    TEST_ASSERT_EQUAL_size_t(3, triangle->indexCount);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected_triangle, triangle->indices, 3);
+    destroy_mesh(quad);
+    destroy_mesh(triangle);
+
+    // Out of range indices are rejected when the mesh is built
+    bin.indices16[0] = 4;
+    write_test_glb(path, json, &bin, sizeof(bin));
+    model = load_gltf_model(path);
+    TEST_ASSERT_NOT_NULL(model);
+    TEST_ASSERT_NULL(gltf_primitive_to_mesh(model, 1));
+    destroy_gltf_model(model);
+
+    // A view running past the binary chunk rejects the file
+    write_test_glb(path, json, &bin, 90);
+    TEST_ASSERT_NULL(load_gltf_model(path));
+    remove(path);
+}
+
+void test_mesh_instances_scene_fits_the_group(void) {
+    Mesh* meshes[] = {create_cube_mesh(), create_pyramid_mesh()};
+    MeshInstance instances[] = {
+        {meshes[0], mat4_translation(-10.0f, 0.0f, 0.0f)},
+        {meshes[1], mat4_translation(10.0f, 0.0f, 0.0f)},
+        {meshes[0], mat4_translation(0.0f, 3.0f, 0.0f)}
+    };
+    Scene* scene = create_mesh_instances_scene(meshes, 2, instances, 3);
+    TEST_ASSERT_NOT_NULL(scene);
+    TEST_ASSERT_EQUAL_size_t(3, scene->objectCount);
+    TEST_ASSERT_EQUAL_size_t(2, scene->meshCount);
+
+    // The cube corners reach from -10.5 to 10.5 in x, which is the largest side
+    Vec4 left = mat4_mul_vec4(scene->objects[0].model_matrix, (Vec4){-0.5f, 0.0f, 0.0f, 1.0f});
+    Vec4 right = mat4_mul_vec4(scene->objects[1].model_matrix, (Vec4){0.5f, 0.0f, 0.0f, 1.0f});
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, -1.0f, left.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, right.x);
+    destroy_scene(scene);
+}
+
+// A flat grid of size x size quads in the z = 0 plane, vertex (x, y) at index y * (size + 1) + x,
+// with its triangles shuffled
+static Mesh* create_shuffled_grid(int size) {
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    TEST_ASSERT_NOT_NULL(mesh);
+    mesh->vertexCount = (size_t)(size + 1) * (size + 1);
+    mesh->indexCount = (size_t)size * size * 6;
+    mesh->vertices = calloc(mesh->vertexCount, sizeof(Vertex));
+    mesh->indices = malloc(mesh->indexCount * sizeof(int));
+    TEST_ASSERT_NOT_NULL(mesh->vertices);
+    TEST_ASSERT_NOT_NULL(mesh->indices);
+
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            mesh->vertices[y * (size + 1) + x].position = (Vec4){(float)x, (float)y, 0.0f, 1.0f};
+        }
+    }
+    int* out = mesh->indices;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int a = y * (size + 1) + x;
+            int b = a + size + 1;
+            int quad[6] = {a, a + 1, b, a + 1, b + 1, b};
+            memcpy(out, quad, sizeof(quad));
+            out += 6;
+        }
+    }
+
+    unsigned int seed = 12345;
+    for (size_t t = mesh->indexCount / 3 - 1; t > 0; t--) {
+        seed = seed * 1103515245u + 12345u;
+        size_t other = (seed >> 8) % (t + 1);
+        for (int c = 0; c < 3; c++) {
+            int swap = mesh->indices[t * 3 + c];
+            mesh->indices[t * 3 + c] = mesh->indices[other * 3 + c];
+            mesh->indices[other * 3 + c] = swap;
+        }
+    }
+    return mesh;
+}
+
+static int compare_longs(const void* a, const void* b) {
+    long x = *(const long*)a;
+    long y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+// Encodes each triangle of a grid by the grid positions of its corners in order, then sorts them
+static long* grid_triangle_codes(const Mesh* mesh, int size) {
+    size_t triangle_count = mesh->indexCount / 3;
+    long side = (long)(size + 1) * (size + 1);
+    long* codes = malloc(triangle_count * sizeof(long));
+    TEST_ASSERT_NOT_NULL(codes);
+    for (size_t t = 0; t < triangle_count; t++) {
+        long code = 0;
+        for (int c = 0; c < 3; c++) {
+            Vec4 p = mesh->vertices[mesh->indices[t * 3 + c]].position;
+            code = code * side + (long)p.y * (size + 1) + (long)p.x;
+        }
+        codes[t] = code;
+    }
+    qsort(codes, triangle_count, sizeof(long), compare_longs);
+    return codes;
+}
+
+void test_optimize_mesh_reorders_for_the_vertex_cache(void) {
+    const int size = 32;
+    Mesh* mesh = create_shuffled_grid(size);
+    long* before = grid_triangle_codes(mesh, size);
+    float shuffled_ratio = mesh_cache_miss_ratio(mesh, MESH_OPTIMIZE_CACHE_SIZE);
+    TEST_ASSERT_TRUE(shuffled_ratio > 2.0f);
+
+    TEST_ASSERT_TRUE(optimize_mesh_vertex_cache(mesh, MESH_OPTIMIZE_CACHE_SIZE));
+    float cache_ratio = mesh_cache_miss_ratio(mesh, MESH_OPTIMIZE_CACHE_SIZE);
+    TEST_ASSERT_TRUE(cache_ratio < 0.8f);
+
+    // The overdraw pass may only give up a little of the cache locality
+    TEST_ASSERT_TRUE(optimize_mesh(mesh));
+    TEST_ASSERT_TRUE(mesh_cache_miss_ratio(mesh, MESH_OPTIMIZE_CACHE_SIZE) < cache_ratio * 1.2f);
+
+    // The same triangles with the same winding remain
+    long* after = grid_triangle_codes(mesh, size);
+    TEST_ASSERT_EQUAL_MEMORY(before, after, mesh->indexCount / 3 * sizeof(long));
+
+    // Vertices are numbered in the order the triangles first use them
+    int next = 0;
+    for (size_t i = 0; i < mesh->indexCount; i++) {
+        TEST_ASSERT_TRUE(mesh->indices[i] <= next);
+        if (mesh->indices[i] == next) {
+            next++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT((int)mesh->vertexCount, next);
+
+    free(before);
+    free(after);
+    destroy_mesh(mesh);
+}
+
+void test_optimize_mesh_overdraw_draws_occluders_first(void) {
+    // Two quads facing the camera, which looks along +z: the far one is listed first
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    TEST_ASSERT_NOT_NULL(mesh);
+    mesh->vertexCount = 8;
+    mesh->indexCount = 12;
+    mesh->vertices = calloc(8, sizeof(Vertex));
+    mesh->indices = malloc(12 * sizeof(int));
+    for (int v = 0; v < 8; v++) {
+        float z = v < 4 ? 1.0f : -1.0f;
+        mesh->vertices[v].position = (Vec4){(v & 1) ? 1.0f : -1.0f, (v & 2) ? 1.0f : -1.0f, z, 1.0f};
+    }
+    // Corners 0, 1, 3 go counter-clockwise as the camera sees them, like the cube's front face
+    const int indices[12] = {0, 1, 3, 3, 2, 0, 4, 5, 7, 7, 6, 4};
+    memcpy(mesh->indices, indices, sizeof(indices));
+
+    TEST_ASSERT_TRUE(optimize_mesh_overdraw(mesh, MESH_OPTIMIZE_CACHE_SIZE, MESH_OPTIMIZE_OVERDRAW_THRESHOLD));
+    const int expected[12] = {4, 5, 7, 7, 6, 4, 0, 1, 3, 3, 2, 0};
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, mesh->indices, 12);
+    destroy_mesh(mesh);
+}
+
+void test_transform_vertex_arrays_matches_mat4_mul_vec4(void) {
+    // 37 vertices leave a scalar tail after the batches of every path
+    Mesh* mesh = calloc(1, sizeof(Mesh));
+    TEST_ASSERT_NOT_NULL(mesh);
+    mesh->vertexCount = 37;
+    mesh->vertices = calloc(mesh->vertexCount, sizeof(Vertex));
+    TEST_ASSERT_NOT_NULL(mesh->vertices);
+    for (size_t i = 0; i < mesh->vertexCount; i++) {
+        float t = (float)i;
+        mesh->vertices[i].position = (Vec4){sinf(t) * 2.5f, 0.13f * t - 2.0f, cosf(1.7f * t) * 3.0f, 1.0f};
+    }
+
+    // Arrays built for fewer vertices are regrown when the count rises
+    mesh->vertexCount = 20;
+    TEST_ASSERT_TRUE(mesh_build_vertex_arrays(mesh));
+    TEST_ASSERT_EQUAL_size_t(20, mesh->arrays->capacity);
+    mesh->vertexCount = 37;
+    TEST_ASSERT_TRUE(mesh_build_vertex_arrays(mesh));
+    TEST_ASSERT_EQUAL_size_t(37, mesh->arrays->capacity);
+
+    Mat4 mvp = mat4_multiply(mat4_perspective(60.0f, 1.3f, 0.1f, 100.0f),
+                             mat4_multiply(mat4_translation(0.3f, -0.2f, -7.0f), mat4_rotation_y(0.6f)));
+    float x[37], y[37], z[37], w[37];
+    ClipArrays clip = {x, y, z, w};
+
+    RasterPath original = raster_get_path();
+    RasterPath paths[] = { RASTER_PATH_SCALAR, RASTER_PATH_SSE2, RASTER_PATH_AVX2 };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        if (!raster_set_path(paths[p])) {
+            continue;
+        }
+        memset(x, 0, sizeof(x));
+        memset(w, 0, sizeof(w));
+        transform_vertex_arrays(&mvp, mesh->arrays, mesh->vertexCount, &clip);
+        for (size_t i = 0; i < mesh->vertexCount; i++) {
+            Vec4 expected = mat4_mul_vec4(mvp, vertex_to_vec4(mesh->vertices[i]));
+            Vec4 actual = {x[i], y[i], z[i], w[i]};
+            TEST_ASSERT_EQUAL_MEMORY(&expected, &actual, sizeof(Vec4));
+        }
+    }
+    raster_set_path(original);
+    destroy_mesh(mesh);
+}
+
+void test_draw_scene_with_vertex_arrays_matches_interleaved(void) {
+    int width = 160;
+    int height = 120;
+    Scene* scene = create_scene(SCENE_GRID);
+    TEST_ASSERT_NOT_NULL(scene);
+
+    Camera view;
+    camera_init(&view,
+        (Vec3){scene->center.x, scene->center.y, scene->center.z - scene->view_distance},
+        scene->center, (Vec3){0.0f, 1.0f, 0.0f}, 45.0f, (float)width / height, 0.1f, 100.0f);
+    scene_update(scene, 0.4f);
+
+    PixelBuffer* pixels[2];
+    float* depth[2];
+    SceneStats stats[2];
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            for (size_t i = 0; i < scene->meshCount; i++) {
+                TEST_ASSERT_TRUE(mesh_build_vertex_arrays(scene->meshes[i]));
+            }
+        }
+        pixels[pass] = create_pixel_buffer(width, height);
+        depth[pass] = create_depth_buffer(width, height);
+        RenderTarget target = { .buffer = pixels[pass], .depth_buffer = depth[pass], .width = width, .height = height };
+        draw_scene(scene, &view, &target, &stats[pass]);
+    }
+
+    TEST_ASSERT_TRUE(stats[0].pixels > 0);
+    TEST_ASSERT_EQUAL_UINT(stats[0].pixels, stats[1].pixels);
+    TEST_ASSERT_EQUAL_MEMORY(pixels[0]->pixels, pixels[1]->pixels, sizeof(Color) * width * height);
+    TEST_ASSERT_EQUAL_MEMORY(depth[0], depth[1], sizeof(float) * width * height);
+
+    for (int pass = 0; pass < 2; pass++) {
+        destroy_depth_buffer(depth[pass]);
+        destroy_pixel_buffer(pixels[pass]);
+    }
+    destroy_scene(scene);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_create_pixel_buffer);
     RUN_TEST(test_clear_buffer);
     RUN_TEST(test_set_pixel);
+    RUN_TEST(test_fill_span_matches_set_pixel);
     RUN_TEST(test_get_pixel);
     RUN_TEST(test_get_pixel_out_of_bounds);
     RUN_TEST(test_vec3_add);
@@ -402,6 +2370,7 @@ int main(void) {
     RUN_TEST(test_mat4_perspective);
     RUN_TEST(test_mat4_look_at);
     RUN_TEST(test_mat4_rotation_y);
+    RUN_TEST(test_mat4_perspective_depth_variants);
     RUN_TEST(test_create_depth_buffer);
     RUN_TEST(test_clear_depth_buffer);
     RUN_TEST(test_destroy_depth_buffer);
@@ -411,5 +2380,41 @@ int main(void) {
     RUN_TEST(test_camera_strafe_right);
     RUN_TEST(test_camera_yaw);
     RUN_TEST(test_camera_pitch);
+    RUN_TEST(test_clip_triangle_splits_at_near_plane);
+    RUN_TEST(test_clip_triangle_rejects_and_passes_through);
+    RUN_TEST(test_clip_line_cuts_at_near_plane_and_guard_band);
+    RUN_TEST(test_draw_wireframe_clips_edges_behind_the_eye);
+    RUN_TEST(test_setup_culls_by_screen_winding);
+    RUN_TEST(test_fill_rule_regular_quad_touches_each_pixel_once);
+    RUN_TEST(test_fill_rule_jittered_quad_touches_each_pixel_once);
+    RUN_TEST(test_fixed_point_shared_edge_covers_each_pixel_once);
+    RUN_TEST(test_fixed_point_subpixel_offsets_decide_coverage);
+    RUN_TEST(test_fixed_point_degenerate_triangles_write_nothing);
+    RUN_TEST(test_draw_mesh_matches_draw_triangle);
+    RUN_TEST(test_draw_mesh_skips_triangles_with_bad_indices);
+    RUN_TEST(test_tile_renderer_matches_serial);
+    RUN_TEST(test_raster_paths_match_scalar);
+    RUN_TEST(test_hiz_matches_plain_depth_test);
+    RUN_TEST(test_clear_tiles_match_eager_clear);
+    RUN_TEST(test_tiled_layout_matches_linear);
+    RUN_TEST(test_depth_formats_agree_across_paths);
+    RUN_TEST(test_render_stats_account_for_every_triangle);
+    RUN_TEST(test_overdraw_counts_match_rendered_pixels);
+    RUN_TEST(test_trace_records_zones_per_thread);
+    RUN_TEST(test_qoi_round_trip_and_binary_ppm);
+    RUN_TEST(test_frame_sink_streams_y4m_and_rgba);
+    RUN_TEST(test_load_mesh_from_obj);
+    RUN_TEST(test_obj_parallel_load_matches_serial);
+    RUN_TEST(test_mesh_cache_round_trip);
+    RUN_TEST(test_load_mesh_from_stl_welds_corners);
+    RUN_TEST(test_load_mesh_from_ply);
+    RUN_TEST(test_mesh_loaders_reject_counts_larger_than_the_file);
+    RUN_TEST(test_json_parse_and_lookup);
+    RUN_TEST(test_load_gltf_model);
+    RUN_TEST(test_mesh_instances_scene_fits_the_group);
+    RUN_TEST(test_optimize_mesh_reorders_for_the_vertex_cache);
+    RUN_TEST(test_optimize_mesh_overdraw_draws_occluders_first);
+    RUN_TEST(test_transform_vertex_arrays_matches_mat4_mul_vec4);
+    RUN_TEST(test_draw_scene_with_vertex_arrays_matches_interleaved);
     return UNITY_END();
 }
\ No newline at end of file